@@ -0,0 +1,157 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "table.cpp"
+
+// worst-case inputs for OpenAddressTable. hash_key is unseeded XXH64, so anyone
+// who can choose keys can brute-force collisions offline; these cases show what
+// that costs before the table is exposed to untrusted keys.
+//
+// every case reports the displacement the input actually produced
+// (probe_stats) next to the largest stored probe_dist_, and counts keys that
+// get() fails to find afterwards, which would expose a truncated distance field.
+
+// keys whose hash is zero in the low `bits` bits, brute-forced from a counter
+static std::vector<uint64_t> low_bit_collisions(size_t count, size_t bits) {
+    const uint64_t mask = (uint64_t(1) << bits) - 1;
+    std::vector<uint64_t> keys;
+    keys.reserve(count);
+    for (uint64_t key = 0; keys.size() < count; ++key) {
+        if ((OpenAddressTable::hash_key(key) & mask) == 0) {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+static void report_probes(benchmark::State& state, OpenAddressTable& hashmap, const std::vector<uint64_t>& keys) {
+    size_t stored_max = 0;
+    for (const auto& entry : hashmap.data_) {
+        if (entry.status_ == 2) {
+            stored_max = std::max<size_t>(stored_max, entry.probe_dist_);
+        }
+    }
+    size_t lost = 0;
+    for (auto key : keys) {
+        lost += !hashmap.get(key).has_value();
+    }
+
+    auto stats = hashmap.probe_stats();
+    state.counters["mean_dist"] = stats.mean_dist;
+    state.counters["max_dist"] = static_cast<double>(stats.max_dist);
+    state.counters["stored_max_dist"] = static_cast<double>(stored_max);
+    state.counters["longest_run"] = static_cast<double>(stats.longest_run);
+    state.counters["lost_keys"] = static_cast<double>(lost);
+}
+
+// range(0): number of low hash bits every key shares, 0 is the uniform baseline.
+// with b shared bits only one slot in 2^b can be a home, so runs grow roughly 2^b times longer
+static void BM_Adversarial_LowBitCollisions(benchmark::State& state) {
+    const size_t count = 1 << 16;
+    const auto keys = low_bit_collisions(count, state.range(0));
+    OpenAddressTable hashmap;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        hashmap = OpenAddressTable();
+        state.ResumeTiming();
+
+        for (auto key : keys) {
+            hashmap.insert(key, key);
+        }
+        for (auto key : keys) {
+            benchmark::DoNotOptimize(hashmap.get(key));
+        }
+        // misses walk the full run before the robin-hood early exit can fire
+        for (uint64_t i = 0; i < count; ++i) {
+            benchmark::DoNotOptimize(hashmap.get(~i));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * count * 3);
+    report_probes(state, hashmap, keys);
+}
+
+// the ProbeSequenceHandling test pattern at scale. these collide under an identity
+// hash, XXH64 scatters them, so this should track the uniform baseline
+static void BM_Adversarial_CapacityMultiples(benchmark::State& state) {
+    const size_t capacity = 1 << 20;
+    const size_t count = state.range(0);
+    std::vector<uint64_t> keys(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = i * capacity;
+    }
+    OpenAddressTable hashmap;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        hashmap = OpenAddressTable(capacity);
+        state.ResumeTiming();
+
+        for (auto key : keys) {
+            hashmap.insert(key, key);
+        }
+        for (auto key : keys) {
+            benchmark::DoNotOptimize(hashmap.get(key));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * count * 2);
+    report_probes(state, hashmap, keys);
+}
+
+// range(0): target displacement. d + 1 keys share one home slot, so the last one
+// lands d slots away. anything past 255 overflows an 8-bit distance field
+static void BM_Adversarial_LongProbe(benchmark::State& state) {
+    const size_t dist = state.range(0);
+    size_t capacity = 16;
+    while (capacity < 2 * (dist + 1)) capacity <<= 1;
+    const size_t home = capacity / 2;
+
+    std::vector<uint64_t> keys;
+    uint64_t miss = 0;
+    for (uint64_t key = 0; keys.size() <= dist || miss == 0; ++key) {
+        if ((OpenAddressTable::hash_key(key) & (capacity - 1)) == home) {
+            if (keys.size() <= dist) keys.push_back(key);
+            else miss = key;
+        }
+    }
+
+    OpenAddressTable hashmap(capacity);
+    for (auto key : keys) {
+        hashmap.insert(key, key);
+    }
+
+    // the deepest hit and a miss both scan the whole run
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hashmap.get(keys.back()));
+        benchmark::DoNotOptimize(hashmap.get(miss));
+    }
+
+    state.SetItemsProcessed(state.iterations() * 2);
+    report_probes(state, hashmap, keys);
+}
+
+BENCHMARK(BM_Adversarial_LowBitCollisions)
+        ->ArgName("bits")
+        ->Arg(0)
+        ->Arg(4)
+        ->Arg(6)
+        ->Arg(8)
+        ->Arg(10)
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_Adversarial_CapacityMultiples)
+        ->RangeMultiplier(4)
+        ->Range(1 << 12, 1 << 18)
+        ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_Adversarial_LongProbe)
+        ->ArgName("dist")
+        ->Arg(64)
+        ->Arg(255)
+        ->Arg(256)
+        ->Arg(1024)
+        ->Arg(4096);
+
+BENCHMARK_MAIN();
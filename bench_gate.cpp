@@ -0,0 +1,263 @@
+#define BENCHMARK_SUITE_NO_MAIN
+#include "benchmark.cpp"
+
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// usage: bench_gate [baseline.json] [--update] [google benchmark flags...]
+//
+// runs the benchmark.cpp suite and compares each benchmark's median_ns and
+// p95_ns counters (the Statistics computed over the measured runs) against a
+// committed baseline. a benchmark fails when its median regresses by more than
+// its threshold, or its p95 by more than twice that, since p95 over a handful
+// of runs is much noisier. --update rewrites the baseline from this run.
+//
+// baselines are only meaningful on the machine that recorded them, regenerate
+// with --update on the host that runs the gate.
+
+const char* DEFAULT_BASELINE = "baselines/benchmark_baseline.json";
+const double DEFAULT_THRESHOLD = 0.10;
+
+struct BaselineEntry {
+    double mean_ns = 0;
+    double median_ns = 0;
+    double p95_ns = 0;
+    double threshold = DEFAULT_THRESHOLD;
+};
+
+// just enough json for the baseline file: nested objects with string keys and number values
+class BaselineParser {
+public:
+    explicit BaselineParser(std::string text) : text_(std::move(text)), pos_(0) {}
+
+    std::map<std::string, BaselineEntry> parse() {
+        std::map<std::string, BaselineEntry> entries;
+        expect('{');
+        while (!consume('}')) {
+            std::string section = parse_string();
+            expect(':');
+            if (section == "benchmarks") {
+                expect('{');
+                while (!consume('}')) {
+                    std::string name = parse_string();
+                    expect(':');
+                    entries[name] = parse_entry();
+                    consume(',');
+                }
+            } else {
+                skip_value();
+            }
+            consume(',');
+        }
+        return entries;
+    }
+
+private:
+    std::string text_;
+    size_t pos_;
+
+    BaselineEntry parse_entry() {
+        BaselineEntry entry;
+        expect('{');
+        while (!consume('}')) {
+            std::string field = parse_string();
+            expect(':');
+            double value = parse_number();
+            if (field == "mean_ns") entry.mean_ns = value;
+            else if (field == "median_ns") entry.median_ns = value;
+            else if (field == "p95_ns") entry.p95_ns = value;
+            else if (field == "threshold") entry.threshold = value;
+            consume(',');
+        }
+        return entry;
+    }
+
+    void skip_ws() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+    }
+
+    bool consume(char c) {
+        skip_ws();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c)) {
+            throw std::runtime_error(std::string("baseline: expected '") + c + "' at offset " + std::to_string(pos_));
+        }
+    }
+
+    std::string parse_string() {
+        expect('"');
+        std::string out;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            if (text_[pos_] == '\\' && pos_ + 1 < text_.size()) ++pos_;
+            out += text_[pos_++];
+        }
+        expect('"');
+        return out;
+    }
+
+    double parse_number() {
+        skip_ws();
+        size_t used = 0;
+        double value = std::stod(text_.substr(pos_), &used);
+        pos_ += used;
+        return value;
+    }
+
+    void skip_value() {
+        skip_ws();
+        if (text_[pos_] == '"') {
+            parse_string();
+        } else if (text_[pos_] == '{') {
+            expect('{');
+            while (!consume('}')) {
+                parse_string();
+                expect(':');
+                skip_value();
+                consume(',');
+            }
+        } else {
+            parse_number();
+        }
+    }
+};
+
+// keeps the console output google benchmark normally prints and collects the Statistics counters
+class GateReporter : public benchmark::ConsoleReporter {
+public:
+    std::map<std::string, BaselineEntry> results;
+
+    void ReportRuns(const std::vector<Run>& runs) override {
+        ConsoleReporter::ReportRuns(runs);
+        for (const auto& run : runs) {
+            if (run.run_type != Run::RT_Iteration) continue;
+            auto counter = [&](const char* name) {
+                auto it = run.counters.find(name);
+                return it == run.counters.end() ? 0.0 : it->second.value;
+            };
+            results[run.benchmark_name()] = {counter("mean_ns"), counter("median_ns"), counter("p95_ns")};
+        }
+    }
+};
+
+static void write_baseline(const std::string& path, const std::map<std::string, BaselineEntry>& results,
+                           const std::map<std::string, BaselineEntry>& previous) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("failed to write baseline: " + path);
+    }
+    out << "{\n  \"benchmarks\": {\n" << std::fixed << std::setprecision(2);
+    size_t i = 0;
+    for (const auto& [name, entry] : results) {
+        // hand-tuned thresholds survive a baseline refresh
+        auto it = previous.find(name);
+        double threshold = it == previous.end() ? DEFAULT_THRESHOLD : it->second.threshold;
+        out << "    \"" << name << "\": {\"mean_ns\": " << entry.mean_ns
+            << ", \"median_ns\": " << entry.median_ns
+            << ", \"p95_ns\": " << entry.p95_ns
+            << ", \"threshold\": " << threshold << "}"
+            << (++i < results.size() ? ",\n" : "\n");
+    }
+    out << "  }\n}\n";
+}
+
+static double delta(double current, double baseline) {
+    return baseline == 0 ? 0 : current / baseline - 1.0;
+}
+
+int main(int argc, char* argv[]) {
+    std::string baseline_path = DEFAULT_BASELINE;
+    bool update = false;
+
+    // our own arguments are stripped before handing the rest to google benchmark
+    std::vector<char*> passthrough{argv[0]};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--update") update = true;
+        else if (arg.rfind("--", 0) == 0) passthrough.push_back(argv[i]);
+        else baseline_path = arg;
+    }
+    int bench_argc = static_cast<int>(passthrough.size());
+    benchmark::Initialize(&bench_argc, passthrough.data());
+
+    std::map<std::string, BaselineEntry> baseline;
+    {
+        std::ifstream in(baseline_path);
+        if (in) {
+            std::stringstream text;
+            text << in.rdbuf();
+            baseline = BaselineParser(text.str()).parse();
+        } else if (!update) {
+            std::cerr << "no baseline at " << baseline_path << ", run with --update to record one\n";
+            return 2;
+        }
+    }
+
+    GateReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+
+    if (update) {
+        write_baseline(baseline_path, reporter.results, baseline);
+        std::cout << "\nwrote " << reporter.results.size() << " baselines to " << baseline_path << "\n";
+        return 0;
+    }
+
+    std::cout << "\n" << std::left << std::setw(60) << "benchmark"
+              << std::right << std::setw(10) << "metric" << std::setw(12) << "baseline"
+              << std::setw(12) << "current" << std::setw(10) << "delta" << std::setw(8) << "limit"
+              << "  result\n";
+
+    size_t failures = 0;
+    for (const auto& [name, current] : reporter.results) {
+        auto it = baseline.find(name);
+        if (it == baseline.end()) {
+            std::cout << std::left << std::setw(60) << name << std::right
+                      << "  (no baseline, skipped)\n";
+            continue;
+        }
+        const auto& base = it->second;
+
+        struct Check { const char* metric; double base; double current; double limit; bool gated; };
+        const Check checks[] = {
+                {"median", base.median_ns, current.median_ns, base.threshold, true},
+                {"p95", base.p95_ns, current.p95_ns, base.threshold * 2, true},
+                {"mean", base.mean_ns, current.mean_ns, base.threshold, false},
+        };
+
+        for (const auto& check : checks) {
+            const double d = delta(check.current, check.base);
+            const bool failed = check.gated && d > check.limit;
+            failures += failed;
+            std::cout << std::left << std::setw(60) << name << std::right
+                      << std::setw(10) << check.metric
+                      << std::setw(12) << std::fixed << std::setprecision(2) << check.base
+                      << std::setw(12) << check.current
+                      << std::setw(9) << std::showpos << std::setprecision(1) << d * 100 << "%"
+                      << std::setw(7) << std::noshowpos << check.limit * 100 << "%"
+                      << "  " << (!check.gated ? "info" : failed ? "FAIL" : "pass") << "\n";
+        }
+    }
+
+    for (const auto& [name, base] : baseline) {
+        if (reporter.results.find(name) == reporter.results.end()) {
+            std::cout << std::left << std::setw(60) << name << std::right << "  (in baseline, not run)\n";
+        }
+    }
+
+    std::cout << "\n" << (failures == 0 ? "PASS" : "FAIL") << ": " << failures << " regression(s)\n";
+    return failures == 0 ? 0 : 1;
+}
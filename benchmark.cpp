@@ -1,48 +1,21 @@
 #include <benchmark/benchmark.h>
+#include <chrono>
 #include <random>
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
 #include <numeric>
 #include "table.cpp"
+#include "stats.cpp"
 
 const size_t NUM_OPERATIONS = 10'000'000;
 const size_t INITIAL_SIZE = 1'000'000;
 const size_t WARMUP_RUNS = 3;
 
-struct Statistics {
-    double mean;
-    double median;
-    double p95;
-    double min;
-    double max;
-};
-
-Statistics calculate_stats(std::vector<double>& measurements) {
-    if (measurements.empty()) return {0, 0, 0, 0, 0};
-
-    std::sort(measurements.begin(), measurements.end());
-
-    double sum = std::accumulate(measurements.begin(), measurements.end(), 0.0);
-    double mean = sum / measurements.size();
-    double median = measurements.size() % 2 == 0
-                    ? (measurements[measurements.size()/2 - 1] + measurements[measurements.size()/2]) / 2
-                    : measurements[measurements.size()/2];
-
-    size_t p95_index = static_cast<size_t>(measurements.size() * 0.95);
-    double p95 = measurements[p95_index];
-
-    return {
-            mean,
-            median,
-            p95,
-            measurements.front(),
-            measurements.back()
-    };
-}
-
 static void BM_OpenAddressTable_MixedWithWarmup(benchmark::State& state) {
     std::vector<double> measurements;
+    // state.iterations() is only updated once the loop finishes, so count runs ourselves
+    size_t run = 0;
 
     for (auto _ : state) {
         state.PauseTiming();
@@ -76,7 +49,7 @@ static void BM_OpenAddressTable_MixedWithWarmup(benchmark::State& state) {
                 end - start).count() / static_cast<double>(NUM_OPERATIONS);
 
         // Only store measurements after warmup
-        if (state.iterations() > WARMUP_RUNS) {
+        if (run++ >= WARMUP_RUNS) {
             measurements.push_back(duration);
         }
 
@@ -95,6 +68,8 @@ static void BM_OpenAddressTable_MixedWithWarmup(benchmark::State& state) {
 // Benchmark for std::unordered_map with warmup
 static void BM_UnorderedMap_MixedWithWarmup(benchmark::State& state) {
     std::vector<double> measurements;
+    // state.iterations() is only updated once the loop finishes, so count runs ourselves
+    size_t run = 0;
 
     for (auto _ : state) {
         state.PauseTiming();
@@ -129,7 +104,7 @@ static void BM_UnorderedMap_MixedWithWarmup(benchmark::State& state) {
                 end - start).count() / static_cast<double>(NUM_OPERATIONS);
 
         // Only store measurements after warmup
-        if (state.iterations() > WARMUP_RUNS) {
+        if (run++ >= WARMUP_RUNS) {
             measurements.push_back(duration);
         }
 
@@ -156,4 +131,7 @@ BENCHMARK(BM_UnorderedMap_MixedWithWarmup)
         ->Iterations(WARMUP_RUNS + 5)  // 3 warmup + 5 measured runs
         ->UseRealTime();
 
-BENCHMARK_MAIN();
\ No newline at end of file
+// bench_gate.cpp includes this file to run the same suite under its own main
+#ifndef BENCHMARK_SUITE_NO_MAIN
+BENCHMARK_MAIN();
+#endif
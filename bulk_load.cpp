@@ -0,0 +1,315 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "table.cpp"
+
+// bulk loading (key, value) pairs from a file into a table.
+//   binary: consecutive little-endian u64 key, u64 val pairs, no header
+//   csv:    one "key,val" per line in decimal; \r\n endings, a trailing line
+//           without a newline and blank lines are accepted
+// a reader thread fills large buffers with sequential reads while the caller's
+// thread parses the previous one and feeds insert_batch, so the disk and the
+// table are busy at the same time. the table is presized once up front: exactly
+// for binary, from the line length of the first buffer for csv.
+
+enum class BulkFormat {
+    Binary,
+    Csv
+};
+
+struct BulkLoadStats {
+    size_t records_;
+    size_t bytes_;
+};
+
+class BulkLoader {
+public:
+    // bytes per read; two buffers are in flight
+    static constexpr size_t DEFAULT_CHUNK_BYTES = 8 << 20;
+    // parsed pairs handed to insert_batch at a time
+    static constexpr size_t INSERT_BATCH = 1024;
+
+    BulkLoader(const std::string& path, BulkFormat format, size_t chunk_bytes = DEFAULT_CHUNK_BYTES)
+            : path_(path), format_(format), chunk_bytes_(chunk_bytes) {
+        fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        struct stat st;
+        file_bytes_ = fstat(fd_, &st) == 0 ? st.st_size : 0;
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    ~BulkLoader() {
+        close(fd_);
+    }
+
+    BulkLoader(const BulkLoader&) = delete;
+    BulkLoader& operator=(const BulkLoader&) = delete;
+
+    BulkLoadStats load_into(OpenAddressTable& table) {
+        if (format_ == BulkFormat::Binary) {
+            if (file_bytes_ % 16 != 0) {
+                throw std::runtime_error("binary bulk file is not whole key/value pairs: " + path_);
+            }
+            table.reserve(table.size() + file_bytes_ / 16);
+        }
+
+        keys_.resize(INSERT_BATCH);
+        vals_.resize(INSERT_BATCH);
+        pending_ = 0;
+        line_ = 1;
+        records_ = 0;
+        presized_ = format_ == BulkFormat::Binary;
+
+        // the reader fills buffers_[i % 2]; each one is handed over through ready_
+        buffers_[0].resize(chunk_bytes_);
+        buffers_[1].resize(chunk_bytes_);
+        filled_[0] = filled_[1] = 0;
+        ready_[0] = ready_[1] = false;
+        done_ = false;
+        read_error_ = 0;
+        std::thread reader([this] { read_loop(); });
+
+        std::string carry;
+        size_t bytes = 0;
+        try {
+            for (size_t i = 0;; i++) {
+                const size_t slot = i % 2;
+                size_t filled;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_.wait(lock, [&] { return ready_[slot] || done_ || read_error_ != 0; });
+                    if (read_error_ != 0) {
+                        throw std::system_error(read_error_, std::generic_category(), "read " + path_);
+                    }
+                    if (!ready_[slot]) {
+                        break;
+                    }
+                    filled = filled_[slot];
+                }
+                bytes += filled;
+                consume(table, buffers_[slot].data(), filled, carry);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    ready_[slot] = false;
+                }
+                cv_.notify_all();
+            }
+        } catch (...) {
+            stop_reader(reader);
+            throw;
+        }
+        stop_reader(reader);
+
+        if (!carry.empty()) {
+            if (format_ == BulkFormat::Binary) {
+                throw std::runtime_error("binary bulk file ends mid-pair: " + path_);
+            }
+            parse_line(carry.data(), carry.data() + carry.size());
+        }
+        flush(table);
+        return {records_, bytes};
+    }
+
+private:
+    std::string path_;
+    BulkFormat format_;
+    size_t chunk_bytes_;
+    int fd_;
+    size_t file_bytes_;
+
+    std::vector<uint64_t> keys_;
+    std::vector<uint64_t> vals_;
+    size_t pending_;
+    size_t line_;
+    size_t records_;
+    bool presized_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<char> buffers_[2];
+    size_t filled_[2];
+    bool ready_[2];
+    bool done_;
+    bool stop_ = false;
+    int read_error_;
+
+    void read_loop() {
+        for (size_t i = 0;; i++) {
+            const size_t slot = i % 2;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return !ready_[slot] || stop_; });
+                if (stop_) return;
+            }
+            size_t filled = 0;
+            int error = 0;
+            while (filled < chunk_bytes_) {
+                ssize_t n = read(fd_, buffers_[slot].data() + filled, chunk_bytes_ - filled);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    error = errno;
+                    break;
+                }
+                if (n == 0) break;
+                filled += n;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (error != 0) {
+                    read_error_ = error;
+                } else if (filled > 0) {
+                    filled_[slot] = filled;
+                    ready_[slot] = true;
+                }
+                if (error != 0 || filled < chunk_bytes_) {
+                    done_ = true;
+                }
+            }
+            cv_.notify_all();
+            if (error != 0 || filled < chunk_bytes_) return;
+        }
+    }
+
+    void stop_reader(std::thread& reader) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        reader.join();
+        stop_ = false;
+    }
+
+    // parses one buffer; a record cut off at its end is kept in carry for the next
+    void consume(OpenAddressTable& table, const char* data, size_t len, std::string& carry) {
+        const char* p = data;
+        const char* end = data + len;
+
+        if (format_ == BulkFormat::Binary) {
+            if (!carry.empty()) {
+                const size_t need = std::min<size_t>(16 - carry.size(), len);
+                carry.append(p, need);
+                p += need;
+                if (carry.size() == 16) {
+                    add_pair(table, carry.data());
+                    carry.clear();
+                }
+            }
+            for (; p + 16 <= end; p += 16) {
+                add_pair(table, p);
+            }
+            carry.append(p, end);
+            return;
+        }
+
+        if (!presized_) {
+            presize_csv(table, data, len);
+        }
+        if (!carry.empty()) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', len));
+            if (newline == nullptr) {
+                carry.append(p, end);
+                return;
+            }
+            carry.append(p, newline);
+            parse_line(carry.data(), carry.data() + carry.size());
+            carry.clear();
+            p = newline + 1;
+            maybe_flush(table);
+        }
+        // memchr is vectorised in libc, so finding line ends runs at memory speed
+        // and the per-line work is only the two digit loops
+        while (p < end) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (newline == nullptr) {
+                carry.assign(p, end);
+                return;
+            }
+            parse_line(p, newline);
+            p = newline + 1;
+            maybe_flush(table);
+        }
+    }
+
+    void add_pair(OpenAddressTable& table, const char* p) {
+        std::memcpy(&keys_[pending_], p, 8);
+        std::memcpy(&vals_[pending_], p + 8, 8);
+        ++pending_;
+        maybe_flush(table);
+    }
+
+    void parse_line(const char* p, const char* end) {
+        if (end > p && end[-1] == '\r') {
+            --end;
+        }
+        if (p == end) {
+            ++line_;
+            return;
+        }
+        const char* comma = parse_decimal(p, end, keys_[pending_]);
+        if (comma == end || *comma != ',' || comma == p ||
+            parse_decimal(comma + 1, end, vals_[pending_]) != end || comma + 1 == end) {
+            throw std::runtime_error("malformed csv line " + std::to_string(line_) + " in " + path_);
+        }
+        ++pending_;
+        ++line_;
+    }
+
+    // returns the first non-digit; overflow is reported by returning p
+    static const char* parse_decimal(const char* p, const char* end, uint64_t& out) {
+        const char* start = p;
+        uint64_t value = 0;
+        for (; p < end; ++p) {
+            const unsigned digit = static_cast<unsigned char>(*p) - '0';
+            if (digit > 9) break;
+            if (__builtin_mul_overflow(value, 10, &value) || __builtin_add_overflow(value, digit, &value)) {
+                return start;
+            }
+        }
+        out = value;
+        return p;
+    }
+
+    // a 10% margin over the record count the first buffer's line length implies
+    void presize_csv(OpenAddressTable& table, const char* data, size_t len) {
+        presized_ = true;
+        size_t lines = 0;
+        for (const char* p = data; (p = static_cast<const char*>(std::memchr(p, '\n', data + len - p))) != nullptr; ++p) {
+            ++lines;
+        }
+        if (lines > 0) {
+            const double line_bytes = static_cast<double>(len) / lines;
+            table.reserve(table.size() + static_cast<size_t>(file_bytes_ / line_bytes * 1.1));
+        }
+    }
+
+    void maybe_flush(OpenAddressTable& table) {
+        if (pending_ == INSERT_BATCH) {
+            flush(table);
+        }
+    }
+
+    void flush(OpenAddressTable& table) {
+        table.insert_batch(keys_.data(), vals_.data(), pending_);
+        records_ += pending_;
+        pending_ = 0;
+    }
+};
+
+inline BulkLoadStats bulk_load(OpenAddressTable& table, const std::string& path, BulkFormat format,
+                               size_t chunk_bytes = BulkLoader::DEFAULT_CHUNK_BYTES) {
+    BulkLoader loader(path, format, chunk_bytes);
+    return loader.load_into(table);
+}
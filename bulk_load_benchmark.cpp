@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "bulk_load.cpp"
+
+// usage: bulk_load_benchmark [dir=/tmp] [rows=20000000]
+//
+// writes `rows` random pairs as csv and as binary, then loads each file the
+// straightforward way (istream parsing, one insert per row into a table that
+// doubles as it goes) and with bulk_load. the files are read once beforehand
+// so both runs start from a warm page cache
+
+const size_t DEFAULT_ROWS = 20'000'000;
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void warm(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> buffer(1 << 20);
+    while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
+    }
+}
+
+static void report(const std::string& name, size_t rows, double seconds, size_t size) {
+    std::cout << std::setw(16) << name << std::setw(10) << std::fixed << std::setprecision(2) << seconds
+              << std::setw(14) << std::setprecision(0) << rows / seconds << std::setw(12) << size << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    const std::string dir = argc > 1 ? argv[1] : "/tmp";
+    const size_t rows = argc > 2 ? std::stoull(argv[2]) : DEFAULT_ROWS;
+    const std::string csv_path = dir + "/bulk_load_benchmark.csv";
+    const std::string binary_path = dir + "/bulk_load_benchmark.bin";
+
+    {
+        std::ofstream csv(csv_path, std::ios::trunc);
+        std::ofstream binary(binary_path, std::ios::binary | std::ios::trunc);
+        std::mt19937_64 gen(42);
+        for (size_t i = 0; i < rows; i++) {
+            const uint64_t pair[2] = {gen(), i};
+            csv << pair[0] << ',' << pair[1] << '\n';
+            binary.write(reinterpret_cast<const char*>(pair), sizeof(pair));
+        }
+    }
+    warm(csv_path);
+    warm(binary_path);
+
+    std::cout << std::setw(16) << "loader" << std::setw(10) << "seconds" << std::setw(14) << "rows/s"
+              << std::setw(12) << "size" << "\n";
+
+    {
+        auto start = Clock::now();
+        OpenAddressTable table;
+        std::ifstream in(csv_path);
+        uint64_t key, val;
+        char comma;
+        while (in >> key >> comma >> val) {
+            table.insert(key, val);
+        }
+        report("csv istream", rows, seconds_since(start), table.size());
+    }
+    {
+        auto start = Clock::now();
+        OpenAddressTable table;
+        bulk_load(table, csv_path, BulkFormat::Csv);
+        report("csv bulk_load", rows, seconds_since(start), table.size());
+    }
+    {
+        auto start = Clock::now();
+        OpenAddressTable table;
+        std::ifstream in(binary_path, std::ios::binary);
+        uint64_t pair[2];
+        while (in.read(reinterpret_cast<char*>(pair), sizeof(pair))) {
+            table.insert(pair[0], pair[1]);
+        }
+        report("binary read", rows, seconds_since(start), table.size());
+    }
+    {
+        auto start = Clock::now();
+        OpenAddressTable table;
+        bulk_load(table, binary_path, BulkFormat::Binary);
+        report("binary bulk_load", rows, seconds_since(start), table.size());
+    }
+
+    std::remove(csv_path.c_str());
+    std::remove(binary_path.c_str());
+    return 0;
+}
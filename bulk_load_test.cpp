@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include "bulk_load.cpp"
+
+class BulkLoadTest : public ::testing::Test {
+protected:
+    std::string path;
+
+    void SetUp() override {
+        path = ::testing::TempDir() + "oat_bulk_load_test.dat";
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+
+    void write_file(const std::string& contents) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), contents.size());
+    }
+};
+
+TEST_F(BulkLoadTest, LoadsBinaryPairs) {
+    std::mt19937_64 gen(42);
+    std::vector<uint64_t> pairs;
+    for (size_t i = 0; i < 100000; i++) {
+        pairs.push_back(gen());
+        pairs.push_back(i);
+    }
+    write_file(std::string(reinterpret_cast<const char*>(pairs.data()), pairs.size() * 8));
+
+    OpenAddressTable table;
+    // an odd chunk size splits pairs across buffers
+    auto stats = bulk_load(table, path, BulkFormat::Binary, 4099);
+    EXPECT_EQ(stats.records_, 100000);
+    EXPECT_EQ(stats.bytes_, pairs.size() * 8);
+    EXPECT_EQ(table.size(), 100000);
+    for (size_t i = 0; i < pairs.size(); i += 2) {
+        ASSERT_EQ(table.get(pairs[i]), std::optional<uint64_t>(pairs[i + 1]));
+    }
+}
+
+TEST_F(BulkLoadTest, LoadsCsvAcrossChunkBoundaries) {
+    std::string csv;
+    for (uint64_t key = 0; key < 20000; key++) {
+        csv += std::to_string(key * 1000003) + "," + std::to_string(key) + (key % 3 == 0 ? "\r\n" : "\n");
+        if (key % 1000 == 0) csv += "\n";
+    }
+    csv += std::to_string(UINT64_MAX) + ",7";
+    write_file(csv);
+
+    for (size_t chunk : {size_t(5), size_t(4096), BulkLoader::DEFAULT_CHUNK_BYTES}) {
+        OpenAddressTable table;
+        auto stats = bulk_load(table, path, BulkFormat::Csv, chunk);
+        EXPECT_EQ(stats.records_, 20001);
+        EXPECT_EQ(table.size(), 20001);
+        EXPECT_EQ(table.get(UINT64_MAX), std::optional<uint64_t>(7));
+        for (uint64_t key = 0; key < 20000; key++) {
+            ASSERT_EQ(table.get(key * 1000003), std::optional<uint64_t>(key));
+        }
+    }
+}
+
+TEST_F(BulkLoadTest, CsvPresizesTable) {
+    std::string csv;
+    for (uint64_t key = 0; key < 50000; key++) {
+        csv += std::to_string(key) + "," + std::to_string(key) + "\n";
+    }
+    write_file(csv);
+
+    OpenAddressTable table;
+    bulk_load(table, path, BulkFormat::Csv, 64 << 10);
+    // reserved from the first 64 KiB, so no doubling happened on the way
+    OpenAddressTable reserved;
+    reserved.reserve(50000);
+    EXPECT_LE(table.capacity(), reserved.capacity() * 2);
+    EXPECT_EQ(table.size(), 50000);
+}
+
+TEST_F(BulkLoadTest, RejectsMalformedInput) {
+    write_file("1,2\n3;4\n");
+    OpenAddressTable table;
+    EXPECT_THROW(bulk_load(table, path, BulkFormat::Csv), std::runtime_error);
+
+    write_file("1,2\n18446744073709551616,1\n");
+    EXPECT_THROW(bulk_load(table, path, BulkFormat::Csv), std::runtime_error);
+
+    write_file("1,\n");
+    EXPECT_THROW(bulk_load(table, path, BulkFormat::Csv), std::runtime_error);
+
+    write_file(std::string(24, '\0'));
+    EXPECT_THROW(bulk_load(table, path, BulkFormat::Binary), std::runtime_error);
+
+    EXPECT_THROW(bulk_load(table, path + ".missing", BulkFormat::Binary), std::system_error);
+}
@@ -0,0 +1,363 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "table.cpp"
+
+// change data capture: ChangeFeedTable publishes every mutation of its table,
+// numbered from 1, into a ChangeRing, and a ReplicaFollower drains the ring
+// into a replica table. a replica seeded from a snapshot taken at sequence n
+// follows from n + 1 instead of being recopied.
+//
+// the ring is single producer, single consumer and lock free: the producer
+// only writes head_ and the consumer only writes tail_. it lives in a MAP_SHARED
+// mapping, so a ring made before fork() or opened by name from another process
+// works the same as one shared between threads.
+
+enum class ChangeOp : uint32_t {
+    Insert = 1,
+    Update = 2,
+    Erase = 3
+};
+
+struct ChangeRecord {
+    uint64_t seq_;
+    uint64_t key_;
+    uint64_t val_;
+    ChangeOp op_;
+    uint32_t reserved_;
+};
+
+class ChangeRing {
+public:
+    // anonymous shared memory, inherited across fork()
+    explicit ChangeRing(size_t capacity) {
+        map(-1, round_capacity(capacity), true);
+    }
+
+    // named shared memory another process can open_shared(); unlink it once every side is attached
+    static std::unique_ptr<ChangeRing> create_shared(const std::string& name, size_t capacity) {
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        capacity = round_capacity(capacity);
+        if (ftruncate(fd, bytes_for(capacity)) < 0) {
+            const int error = errno;
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+        }
+        std::unique_ptr<ChangeRing> ring(new ChangeRing());
+        ring->map(fd, capacity, true);
+        close(fd);
+        return ring;
+    }
+
+    static std::unique_ptr<ChangeRing> open_shared(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        // a ring whose creator has not written the header yet reads as capacity 0
+        Header header;
+        struct stat st;
+        const bool valid =
+                pread(fd, &header.capacity_, sizeof(header.capacity_), offsetof(Header, capacity_)) ==
+                        sizeof(header.capacity_) &&
+                fstat(fd, &st) == 0 && header.capacity_ != 0 && (header.capacity_ & (header.capacity_ - 1)) == 0 &&
+                header.capacity_ <= static_cast<uint64_t>(st.st_size) / sizeof(ChangeRecord) &&
+                static_cast<uint64_t>(st.st_size) == bytes_for(header.capacity_);
+        if (!valid) {
+            close(fd);
+            throw std::runtime_error("not an initialized change ring: " + name);
+        }
+        std::unique_ptr<ChangeRing> ring(new ChangeRing());
+        ring->map(fd, header.capacity_, false);
+        close(fd);
+        return ring;
+    }
+
+    static void unlink_shared(const std::string& name) {
+        shm_unlink(name.c_str());
+    }
+
+    ~ChangeRing() {
+        munmap(header_, bytes_for(capacity_));
+    }
+
+    ChangeRing(const ChangeRing&) = delete;
+    ChangeRing& operator=(const ChangeRing&) = delete;
+
+    // producer side; false when the consumer is a full ring behind
+    bool try_push(const ChangeRecord& record) {
+        const uint64_t head = header_->head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ == capacity_) {
+            cached_tail_ = header_->tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ == capacity_) {
+                return false;
+            }
+        }
+        slots_[head & (capacity_ - 1)] = record;
+        header_->head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // waits for room rather than dropping, so the consumer never sees a gap
+    void push(const ChangeRecord& record) {
+        for (size_t spins = 0; !try_push(record); ++spins) {
+            if (spins < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    }
+
+    // consumer side; copies up to max records into out and returns how many
+    size_t pop(ChangeRecord* out, size_t max) {
+        const uint64_t tail = header_->tail_.load(std::memory_order_relaxed);
+        if (cached_head_ == tail) {
+            cached_head_ = header_->head_.load(std::memory_order_acquire);
+        }
+        const size_t count = std::min<uint64_t>(cached_head_ - tail, max);
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = slots_[(tail + i) & (capacity_ - 1)];
+        }
+        header_->tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // records published and not yet consumed
+    size_t pending() const {
+        return header_->head_.load(std::memory_order_acquire) - header_->tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct Header {
+        uint64_t capacity_;
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head_;
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail_;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring is shared between processes");
+
+    Header* header_ = nullptr;
+    ChangeRecord* slots_ = nullptr;
+    size_t capacity_ = 0;
+    // each side's last view of the other's index, so the shared line is only read when needed
+    uint64_t cached_tail_ = 0;
+    uint64_t cached_head_ = 0;
+
+    ChangeRing() = default;
+
+    static size_t round_capacity(size_t capacity) {
+        size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded *= 2;
+        }
+        return rounded;
+    }
+
+    static size_t bytes_for(size_t capacity) {
+        return sizeof(Header) + capacity * sizeof(ChangeRecord);
+    }
+
+    void map(int fd, size_t capacity, bool initialize) {
+        void* memory = mmap(nullptr, bytes_for(capacity), PROT_READ | PROT_WRITE,
+                            fd < 0 ? MAP_SHARED | MAP_ANONYMOUS : MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap change ring");
+        }
+        header_ = static_cast<Header*>(memory);
+        slots_ = reinterpret_cast<ChangeRecord*>(static_cast<char*>(memory) + sizeof(Header));
+        capacity_ = capacity;
+        if (initialize) {
+            new (header_) Header{capacity, {0}, {0}};
+        }
+        cached_tail_ = header_->tail_.load(std::memory_order_acquire);
+        cached_head_ = header_->head_.load(std::memory_order_acquire);
+    }
+};
+
+// a table that publishes its mutations. like OpenAddressTable it has one writer;
+// the ring's consumer may be on any thread or process
+class ChangeFeedTable {
+public:
+    explicit ChangeFeedTable(ChangeRing& ring, size_t initial_size = 64, uint64_t seq = 0)
+            : ring_(ring), table_(initial_size), seq_(seq) {}
+
+    bool insert(uint64_t key, uint64_t val) {
+        const size_t before = table_.size();
+        const bool result = table_.insert(key, val);
+        ring_.push({++seq_, key, val, table_.size() > before ? ChangeOp::Insert : ChangeOp::Update, 0});
+        return result;
+    }
+
+    std::optional<uint64_t> get(uint64_t key) {
+        return table_.get(key);
+    }
+
+    // only erases that removed something are published
+    bool erase(uint64_t key) {
+        if (!table_.erase(key)) {
+            return false;
+        }
+        ring_.push({++seq_, key, 0, ChangeOp::Erase, 0});
+        return true;
+    }
+
+    // sequence number of the last published change; a snapshot of table() taken
+    // now is what a follower starting at seq() + 1 expects
+    uint64_t seq() const { return seq_; }
+
+    const OpenAddressTable& table() const { return table_; }
+
+    size_t size() const { return table_.size(); }
+
+private:
+    ChangeRing& ring_;
+    OpenAddressTable table_;
+    uint64_t seq_;
+};
+
+// applies a change feed to a replica. runs of inserts and updates go through
+// insert_batch; an erase ends the run, so changes land in feed order
+class ReplicaFollower {
+public:
+    static constexpr size_t DEFAULT_BATCH = 1024;
+
+    // applied_seq is the sequence number the replica already reflects
+    ReplicaFollower(ChangeRing& ring, OpenAddressTable& replica, uint64_t applied_seq = 0,
+                    size_t batch = DEFAULT_BATCH)
+            : ring_(ring), replica_(replica), applied_seq_(applied_seq), applied_(applied_seq), records_(batch) {
+        keys_.reserve(batch);
+        vals_.reserve(batch);
+    }
+
+    ~ReplicaFollower() {
+        join();
+    }
+
+    ReplicaFollower(const ReplicaFollower&) = delete;
+    ReplicaFollower& operator=(const ReplicaFollower&) = delete;
+
+    // applies what the ring holds, at most one batch, and returns how many
+    // changes that was. records at or below applied_seq() are skipped; a jump
+    // past applied_seq() + 1 means changes were lost and the replica needs a resync
+    size_t poll() {
+        const size_t count = ring_.pop(records_.data(), records_.size());
+        for (size_t i = 0; i < count; ++i) {
+            const ChangeRecord& record = records_[i];
+            if (record.seq_ <= applied_seq_) {
+                continue;
+            }
+            if (record.seq_ != applied_seq_ + 1) {
+                flush();
+                throw std::runtime_error("change feed gap after seq " + std::to_string(applied_seq_));
+            }
+            if (record.op_ == ChangeOp::Erase) {
+                flush();
+                replica_.erase(record.key_);
+            } else {
+                keys_.push_back(record.key_);
+                vals_.push_back(record.val_);
+            }
+            applied_seq_ = record.seq_;
+        }
+        flush();
+        applied_.store(applied_seq_, std::memory_order_release);
+        return count;
+    }
+
+    // polls on a background thread until stop(); the replica must not be touched
+    // by other threads meanwhile except through applied()
+    void start() {
+        stopping_.store(false, std::memory_order_relaxed);
+        thread_ = std::thread([this] {
+            size_t idle = 0;
+            while (!stopping_.load(std::memory_order_relaxed)) {
+                try {
+                    if (poll() > 0) {
+                        idle = 0;
+                    } else if (++idle < 64) {
+                        std::this_thread::yield();
+                    } else {
+                        std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    }
+                } catch (...) {
+                    error_ = std::current_exception();
+                    return;
+                }
+            }
+        });
+    }
+
+    // stops the background thread, then rethrows what stopped it early, if anything
+    void stop() {
+        join();
+        if (error_) {
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+    }
+
+    // drains the ring until the replica reflects target_seq
+    void catch_up(uint64_t target_seq) {
+        while (applied_seq_ < target_seq) {
+            if (poll() == 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    uint64_t applied_seq() const { return applied_seq_; }
+
+    // applied_seq() for other threads while the follower runs in the background
+    uint64_t applied() const { return applied_.load(std::memory_order_acquire); }
+
+private:
+    ChangeRing& ring_;
+    OpenAddressTable& replica_;
+    uint64_t applied_seq_;
+    std::atomic<uint64_t> applied_;
+    std::vector<ChangeRecord> records_;
+    std::vector<uint64_t> keys_;
+    std::vector<uint64_t> vals_;
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+    std::exception_ptr error_;
+
+    void join() {
+        if (thread_.joinable()) {
+            stopping_.store(true, std::memory_order_relaxed);
+            thread_.join();
+        }
+    }
+
+    void flush() {
+        replica_.insert_batch(keys_.data(), vals_.data(), keys_.size());
+        keys_.clear();
+        vals_.clear();
+    }
+};
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include "change_feed.cpp"
+
+// usage: change_feed_benchmark [keys=1000000] [changes=10000000] [ring=65536]
+//
+// applies `changes` random updates over `keys` keys to a plain table and to a
+// ChangeFeedTable with a follower thread, then compares keeping the replica
+// current through the feed with recopying the whole table once
+
+const size_t DEFAULT_KEYS = 1'000'000;
+const size_t DEFAULT_CHANGES = 10'000'000;
+const size_t DEFAULT_RING = 65536;
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void report(const std::string& name, size_t ops, double seconds) {
+    std::cout << std::setw(20) << name << std::setw(10) << std::fixed << std::setprecision(3) << seconds
+              << std::setw(14) << std::setprecision(0) << ops / seconds << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    const size_t keys = argc > 1 ? std::stoull(argv[1]) : DEFAULT_KEYS;
+    const size_t changes = argc > 2 ? std::stoull(argv[2]) : DEFAULT_CHANGES;
+    const size_t ring_capacity = argc > 3 ? std::stoull(argv[3]) : DEFAULT_RING;
+
+    std::cout << std::setw(20) << "run" << std::setw(10) << "seconds" << std::setw(14) << "ops/s" << "\n";
+    {
+        OpenAddressTable table;
+        std::mt19937_64 gen(42);
+        auto start = Clock::now();
+        for (size_t i = 0; i < changes; i++) {
+            table.insert(gen() % keys, i);
+        }
+        report("no feed", changes, seconds_since(start));
+    }
+
+    ChangeRing ring(ring_capacity);
+    ChangeFeedTable primary(ring);
+    OpenAddressTable replica;
+    ReplicaFollower follower(ring, replica);
+    follower.start();
+    std::mt19937_64 gen(42);
+    auto start = Clock::now();
+    for (size_t i = 0; i < changes; i++) {
+        primary.insert(gen() % keys, i);
+    }
+    const double produced = seconds_since(start);
+    while (follower.applied() < primary.seq()) {
+        std::this_thread::yield();
+    }
+    report("feed + follower", changes, produced);
+    report("replica caught up", changes, seconds_since(start));
+    follower.stop();
+
+    // the alternative the feed replaces: a full copy of the primary
+    start = Clock::now();
+    OpenAddressTable copy(primary.table().capacity());
+    for (const auto& entry : primary.table().data_) {
+        if (entry.status_ == 2) copy.insert(entry.key_, entry.val_);
+    }
+    report("full resync", primary.size(), seconds_since(start));
+    return replica.size() == primary.size() ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <sys/wait.h>
+#include "change_feed.cpp"
+
+static bool same_contents(const OpenAddressTable& a, OpenAddressTable& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (const auto& entry : a.data_) {
+        if (entry.status_ == 2 && b.get(entry.key_) != std::optional<uint64_t>(entry.val_)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(ChangeRingTest, WrapsAndRefusesWhenFull) {
+    ChangeRing ring(4);
+    EXPECT_EQ(ring.capacity(), 4);
+    ChangeRecord out[4];
+    for (uint64_t round = 0; round < 5; round++) {
+        for (uint64_t i = 0; i < 4; i++) {
+            ASSERT_TRUE(ring.try_push({round * 4 + i + 1, i, round, ChangeOp::Insert, 0}));
+        }
+        EXPECT_FALSE(ring.try_push({0, 0, 0, ChangeOp::Insert, 0}));
+        EXPECT_EQ(ring.pending(), 4);
+        ASSERT_EQ(ring.pop(out, 3), 3);
+        ASSERT_EQ(ring.pop(out + 3, 3), 1);
+        for (uint64_t i = 0; i < 4; i++) {
+            EXPECT_EQ(out[i].seq_, round * 4 + i + 1);
+        }
+    }
+    EXPECT_EQ(ring.pop(out, 4), 0);
+}
+
+TEST(ChangeFeedTest, PublishesOpsInOrder) {
+    ChangeRing ring(16);
+    ChangeFeedTable table(ring);
+    table.insert(1, 10);
+    table.insert(1, 11);
+    EXPECT_FALSE(table.erase(2));
+    table.erase(1);
+
+    ChangeRecord out[16];
+    ASSERT_EQ(ring.pop(out, 16), 3);
+    EXPECT_EQ(out[0].op_, ChangeOp::Insert);
+    EXPECT_EQ(out[1].op_, ChangeOp::Update);
+    EXPECT_EQ(out[1].val_, 11);
+    EXPECT_EQ(out[2].op_, ChangeOp::Erase);
+    EXPECT_EQ(out[2].seq_, 3);
+    EXPECT_EQ(table.seq(), 3);
+}
+
+TEST(ChangeFeedTest, FollowerKeepsReplicaInSync) {
+    // a small ring so the writer regularly waits on the follower
+    ChangeRing ring(256);
+    ChangeFeedTable primary(ring);
+    OpenAddressTable replica;
+    ReplicaFollower follower(ring, replica, 0, 64);
+    follower.start();
+
+    std::mt19937_64 gen(42);
+    for (size_t i = 0; i < 200000; i++) {
+        const uint64_t key = gen() % 5000;
+        if (gen() % 3 == 0) {
+            primary.erase(key);
+        } else {
+            primary.insert(key, i);
+        }
+    }
+    while (follower.applied() < primary.seq()) {
+        std::this_thread::yield();
+    }
+    follower.stop();
+    EXPECT_EQ(follower.applied_seq(), primary.seq());
+    EXPECT_TRUE(same_contents(primary.table(), replica));
+}
+
+TEST(ChangeFeedTest, SkipsChangesInSeededSnapshotAndDetectsGaps) {
+    ChangeRing ring(64);
+    ChangeFeedTable primary(ring);
+    primary.insert(1, 1);
+    primary.insert(2, 2);
+
+    // the replica was copied after seq 1, so the first record is already in it
+    OpenAddressTable replica;
+    replica.insert(1, 1);
+    ReplicaFollower follower(ring, replica, 1);
+    follower.catch_up(primary.seq());
+    EXPECT_TRUE(same_contents(primary.table(), replica));
+
+    // a producer that drops records leaves a gap
+    ring.push({primary.seq() + 2, 3, 3, ChangeOp::Insert, 0});
+    EXPECT_THROW(follower.poll(), std::runtime_error);
+}
+
+TEST(ChangeFeedTest, FollowsAcrossProcesses) {
+    ChangeRing ring(1024);
+    const size_t changes = 50000;
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        // the child rebuilds the primary's final state from the feed alone
+        OpenAddressTable replica;
+        ReplicaFollower follower(ring, replica);
+        follower.catch_up(changes);
+        OpenAddressTable expected;
+        for (uint64_t i = 0; i < changes; i++) {
+            expected.insert(i % 7000, i);
+        }
+        _exit(same_contents(expected, replica) ? 0 : 1);
+    }
+
+    ChangeFeedTable primary(ring);
+    for (uint64_t i = 0; i < changes; i++) {
+        primary.insert(i % 7000, i);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(ChangeFeedTest, NamedRingOpensInAnotherMapping) {
+    const std::string name = "/oat_change_feed_test_" + std::to_string(getpid());
+    auto producer = ChangeRing::create_shared(name, 8);
+    auto consumer = ChangeRing::open_shared(name);
+    ChangeRing::unlink_shared(name);
+
+    ChangeFeedTable primary(*producer);
+    OpenAddressTable replica;
+    ReplicaFollower follower(*consumer, replica);
+    for (uint64_t i = 0; i < 5; i++) {
+        primary.insert(i, i * 2);
+    }
+    primary.erase(3);
+    follower.catch_up(primary.seq());
+    EXPECT_EQ(consumer->capacity(), 8);
+    EXPECT_TRUE(same_contents(primary.table(), replica));
+}
+
+TEST(ChangeFeedTest, OpenSharedRejectsUninitializedRing) {
+    // sized like a ring, but the creator has not written the header yet
+    const std::string name = "/oat_change_feed_test_raw_" + std::to_string(getpid());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ftruncate(fd, 4096), 0);
+    EXPECT_THROW(ChangeRing::open_shared(name), std::runtime_error);
+
+    // a capacity that is not a power of two
+    const uint64_t capacity = 6;
+    ASSERT_EQ(pwrite(fd, &capacity, sizeof(capacity), 0), static_cast<ssize_t>(sizeof(capacity)));
+    EXPECT_THROW(ChangeRing::open_shared(name), std::runtime_error);
+    close(fd);
+    ChangeRing::unlink_shared(name);
+}
@@ -0,0 +1,129 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "table.cpp"
+#include "reference_tables.cpp"
+#include "cuckoo_table.cpp"
+#include "hopscotch_table.cpp"
+
+// every table runs the same workloads over the same keys, so the columns for
+// one workload differ only by the probing scheme. range(0) is the number of
+// live entries.
+
+static std::vector<uint64_t> random_keys(size_t count, uint64_t seed) {
+    std::mt19937_64 generator(seed);
+    std::vector<uint64_t> keys(count);
+    for (auto& key : keys) key = generator();
+    return keys;
+}
+
+template <typename Table>
+static void build(Table& table, const std::vector<uint64_t>& keys) {
+    for (auto key : keys) {
+        table.insert(key, key);
+    }
+}
+
+// growth from the default size, resizes included
+template <typename Table>
+static void BM_Compare_Insert(benchmark::State& state) {
+    const auto keys = random_keys(state.range(0), 42);
+
+    for (auto _ : state) {
+        Table table;
+        build(table, keys);
+        benchmark::DoNotOptimize(table.size());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template <typename Table>
+static void BM_Compare_LookupHit(benchmark::State& state) {
+    const auto keys = random_keys(state.range(0), 42);
+    auto order = keys;
+    std::shuffle(order.begin(), order.end(), std::mt19937_64(7));
+    Table table;
+    build(table, keys);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.get(order[i]));
+        i = i + 1 == order.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["load_factor"] = table.load_factor();
+}
+
+template <typename Table>
+static void BM_Compare_LookupMiss(benchmark::State& state) {
+    const auto keys = random_keys(state.range(0), 42);
+    const auto misses = random_keys(state.range(0), 43);
+    Table table;
+    build(table, keys);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.get(misses[i]));
+        i = i + 1 == misses.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["load_factor"] = table.load_factor();
+}
+
+// the main.cpp workload: look a key up, insert it if absent, erase it if present
+template <typename Table>
+static void BM_Compare_Mixed(benchmark::State& state) {
+    const size_t size = state.range(0);
+    Table table;
+    std::minstd_rand generator(42);
+    std::uniform_int_distribution<int> uniform_distribution(2, size);
+    for (size_t i = 0; i < size; ++i) {
+        table.insert(uniform_distribution(generator), 0);
+    }
+
+    for (auto _ : state) {
+        const uint64_t value = uniform_distribution(generator);
+        if (!table.get(value).has_value()) {
+            table.insert(value, 0);
+        } else {
+            table.erase(value);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// steady-size erase + insert, which is where tombstones and backward shift part ways
+template <typename Table>
+static void BM_Compare_Churn(benchmark::State& state) {
+    auto keys = random_keys(state.range(0), 42);
+    Table table;
+    build(table, keys);
+    std::mt19937_64 generator(99);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        table.erase(keys[i]);
+        keys[i] = generator();
+        table.insert(keys[i], i);
+        i = i + 1 == keys.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+
+#define COMPARE_ALL(workload)                                                                          \
+    BENCHMARK_TEMPLATE(workload, OpenAddressTable)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);      \
+    BENCHMARK_TEMPLATE(workload, LinearProbingTable)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);    \
+    BENCHMARK_TEMPLATE(workload, QuadraticProbingTable)->RangeMultiplier(16)->Range(1 << 12, 1 << 20); \
+    BENCHMARK_TEMPLATE(workload, CuckooTable)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);           \
+    BENCHMARK_TEMPLATE(workload, BucketizedCuckooTable)->RangeMultiplier(16)->Range(1 << 12, 1 << 20); \
+    BENCHMARK_TEMPLATE(workload, HopscotchTable)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);        \
+    BENCHMARK_TEMPLATE(workload, SwissTable)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);            \
+    BENCHMARK_TEMPLATE(workload, UnorderedMapTable)->RangeMultiplier(16)->Range(1 << 12, 1 << 20)
+
+COMPARE_ALL(BM_Compare_Insert);
+COMPARE_ALL(BM_Compare_LookupHit);
+COMPARE_ALL(BM_Compare_LookupMiss);
+COMPARE_ALL(BM_Compare_Mixed);
+COMPARE_ALL(BM_Compare_Churn);
+
+BENCHMARK_MAIN();
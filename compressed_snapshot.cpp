@@ -0,0 +1,310 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "snapshot.cpp"
+
+// compressed snapshot: only live entries, in independently compressed blocks, so
+// a sparse table costs its size rather than its capacity and both directions
+// split across threads. link with -lz.
+//   header: "OATC" magic, u8 version, u64 capacity, u64 live entries, u64 lsn,
+//           u64 block count
+//   block:  u32 compressed bytes, u32 raw bytes, u32 entry count, u32 reserved,
+//           u64 xxh64 of the compressed bytes, then the deflate stream of
+//           varint keys, sorted and delta-coded from 0, then varint values
+// each encoding thread owns a contiguous slot range and sorts its entries by
+// key, so the deltas are as small as the key density allows. keys with many
+// shared high bytes (counters, ids) shrink to a byte or two before deflate.
+
+static constexpr char COMPRESSED_SNAPSHOT_MAGIC[4] = {'O', 'A', 'T', 'C'};
+
+struct CompressedSnapshotHeader {
+    char magic_[4];
+    uint8_t version_;
+    uint8_t reserved_[3];
+    uint64_t capacity_;
+    uint64_t size_;
+    uint64_t lsn_;
+    uint64_t block_count_;
+};
+
+struct CompressedBlockHeader {
+    uint32_t compressed_bytes_;
+    uint32_t raw_bytes_;
+    uint32_t count_;
+    uint32_t reserved_;
+    uint64_t checksum_;
+};
+
+struct CompressedSnapshotConfig {
+    // 0 uses every hardware thread
+    size_t threads = 0;
+    // zlib level, 1 is fastest; the varint pass already removes most redundancy
+    int level = 1;
+    size_t block_entries = 1 << 16;
+};
+
+inline size_t snapshot_threads(size_t requested) {
+    return requested != 0 ? requested : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// appends one block, header included, to out
+inline void encode_block(const KeyValue* entries, size_t count, int level, std::string& out) {
+    std::string raw;
+    raw.reserve(count * 6);
+    uint64_t previous = 0;
+    for (size_t i = 0; i < count; ++i) {
+        put_varint(raw, entries[i].first - previous);
+        previous = entries[i].first;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        put_varint(raw, entries[i].second);
+    }
+
+    uLongf compressed_bytes = compressBound(raw.size());
+    const size_t header_pos = out.size();
+    out.resize(header_pos + sizeof(CompressedBlockHeader) + compressed_bytes);
+    auto* compressed = reinterpret_cast<Bytef*>(&out[header_pos + sizeof(CompressedBlockHeader)]);
+    if (compress2(compressed, &compressed_bytes, reinterpret_cast<const Bytef*>(raw.data()), raw.size(), level) != Z_OK) {
+        throw std::runtime_error("snapshot block compression failed");
+    }
+    out.resize(header_pos + sizeof(CompressedBlockHeader) + compressed_bytes);
+
+    CompressedBlockHeader header{static_cast<uint32_t>(compressed_bytes), static_cast<uint32_t>(raw.size()),
+                                 static_cast<uint32_t>(count), 0, XXH64(compressed, compressed_bytes, 0)};
+    std::memcpy(&out[header_pos], &header, sizeof(header));
+}
+
+inline void decode_block(const char* block, std::vector<KeyValue>& out, const std::string& path) {
+    CompressedBlockHeader header;
+    std::memcpy(&header, block, sizeof(header));
+    const char* compressed = block + sizeof(header);
+    // the checksum covers only the compressed bytes, so bound the raw size by
+    // what count_ entries can take, two varints of 1 to 10 bytes each, before
+    // allocating it
+    const uint64_t count = header.count_;
+    if (XXH64(compressed, header.compressed_bytes_, 0) != header.checksum_ || header.raw_bytes_ < count * 2 ||
+        header.raw_bytes_ > count * 20) {
+        throw std::runtime_error("corrupt snapshot block in: " + path);
+    }
+
+    std::string raw(header.raw_bytes_, '\0');
+    uLongf raw_bytes = raw.size();
+    if (uncompress(reinterpret_cast<Bytef*>(&raw[0]), &raw_bytes, reinterpret_cast<const Bytef*>(compressed),
+                   header.compressed_bytes_) != Z_OK || raw_bytes != raw.size()) {
+        throw std::runtime_error("corrupt snapshot block in: " + path);
+    }
+
+    out.resize(header.count_);
+    size_t pos = 0;
+    uint64_t key = 0;
+    for (auto& entry : out) {
+        uint64_t delta;
+        if (!get_varint(raw.data(), raw.size(), pos, delta)) {
+            throw std::runtime_error("corrupt snapshot block in: " + path);
+        }
+        key += delta;
+        entry.first = key;
+    }
+    for (auto& entry : out) {
+        if (!get_varint(raw.data(), raw.size(), pos, entry.second)) {
+            throw std::runtime_error("corrupt snapshot block in: " + path);
+        }
+    }
+}
+
+inline void save_compressed_snapshot(const OpenAddressTable& table, const std::string& path, uint64_t lsn = 0,
+                                     CompressedSnapshotConfig config = {}) {
+    const size_t capacity = table.data_.size();
+    const size_t threads = std::min(snapshot_threads(config.threads), std::max<size_t>(1, capacity / 4096));
+    std::vector<std::string> parts(threads);
+    std::vector<size_t> part_blocks(threads, 0);
+    std::vector<std::exception_ptr> errors(threads);
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            try {
+                std::vector<KeyValue> entries;
+                for (size_t i = capacity * t / threads; i < capacity * (t + 1) / threads; ++i) {
+                    if (table.data_[i].status_ == 2) {
+                        entries.emplace_back(table.data_[i].key_, table.data_[i].val_);
+                    }
+                }
+                std::sort(entries.begin(), entries.end());
+                for (size_t base = 0; base < entries.size(); base += config.block_entries) {
+                    encode_block(&entries[base], std::min(config.block_entries, entries.size() - base),
+                                 config.level, parts[t]);
+                    ++part_blocks[t];
+                }
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+
+    CompressedSnapshotHeader header{};
+    std::memcpy(header.magic_, COMPRESSED_SNAPSHOT_MAGIC, sizeof(COMPRESSED_SNAPSHOT_MAGIC));
+    header.version_ = SNAPSHOT_VERSION;
+    header.capacity_ = capacity;
+    header.size_ = table.size();
+    header.lsn_ = lsn;
+    for (size_t blocks : part_blocks) {
+        header.block_count_ += blocks;
+    }
+
+    write_file_atomically(path, [&](int fd, const std::string& tmp_path) {
+        write_all(fd, &header, sizeof(header), tmp_path);
+        for (const auto& part : parts) {
+            write_all(fd, part.data(), part.size(), tmp_path);
+        }
+    });
+}
+
+// blocks are decompressed on worker threads while this thread inserts the
+// finished ones in order; at most a few blocks per worker are held decoded
+inline OpenAddressTable load_compressed_snapshot(const std::string& path, uint64_t* lsn = nullptr,
+                                                 CompressedSnapshotConfig config = {}) {
+    std::string file;
+    {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        struct stat st;
+        const bool ok = fstat(fd, &st) == 0 && (file.resize(st.st_size), read_all(fd, &file[0], file.size(), path));
+        close(fd);
+        if (!ok) {
+            throw std::runtime_error("could not read snapshot: " + path);
+        }
+    }
+
+    CompressedSnapshotHeader header;
+    if (file.size() < sizeof(header)) {
+        throw std::runtime_error("not a compressed snapshot file: " + path);
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic_, COMPRESSED_SNAPSHOT_MAGIC, sizeof(COMPRESSED_SNAPSHOT_MAGIC)) != 0) {
+        throw std::runtime_error("not a compressed snapshot file: " + path);
+    }
+    if (header.version_ != SNAPSHOT_VERSION) {
+        throw std::runtime_error("unsupported snapshot version in: " + path);
+    }
+    if (header.capacity_ == 0 || (header.capacity_ & (header.capacity_ - 1)) != 0 ||
+        header.size_ > header.capacity_) {
+        throw std::runtime_error("corrupt snapshot header in: " + path);
+    }
+
+    // only the headers are walked here, to find where each block starts
+    std::vector<size_t> offsets;
+    size_t pos = sizeof(header);
+    uint64_t entries = 0;
+    for (uint64_t b = 0; b < header.block_count_; ++b) {
+        CompressedBlockHeader block;
+        if (pos + sizeof(block) > file.size()) {
+            throw std::runtime_error("truncated snapshot: " + path);
+        }
+        std::memcpy(&block, file.data() + pos, sizeof(block));
+        offsets.push_back(pos);
+        entries += block.count_;
+        pos += sizeof(block) + block.compressed_bytes_;
+    }
+    if (pos != file.size() || entries != header.size_) {
+        throw std::runtime_error("truncated or corrupt snapshot: " + path);
+    }
+
+    OpenAddressTable table(header.capacity_);
+    const size_t blocks = offsets.size();
+    const size_t threads = std::min(snapshot_threads(config.threads), std::max<size_t>(1, blocks));
+    const size_t window = threads * 2;
+    std::vector<std::vector<KeyValue>> decoded(blocks);
+    std::vector<char> ready(blocks, 0);
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t next_block = 0;
+    size_t inserted = 0;
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            while (true) {
+                size_t b;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return next_block >= blocks || next_block < inserted + window || error; });
+                    if (next_block >= blocks || error) return;
+                    b = next_block++;
+                }
+                std::vector<KeyValue> out;
+                std::exception_ptr block_error;
+                try {
+                    decode_block(file.data() + offsets[b], out, path);
+                } catch (...) {
+                    block_error = std::current_exception();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (block_error && !error) error = block_error;
+                    decoded[b] = std::move(out);
+                    ready[b] = 1;
+                }
+                cv.notify_all();
+            }
+        });
+    }
+
+    std::vector<uint64_t> keys;
+    std::vector<uint64_t> vals;
+    for (size_t b = 0; b < blocks; ++b) {
+        std::vector<KeyValue> block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return ready[b] || error; });
+            if (error) break;
+            block = std::move(decoded[b]);
+        }
+        keys.resize(block.size());
+        vals.resize(block.size());
+        for (size_t i = 0; i < block.size(); ++i) {
+            keys[i] = block[i].first;
+            vals[i] = block[i].second;
+        }
+        table.insert_batch(keys.data(), vals.data(), block.size());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inserted = b + 1;
+        }
+        cv.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) inserted = blocks;
+    }
+    cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    if (lsn != nullptr) {
+        *lsn = header.lsn_;
+    }
+    return table;
+}
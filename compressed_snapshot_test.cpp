@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <random>
+#include "compressed_snapshot.cpp"
+
+class CompressedSnapshotTest : public ::testing::Test {
+protected:
+    std::string path;
+    std::string raw_path;
+
+    void SetUp() override {
+        path = ::testing::TempDir() + "oat_compressed_snapshot_test.bin";
+        raw_path = ::testing::TempDir() + "oat_compressed_snapshot_test.raw";
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+        std::remove(raw_path.c_str());
+    }
+
+    static size_t file_size(const std::string& file) {
+        struct stat st;
+        return stat(file.c_str(), &st) == 0 ? st.st_size : 0;
+    }
+};
+
+TEST_F(CompressedSnapshotTest, RoundTripsAcrossThreadAndBlockCounts) {
+    OpenAddressTable table;
+    std::mt19937_64 gen(42);
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i < 50000; i++) {
+        keys.push_back(i % 2 ? gen() : i);
+        table.insert(keys.back(), gen() % 1000);
+    }
+
+    for (size_t threads : {1, 3, 8}) {
+        CompressedSnapshotConfig config;
+        config.threads = threads;
+        config.block_entries = 1000;
+        save_compressed_snapshot(table, path, 99, config);
+
+        uint64_t lsn = 0;
+        OpenAddressTable loaded = load_compressed_snapshot(path, &lsn, config);
+        EXPECT_EQ(lsn, 99);
+        EXPECT_EQ(loaded.size(), table.size());
+        EXPECT_EQ(loaded.capacity(), table.capacity());
+        for (uint64_t key : keys) {
+            ASSERT_EQ(loaded.get(key), table.get(key));
+        }
+    }
+}
+
+TEST_F(CompressedSnapshotTest, EmptyTable) {
+    OpenAddressTable table(1024);
+    save_compressed_snapshot(table, path);
+    OpenAddressTable loaded = load_compressed_snapshot(path);
+    EXPECT_EQ(loaded.size(), 0);
+    EXPECT_EQ(loaded.capacity(), 1024);
+}
+
+// dense ids in a sparse table: the raw image pays for every empty slot
+TEST_F(CompressedSnapshotTest, MuchSmallerThanRawForSparseTables) {
+    OpenAddressTable table(1 << 18);
+    for (uint64_t key = 1'000'000; key < 1'020'000; key++) {
+        table.insert(key, key % 100);
+    }
+    save_snapshot(table, raw_path);
+    save_compressed_snapshot(table, path);
+    EXPECT_LT(file_size(path) * 50, file_size(raw_path));
+}
+
+TEST_F(CompressedSnapshotTest, DetectsCorruption) {
+    OpenAddressTable table;
+    for (uint64_t key = 0; key < 10000; key++) {
+        table.insert(key, key);
+    }
+    CompressedSnapshotConfig config;
+    config.block_entries = 500;
+    save_compressed_snapshot(table, path, 0, config);
+    {
+        FILE* file = std::fopen(path.c_str(), "r+b");
+        std::fseek(file, -3, SEEK_END);
+        std::fputc(0x5a, file);
+        std::fclose(file);
+    }
+    EXPECT_THROW(load_compressed_snapshot(path, nullptr, config), std::runtime_error);
+
+    save_compressed_snapshot(table, path, 0, config);
+    ASSERT_EQ(truncate(path.c_str(), file_size(path) - 10), 0);
+    EXPECT_THROW(load_compressed_snapshot(path), std::runtime_error);
+
+    // an oversized raw length in a block header is refused before it is allocated
+    save_compressed_snapshot(table, path, 0, config);
+    {
+        const uint32_t raw_bytes = 0xffffffff;
+        FILE* file = std::fopen(path.c_str(), "r+b");
+        std::fseek(file, sizeof(CompressedSnapshotHeader) + offsetof(CompressedBlockHeader, raw_bytes_), SEEK_SET);
+        std::fwrite(&raw_bytes, sizeof(raw_bytes), 1, file);
+        std::fclose(file);
+    }
+    EXPECT_THROW(load_compressed_snapshot(path), std::runtime_error);
+
+    save_snapshot(table, path);
+    EXPECT_THROW(load_compressed_snapshot(path), std::runtime_error);
+}
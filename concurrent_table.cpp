@@ -0,0 +1,164 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+#include "table.cpp"
+
+// the simplest thread-safe table, one mutex around everything. this is the
+// baseline any concurrent variant has to beat
+class LockedTable {
+public:
+    explicit LockedTable(size_t initial_size = 64) : table_(initial_size) {}
+
+    bool insert(uint64_t key, uint64_t val) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return table_.insert(key, val);
+    }
+
+    std::optional<uint64_t> get(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return table_.get(key);
+    }
+
+    bool erase(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return table_.erase(key);
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return table_.size();
+    }
+
+private:
+    std::mutex mutex_;
+    OpenAddressTable table_;
+};
+
+// independent OpenAddressTables behind reader/writer locks. the shard is picked
+// from the top hash bits because the low bits already index inside each shard
+class ShardedTable {
+public:
+    explicit ShardedTable(size_t shard_count = 64, size_t initial_size = 64)
+            : shard_bits_(0) {
+        while ((size_t(1) << shard_bits_) < shard_count) {
+            ++shard_bits_;
+        }
+        shards_ = std::vector<Shard>(size_t(1) << shard_bits_);
+        for (auto& shard : shards_) {
+            shard.table_ = OpenAddressTable(initial_size);
+        }
+    }
+
+    bool insert(uint64_t key, uint64_t val) {
+        auto& shard = shard_for(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+        return shard.table_.insert(key, val);
+    }
+
+    // get() never writes to the slot array, so readers of one shard can run together
+    std::optional<uint64_t> get(uint64_t key) {
+        auto& shard = shard_for(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+        return shard.table_.get(key);
+    }
+
+    // read-modify-write under the shard's write lock. an absent key is set to
+    // initial and initial returned, or left absent with nullopt if there is none
+    template <typename Fn>
+    std::optional<uint64_t> update(uint64_t key, Fn fn, std::optional<uint64_t> initial = std::nullopt) {
+        auto& shard = shard_for(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+        auto current = shard.table_.get(key);
+        if (!current.has_value()) {
+            if (initial.has_value()) {
+                shard.table_.insert(key, *initial);
+            }
+            return initial;
+        }
+        const uint64_t next = fn(*current);
+        shard.table_.insert(key, next);
+        return next;
+    }
+
+    // groups the keys by shard so each shard is locked once and probed with
+    // OpenAddressTable::get_batch, then scatters the answers back into key order
+    void get_batch(const uint64_t* keys, size_t n, std::optional<uint64_t>* out) {
+        if (shard_bits_ == 0) {
+            std::shared_lock<std::shared_mutex> lock(shards_[0].mutex_);
+            shards_[0].table_.get_batch(keys, n, out);
+            return;
+        }
+
+        std::vector<size_t> starts(shards_.size() + 1, 0);
+        std::vector<uint32_t> shard_of(n);
+        for (size_t i = 0; i < n; ++i) {
+            shard_of[i] = static_cast<uint32_t>(shard_index(keys[i]));
+            ++starts[shard_of[i] + 1];
+        }
+        for (size_t s = 0; s < shards_.size(); ++s) {
+            starts[s + 1] += starts[s];
+        }
+
+        std::vector<uint64_t> grouped(n);
+        std::vector<size_t> origin(n);
+        std::vector<size_t> fill(starts.begin(), starts.end() - 1);
+        for (size_t i = 0; i < n; ++i) {
+            const size_t slot = fill[shard_of[i]]++;
+            grouped[slot] = keys[i];
+            origin[slot] = i;
+        }
+
+        std::vector<std::optional<uint64_t>> results(n);
+        for (size_t s = 0; s < shards_.size(); ++s) {
+            if (starts[s] == starts[s + 1]) {
+                continue;
+            }
+            std::shared_lock<std::shared_mutex> lock(shards_[s].mutex_);
+            shards_[s].table_.get_batch(&grouped[starts[s]], starts[s + 1] - starts[s], &results[starts[s]]);
+        }
+        for (size_t slot = 0; slot < n; ++slot) {
+            out[origin[slot]] = results[slot];
+        }
+    }
+
+    bool erase(uint64_t key) {
+        auto& shard = shard_for(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+        return shard.table_.erase(key);
+    }
+
+    size_t size() {
+        size_t total = 0;
+        for (auto& shard : shards_) {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+            total += shard.table_.size();
+        }
+        return total;
+    }
+
+    size_t shard_count() const { return shards_.size(); }
+
+private:
+    // one cache line per lock so neighbouring shards do not false-share
+    struct alignas(64) Shard {
+        std::shared_mutex mutex_;
+        OpenAddressTable table_;
+    };
+
+    std::vector<Shard> shards_;
+    size_t shard_bits_;
+
+    size_t shard_index(uint64_t key) const {
+        if (shard_bits_ == 0) {
+            return 0;
+        }
+        return OpenAddressTable::hash_key(key) >> (64 - shard_bits_);
+    }
+
+    Shard& shard_for(uint64_t key) {
+        return shards_[shard_index(key)];
+    }
+};
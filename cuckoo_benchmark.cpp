@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+#include "table.cpp"
+#include "cuckoo_table.cpp"
+
+// lookup latency at high load, where the two tables part ways: the cuckoo table
+// reads at most two buckets at any load while robin-hood runs keep growing.
+// OpenAddressTable resizes at LOAD_FACTOR_THRESHOLD, so its cases are capped
+// just below 0.75 and the load_factor counter shows what was actually reached.
+//
+// range(0): target load factor in percent
+
+const size_t SLOTS = 1 << 22;
+
+template <typename Table>
+static double max_load() {
+    return Table::LOAD_FACTOR_THRESHOLD - 0.01;
+}
+
+template <typename Table>
+static std::vector<uint64_t> fill(Table& table, double target) {
+    std::mt19937_64 generator(42);
+    std::vector<uint64_t> keys;
+    const size_t count = static_cast<size_t>(table.capacity() * std::min(target, max_load<Table>()));
+    while (table.size() < count) {
+        const uint64_t key = generator();
+        const size_t before = table.size();
+        table.insert(key, key);
+        if (table.size() > before) keys.push_back(key);
+    }
+    return keys;
+}
+
+template <typename Table>
+static void BM_HighLoad_LookupHit(benchmark::State& state) {
+    Table table(SLOTS);
+    auto keys = fill(table, state.range(0) / 100.0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(7));
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.get(keys[i]));
+        i = i + 1 == keys.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["load_factor"] = table.load_factor();
+}
+
+template <typename Table>
+static void BM_HighLoad_LookupMiss(benchmark::State& state) {
+    Table table(SLOTS);
+    fill(table, state.range(0) / 100.0);
+    std::mt19937_64 generator(1234);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.get(generator()));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["load_factor"] = table.load_factor();
+}
+
+// cost of filling a presized table to the target load, eviction walks included
+template <typename Table>
+static void BM_HighLoad_Fill(benchmark::State& state) {
+    size_t inserted = 0;
+    double load = 0;
+    for (auto _ : state) {
+        Table table(SLOTS);
+        inserted = fill(table, state.range(0) / 100.0).size();
+        load = table.load_factor();
+    }
+    state.SetItemsProcessed(state.iterations() * inserted);
+    state.counters["load_factor"] = load;
+}
+
+static void LoadFactors(benchmark::internal::Benchmark* b) {
+    b->ArgName("lf_pct")->Arg(50)->Arg(75)->Arg(90)->Arg(95);
+}
+
+BENCHMARK_TEMPLATE(BM_HighLoad_LookupHit, OpenAddressTable)->Apply(LoadFactors);
+BENCHMARK_TEMPLATE(BM_HighLoad_LookupHit, BucketizedCuckooTable)->Apply(LoadFactors);
+BENCHMARK_TEMPLATE(BM_HighLoad_LookupMiss, OpenAddressTable)->Apply(LoadFactors);
+BENCHMARK_TEMPLATE(BM_HighLoad_LookupMiss, BucketizedCuckooTable)->Apply(LoadFactors);
+BENCHMARK_TEMPLATE(BM_HighLoad_Fill, OpenAddressTable)->Apply(LoadFactors)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_HighLoad_Fill, BucketizedCuckooTable)->Apply(LoadFactors)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,210 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+#include "xxhash/xxhash.h"
+
+// bucketized cuckoo hashing: every key lives in one of two 4-way buckets, and a
+// bucket is exactly one cache line, so a lookup hit or miss reads at most two
+// lines no matter how full the table is. inserts pay for that bound with
+// eviction walks, which stay short up to ~0.95 load with 4-way buckets.
+//
+// the bucket has no room for occupancy bits, so key 0 marks a free slot and a
+// real key 0 is kept on the side.
+class BucketizedCuckooTable {
+public:
+    static constexpr size_t BUCKET_WAYS = 4;
+    static constexpr uint64_t EMPTY_KEY = 0;
+    static constexpr double LOAD_FACTOR_THRESHOLD = 0.95;
+    // eviction walk length before giving up and doubling
+    static constexpr size_t MAX_KICKS = 500;
+
+    struct alignas(64) Bucket {
+        uint64_t keys_[BUCKET_WAYS];
+        uint64_t vals_[BUCKET_WAYS];
+    };
+    static_assert(sizeof(Bucket) == 64, "a bucket must fill exactly one cache line");
+
+    // initial_size counts slots, like OpenAddressTable, and is rounded up to whole buckets
+    explicit BucketizedCuckooTable(size_t initial_size = 64)
+            : size_(0), has_zero_(false), zero_val_(0), generator_(42) {
+        size_t buckets = 4;
+        while (buckets * BUCKET_WAYS < initial_size) buckets <<= 1;
+        buckets_.assign(buckets, Bucket{});
+    }
+
+    static size_t hash_key(uint64_t key) {
+        return XXH64(&key, sizeof(key), 0);
+    }
+
+    bool insert(uint64_t key, uint64_t val) {
+        if (key == EMPTY_KEY) {
+            size_ += !has_zero_;
+            has_zero_ = true;
+            zero_val_ = val;
+            return true;
+        }
+
+        const size_t hash = hash_key(key);
+        const size_t mask = buckets_.size() - 1;
+        const size_t b1 = primary(hash, mask);
+        const size_t b2 = secondary(hash, mask);
+        __builtin_prefetch(&buckets_[b2]);
+
+        if (uint64_t* val_ptr = find_in(b1, key)) {
+            *val_ptr = val;
+            return true;
+        }
+        if (uint64_t* val_ptr = find_in(b2, key)) {
+            *val_ptr = val;
+            return true;
+        }
+
+        if (static_cast<double>(size_ + 1) > capacity() * LOAD_FACTOR_THRESHOLD) {
+            grow();
+        }
+
+        std::pair<uint64_t, uint64_t> carry{key, val};
+        while (!place(carry)) {
+            grow();
+        }
+        ++size_;
+        return true;
+    }
+
+    __attribute__((always_inline))
+    std::optional<uint64_t> get(uint64_t key) {
+        if (key == EMPTY_KEY) {
+            return has_zero_ ? std::optional<uint64_t>(zero_val_) : std::nullopt;
+        }
+
+        const size_t hash = hash_key(key);
+        const size_t mask = buckets_.size() - 1;
+        const size_t b1 = primary(hash, mask);
+        const size_t b2 = secondary(hash, mask);
+        // both candidate lines are known up front, so fetch them in parallel
+        __builtin_prefetch(&buckets_[b1]);
+        __builtin_prefetch(&buckets_[b2]);
+
+        if (uint64_t* val_ptr = find_in(b1, key)) {
+            return *val_ptr;
+        }
+        if (uint64_t* val_ptr = find_in(b2, key)) {
+            return *val_ptr;
+        }
+        return std::nullopt;
+    }
+
+    bool erase(uint64_t key) {
+        if (key == EMPTY_KEY) {
+            if (!has_zero_) return false;
+            has_zero_ = false;
+            --size_;
+            return true;
+        }
+
+        const size_t hash = hash_key(key);
+        const size_t mask = buckets_.size() - 1;
+        for (size_t b : {primary(hash, mask), secondary(hash, mask)}) {
+            Bucket& bucket = buckets_[b];
+            for (size_t i = 0; i < BUCKET_WAYS; ++i) {
+                if (bucket.keys_[i] == key) {
+                    bucket.keys_[i] = EMPTY_KEY;
+                    --size_;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t capacity() const { return buckets_.size() * BUCKET_WAYS; }
+
+    double load_factor() const { return static_cast<double>(size_) / capacity(); }
+
+private:
+    std::vector<Bucket> buckets_;
+    size_t size_;
+    bool has_zero_;
+    uint64_t zero_val_;
+    std::minstd_rand generator_;
+
+    // low bits pick the first bucket, the high half of the same hash picks the second
+    static size_t primary(size_t hash, size_t mask) { return hash & mask; }
+
+    static size_t secondary(size_t hash, size_t mask) { return (hash >> 32) & mask; }
+
+    __attribute__((always_inline))
+    uint64_t* find_in(size_t b, uint64_t key) {
+        Bucket& bucket = buckets_[b];
+        for (size_t i = 0; i < BUCKET_WAYS; ++i) {
+            if (bucket.keys_[i] == key) {
+                return &bucket.vals_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    bool place_in(size_t b, const std::pair<uint64_t, uint64_t>& item) {
+        Bucket& bucket = buckets_[b];
+        for (size_t i = 0; i < BUCKET_WAYS; ++i) {
+            if (bucket.keys_[i] == EMPTY_KEY) {
+                bucket.keys_[i] = item.first;
+                bucket.vals_[i] = item.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // random-walk eviction. on failure `carry` holds whichever entry was left homeless
+    bool place(std::pair<uint64_t, uint64_t>& carry) {
+        const size_t mask = buckets_.size() - 1;
+        size_t hash = hash_key(carry.first);
+        size_t b = primary(hash, mask);
+        if (place_in(b, carry) || place_in(b = secondary(hash, mask), carry)) {
+            return true;
+        }
+
+        for (size_t kick = 0; kick < MAX_KICKS; ++kick) {
+            Bucket& bucket = buckets_[b];
+            const size_t victim = generator_() % BUCKET_WAYS;
+            std::swap(carry.first, bucket.keys_[victim]);
+            std::swap(carry.second, bucket.vals_[victim]);
+
+            // the evicted entry moves to whichever of its buckets it was not in
+            hash = hash_key(carry.first);
+            const size_t first = primary(hash, mask);
+            b = b == first ? secondary(hash, mask) : first;
+            if (place_in(b, carry)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void grow() {
+        std::vector<Bucket> old = std::move(buckets_);
+        for (size_t new_size = old.size() * 2; ; new_size *= 2) {
+            buckets_.assign(new_size, Bucket{});
+            bool placed_all = true;
+            for (const auto& bucket : old) {
+                for (size_t i = 0; i < BUCKET_WAYS && placed_all; ++i) {
+                    if (bucket.keys_[i] != EMPTY_KEY) {
+                        std::pair<uint64_t, uint64_t> item{bucket.keys_[i], bucket.vals_[i]};
+                        placed_all = place(item);
+                    }
+                }
+            }
+            if (placed_all) {
+                return;
+            }
+        }
+    }
+};
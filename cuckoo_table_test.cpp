@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <unordered_map>
+#include "cuckoo_table.cpp"
+
+class BucketizedCuckooTableTest : public ::testing::Test {
+protected:
+    BucketizedCuckooTable table;
+
+    void SetUp() override {
+        table = BucketizedCuckooTable(16);
+    }
+};
+
+TEST_F(BucketizedCuckooTableTest, BasicOperations) {
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(table.capacity(), 16);
+    EXPECT_FALSE(table.get(1).has_value());
+
+    EXPECT_TRUE(table.insert(1, 100));
+    EXPECT_TRUE(table.insert(1, 200));
+    EXPECT_EQ(table.size(), 1);
+    EXPECT_EQ(table.get(1).value(), 200);
+
+    EXPECT_TRUE(table.erase(1));
+    EXPECT_FALSE(table.erase(1));
+    EXPECT_TRUE(table.empty());
+}
+
+TEST_F(BucketizedCuckooTableTest, ZeroKeyIsStoredOnTheSide) {
+    EXPECT_FALSE(table.get(0).has_value());
+    EXPECT_TRUE(table.insert(0, 7));
+    EXPECT_TRUE(table.insert(UINT64_MAX, 8));
+    EXPECT_EQ(table.size(), 2);
+    EXPECT_EQ(table.get(0).value(), 7);
+    EXPECT_EQ(table.get(UINT64_MAX).value(), 8);
+
+    EXPECT_TRUE(table.erase(0));
+    EXPECT_FALSE(table.get(0).has_value());
+    EXPECT_EQ(table.size(), 1);
+}
+
+TEST_F(BucketizedCuckooTableTest, FillsPast90PercentWithoutGrowing) {
+    table = BucketizedCuckooTable(1 << 14);
+    const size_t capacity = table.capacity();
+    std::mt19937_64 gen(42);
+    std::vector<uint64_t> keys;
+
+    while (table.load_factor() < 0.92) {
+        keys.push_back(gen() | 1);
+        EXPECT_TRUE(table.insert(keys.back(), keys.size()));
+    }
+    EXPECT_EQ(table.capacity(), capacity);
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(table.get(keys[i]), std::optional<uint64_t>(i + 1));
+    }
+}
+
+TEST_F(BucketizedCuckooTableTest, MatchesUnorderedMap) {
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<uint64_t> dis(0, 5000);
+    std::unordered_map<uint64_t, uint64_t> reference_map;
+
+    for (size_t i = 0; i < 50000; i++) {
+        uint64_t key = dis(gen);
+        switch (i % 3) {
+            case 0:
+                table.insert(key, i);
+                reference_map[key] = i;
+                break;
+            case 1: {
+                auto it = reference_map.find(key);
+                auto expected = it == reference_map.end() ? std::nullopt : std::optional<uint64_t>(it->second);
+                EXPECT_EQ(table.get(key), expected);
+                break;
+            }
+            case 2:
+                EXPECT_EQ(table.erase(key), reference_map.erase(key) > 0);
+                break;
+        }
+    }
+
+    EXPECT_EQ(table.size(), reference_map.size());
+    for (const auto& [key, value] : reference_map) {
+        EXPECT_EQ(table.get(key), std::optional<uint64_t>(value));
+    }
+}
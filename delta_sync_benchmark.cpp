@@ -0,0 +1,85 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include "table.cpp"
+
+// usage: delta_sync_benchmark [entries=10000000] [changed_percent=1]
+//
+// brings a stale replica up to date with a primary that changed by
+// changed_percent of its entries: by diff() and apply_delta(), by looking every
+// entry of each side up in the other, and by reloading the replica from scratch
+
+const size_t DEFAULT_ENTRIES = 10'000'000;
+const double DEFAULT_CHANGED_PERCENT = 1;
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void report(const std::string& name, double seconds, size_t changes) {
+    std::cout << std::setw(16) << name << std::setw(10) << std::fixed << std::setprecision(3) << seconds
+              << std::setw(12) << changes << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    const size_t entries = argc > 1 ? std::stoull(argv[1]) : DEFAULT_ENTRIES;
+    const double changed_percent = argc > 2 ? std::stod(argv[2]) : DEFAULT_CHANGED_PERCENT;
+
+    std::mt19937_64 gen(42);
+    OpenAddressTable replica;
+    replica.reserve(entries);
+    for (size_t i = 0; i < entries; i++) {
+        replica.insert(gen(), i);
+    }
+    OpenAddressTable primary = replica;
+    const size_t changes = entries * changed_percent / 100;
+    std::vector<uint64_t> keys;
+    for (const auto& entry : replica.data_) {
+        if (entry.status_ == 2 && keys.size() < changes) keys.push_back(entry.key_);
+    }
+    for (size_t i = 0; i < changes; i++) {
+        // a third each of updates, erases and new keys
+        if (i % 3 == 0) primary.insert(keys[i], i);
+        else if (i % 3 == 1) primary.erase(keys[i]);
+        else primary.insert(gen(), i);
+    }
+
+    std::cout << std::setw(16) << "method" << std::setw(10) << "seconds" << std::setw(12) << "changes" << "\n";
+    {
+        OpenAddressTable target = replica;
+        auto start = Clock::now();
+        const TableDelta delta = target.diff(primary);
+        target.apply_delta(delta);
+        report("diff + apply", seconds_since(start), delta.size());
+    }
+    {
+        OpenAddressTable target = replica;
+        auto start = Clock::now();
+        TableDelta delta;
+        for (const auto& entry : target.data_) {
+            if (entry.status_ != 2) continue;
+            auto val = primary.get(entry.key_);
+            if (!val) delta.removed_.push_back(entry.key_);
+            else if (*val != entry.val_) delta.updated_.emplace_back(entry.key_, *val);
+        }
+        for (const auto& entry : primary.data_) {
+            if (entry.status_ == 2 && !target.get(entry.key_)) delta.inserted_.emplace_back(entry.key_, entry.val_);
+        }
+        target.apply_delta(delta);
+        report("lookup both", seconds_since(start), delta.size());
+    }
+    {
+        auto start = Clock::now();
+        OpenAddressTable target;
+        target.reserve(primary.size());
+        for (const auto& entry : primary.data_) {
+            if (entry.status_ == 2) target.insert(entry.key_, entry.val_);
+        }
+        report("full reload", seconds_since(start), target.size());
+    }
+    return 0;
+}
@@ -0,0 +1,525 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "table.cpp"
+
+// disk-resident hash table for key sets larger than memory. the file is an
+// array of 4 KiB pages; page 0 is the header and every other page is a bucket
+// of 252 slots. a key hashes to one bucket page and to a home slot inside it,
+// and is linear-probed within that page, so a lookup reads one page. a full
+// page spills to the next one and counts the spill in its overflow_, which is
+// what tells a lookup to keep going; at the default load that is rare.
+//
+// pages are reached either through mmap, leaving caching to the kernel, or
+// through pread into a small buffer pool with clock eviction, which keeps the
+// table's memory bounded no matter how cold the access pattern is. writes are
+// made durable by flush(); the file is not crash consistent between flushes.
+
+static constexpr char DISK_TABLE_MAGIC[4] = {'O', 'A', 'T', 'D'};
+static constexpr uint8_t DISK_TABLE_VERSION = 1;
+static constexpr size_t DISK_PAGE_BYTES = 4096;
+
+struct DiskSlot {
+    uint64_t key_;
+    uint64_t val_;
+};
+
+struct DiskPageHeader {
+    uint32_t count_;
+    // entries homed here or on an earlier page of the chain stored past this page
+    uint32_t overflow_;
+    uint64_t occupied_[4];
+    uint8_t reserved_[24];
+};
+
+static constexpr size_t DISK_SLOTS_PER_PAGE = (DISK_PAGE_BYTES - sizeof(DiskPageHeader)) / sizeof(DiskSlot);
+
+struct DiskPage {
+    DiskPageHeader header_;
+    DiskSlot slots_[DISK_SLOTS_PER_PAGE];
+
+    bool occupied(size_t slot) const { return header_.occupied_[slot / 64] >> (slot % 64) & 1; }
+    void set_occupied(size_t slot, bool on) {
+        if (on) header_.occupied_[slot / 64] |= uint64_t(1) << (slot % 64);
+        else header_.occupied_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    }
+};
+
+static_assert(sizeof(DiskPage) == DISK_PAGE_BYTES, "a bucket is one page");
+
+struct DiskTableHeader {
+    char magic_[4];
+    uint8_t version_;
+    uint8_t reserved_[3];
+    uint64_t page_count_;
+    uint64_t size_;
+};
+
+enum class DiskAccess {
+    Pread,
+    Mmap
+};
+
+struct DiskTableConfig {
+    DiskAccess access = DiskAccess::Pread;
+    // buffer pool frames for DiskAccess::Pread
+    size_t cache_pages = 1024;
+    // sizes a new file; an existing file keeps its own
+    size_t initial_entries = 0;
+    // the bucket array doubles once the table is this full
+    double max_load_factor = 0.75;
+};
+
+// fixed set of page frames over a file, evicted in clock order. dirty frames
+// are written back when evicted and on flush()
+class BufferPool {
+public:
+    BufferPool(int fd, size_t frames) : fd_(fd), frames_(std::max<size_t>(frames, 2)) {
+        lookup_.reserve(frames_);
+        void* memory = nullptr;
+        if (posix_memalign(&memory, DISK_PAGE_BYTES, frames_ * DISK_PAGE_BYTES) != 0) {
+            throw std::bad_alloc();
+        }
+        memory_ = static_cast<char*>(memory);
+        frame_pages_.assign(frames_, NO_PAGE);
+        dirty_.assign(frames_, 0);
+        referenced_.assign(frames_, 0);
+    }
+
+    ~BufferPool() {
+        free(memory_);
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // the returned pointer is only valid until the next fetch
+    char* fetch(uint64_t page, bool for_write) {
+        size_t frame;
+        if (auto cached = lookup_.get(page)) {
+            frame = *cached;
+            ++hits_;
+        } else {
+            frame = evict();
+            char* data = memory_ + frame * DISK_PAGE_BYTES;
+            ssize_t n;
+            do {
+                n = pread(fd_, data, DISK_PAGE_BYTES, page * DISK_PAGE_BYTES);
+            } while (n < 0 && errno == EINTR);
+            if (n < 0) {
+                throw std::system_error(errno, std::generic_category(), "read disk table page");
+            }
+            // past the end of a sparse file reads as an empty page
+            std::memset(data + n, 0, DISK_PAGE_BYTES - n);
+            frame_pages_[frame] = page;
+            lookup_.insert(page, frame);
+            ++reads_;
+        }
+        referenced_[frame] = 1;
+        dirty_[frame] |= for_write;
+        return memory_ + frame * DISK_PAGE_BYTES;
+    }
+
+    // writes dirty frames back in page order
+    void flush() {
+        std::vector<std::pair<uint64_t, size_t>> dirty;
+        for (size_t frame = 0; frame < frames_; ++frame) {
+            if (dirty_[frame]) dirty.emplace_back(frame_pages_[frame], frame);
+        }
+        std::sort(dirty.begin(), dirty.end());
+        for (const auto& [page, frame] : dirty) {
+            write_back(frame);
+        }
+    }
+
+    size_t reads() const { return reads_; }
+    size_t writes() const { return writes_; }
+    size_t hits() const { return hits_; }
+
+private:
+    static constexpr uint64_t NO_PAGE = UINT64_MAX;
+
+    int fd_;
+    size_t frames_;
+    char* memory_;
+    OpenAddressTable lookup_;
+    std::vector<uint64_t> frame_pages_;
+    std::vector<char> dirty_;
+    std::vector<char> referenced_;
+    size_t hand_ = 0;
+    size_t reads_ = 0;
+    size_t writes_ = 0;
+    size_t hits_ = 0;
+
+    size_t evict() {
+        while (referenced_[hand_]) {
+            referenced_[hand_] = 0;
+            hand_ = (hand_ + 1) % frames_;
+        }
+        const size_t frame = hand_;
+        hand_ = (hand_ + 1) % frames_;
+        if (frame_pages_[frame] != NO_PAGE) {
+            if (dirty_[frame]) write_back(frame);
+            lookup_.erase(frame_pages_[frame]);
+            frame_pages_[frame] = NO_PAGE;
+        }
+        return frame;
+    }
+
+    void write_back(size_t frame) {
+        const char* data = memory_ + frame * DISK_PAGE_BYTES;
+        for (size_t done = 0; done < DISK_PAGE_BYTES;) {
+            ssize_t n = pwrite(fd_, data + done, DISK_PAGE_BYTES - done, frame_pages_[frame] * DISK_PAGE_BYTES + done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "write disk table page");
+            }
+            done += n;
+        }
+        dirty_[frame] = 0;
+        ++writes_;
+    }
+};
+
+class DiskTable {
+public:
+    // opens path, creating it sized for config.initial_entries if it does not exist
+    explicit DiskTable(const std::string& path, DiskTableConfig config = {}) : path_(path), config_(config) {
+        open_file();
+    }
+
+    ~DiskTable() {
+        try {
+            close_file(true);
+        } catch (const std::exception&) {
+            // nothing to report to; callers wanting errors call flush() first
+        }
+    }
+
+    DiskTable(const DiskTable&) = delete;
+    DiskTable& operator=(const DiskTable&) = delete;
+
+    std::optional<uint64_t> get(uint64_t key) {
+        const uint64_t hash = OpenAddressTable::hash_key(key);
+        uint64_t page_index = home_page(hash);
+        for (uint64_t walked = 0; walked < bucket_pages_; ++walked) {
+            const DiskPage* page = fetch(page_index, false);
+            const size_t slot = find_slot(*page, key, hash);
+            if (slot != DISK_SLOTS_PER_PAGE) {
+                return page->slots_[slot].val_;
+            }
+            if (page->header_.overflow_ == 0) {
+                break;
+            }
+            page_index = next_page(page_index);
+        }
+        return std::nullopt;
+    }
+
+    // true when the key was not present before
+    bool insert(uint64_t key, uint64_t val) {
+        const uint64_t hash = OpenAddressTable::hash_key(key);
+        if (update(key, val, hash)) {
+            return false;
+        }
+        if (size_ + 1 > capacity() * config_.max_load_factor) {
+            grow();
+        }
+        place(key, val, hash);
+        ++size_;
+        return true;
+    }
+
+    bool erase(uint64_t key) {
+        const uint64_t hash = OpenAddressTable::hash_key(key);
+        const uint64_t home = home_page(hash);
+        uint64_t page_index = home;
+        uint64_t walked = 0;
+        for (; walked < bucket_pages_; ++walked) {
+            DiskPage* page = fetch(page_index, false);
+            const size_t slot = find_slot(*page, key, hash);
+            if (slot != DISK_SLOTS_PER_PAGE) {
+                page = fetch(page_index, true);
+                remove_slot(*page, slot);
+                break;
+            }
+            if (page->header_.overflow_ == 0) {
+                return false;
+            }
+            page_index = next_page(page_index);
+        }
+        if (walked == bucket_pages_) {
+            return false;
+        }
+        // the pages it spilled past no longer carry it
+        for (uint64_t i = 0, p = home; i < walked; ++i, p = next_page(p)) {
+            fetch(p, true)->header_.overflow_--;
+        }
+        --size_;
+        return true;
+    }
+
+    // writes dirty pages and the header, then syncs the file
+    void flush() {
+        if (pool_) {
+            pool_->flush();
+        }
+        write_header();
+        if (map_ != nullptr && msync(map_, file_bytes(), MS_SYNC) < 0) {
+            throw std::system_error(errno, std::generic_category(), "msync " + path_);
+        }
+        if (fdatasync(fd_) < 0) {
+            throw std::system_error(errno, std::generic_category(), "fdatasync " + path_);
+        }
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t bucket_pages() const { return bucket_pages_; }
+
+    size_t capacity() const { return bucket_pages_ * DISK_SLOTS_PER_PAGE; }
+
+    double load_factor() const { return static_cast<double>(size_) / capacity(); }
+
+    // pages read from the file, and found in the pool; zero with mmap
+    size_t page_reads() const { return pool_ ? pool_->reads() : 0; }
+    size_t page_hits() const { return pool_ ? pool_->hits() : 0; }
+
+    // for tests and the benchmark: drop the file from the kernel's page cache
+    void drop_page_cache() {
+        flush();
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED);
+        if (map_ != nullptr) {
+            madvise(map_, file_bytes(), MADV_DONTNEED);
+        }
+    }
+
+private:
+    std::string path_;
+    DiskTableConfig config_;
+    int fd_ = -1;
+    uint64_t bucket_pages_ = 0;
+    size_t size_ = 0;
+    char* map_ = nullptr;
+    std::unique_ptr<BufferPool> pool_;
+
+    size_t file_bytes() const { return (bucket_pages_ + 1) * DISK_PAGE_BYTES; }
+
+    // bucket i is file page i + 1
+    DiskPage* fetch(uint64_t bucket, bool for_write) {
+        if (map_ != nullptr) {
+            return reinterpret_cast<DiskPage*>(map_ + (bucket + 1) * DISK_PAGE_BYTES);
+        }
+        return reinterpret_cast<DiskPage*>(pool_->fetch(bucket + 1, for_write));
+    }
+
+    uint64_t home_page(uint64_t hash) const { return hash & (bucket_pages_ - 1); }
+
+    uint64_t next_page(uint64_t page) const { return (page + 1) & (bucket_pages_ - 1); }
+
+    // the slot bits come from the other end of the hash than the page bits
+    static size_t home_slot(uint64_t hash) { return (hash >> 32) % DISK_SLOTS_PER_PAGE; }
+
+    // the key's slot in this page, or DISK_SLOTS_PER_PAGE
+    static size_t find_slot(const DiskPage& page, uint64_t key, uint64_t hash) {
+        size_t slot = home_slot(hash);
+        for (size_t probed = 0; probed < DISK_SLOTS_PER_PAGE && page.occupied(slot); ++probed) {
+            if (page.slots_[slot].key_ == key) {
+                return slot;
+            }
+            slot = slot + 1 == DISK_SLOTS_PER_PAGE ? 0 : slot + 1;
+        }
+        return DISK_SLOTS_PER_PAGE;
+    }
+
+    bool update(uint64_t key, uint64_t val, uint64_t hash) {
+        uint64_t page_index = home_page(hash);
+        for (uint64_t walked = 0; walked < bucket_pages_; ++walked) {
+            DiskPage* page = fetch(page_index, false);
+            const size_t slot = find_slot(*page, key, hash);
+            if (slot != DISK_SLOTS_PER_PAGE) {
+                fetch(page_index, true)->slots_[slot].val_ = val;
+                return true;
+            }
+            if (page->header_.overflow_ == 0) {
+                return false;
+            }
+            page_index = next_page(page_index);
+        }
+        return false;
+    }
+
+    // stores a key known to be absent in the first page of its chain with room
+    void place(uint64_t key, uint64_t val, uint64_t hash) {
+        const uint64_t home = home_page(hash);
+        uint64_t page_index = home;
+        uint64_t walked = 0;
+        while (fetch(page_index, false)->header_.count_ == DISK_SLOTS_PER_PAGE) {
+            page_index = next_page(page_index);
+            ++walked;
+        }
+        DiskPage* page = fetch(page_index, true);
+        size_t slot = home_slot(hash);
+        while (page->occupied(slot)) {
+            slot = slot + 1 == DISK_SLOTS_PER_PAGE ? 0 : slot + 1;
+        }
+        page->slots_[slot] = DiskSlot{key, val};
+        page->set_occupied(slot, true);
+        page->header_.count_++;
+        for (uint64_t i = 0, p = home; i < walked; ++i, p = next_page(p)) {
+            fetch(p, true)->header_.overflow_++;
+        }
+    }
+
+    // linear-probing delete: later entries of the cluster that may move back into
+    // the hole do, so probes still stop at the first empty slot
+    static void remove_slot(DiskPage& page, size_t hole) {
+        size_t slot = hole;
+        for (size_t probed = 1; probed < DISK_SLOTS_PER_PAGE; ++probed) {
+            slot = slot + 1 == DISK_SLOTS_PER_PAGE ? 0 : slot + 1;
+            if (!page.occupied(slot)) {
+                break;
+            }
+            const size_t home = home_slot(OpenAddressTable::hash_key(page.slots_[slot].key_));
+            // the entry may fill the hole unless its home lies cyclically in (hole, slot]
+            const bool home_after_hole = hole <= slot ? (hole < home && home <= slot) : (hole < home || home <= slot);
+            if (!home_after_hole) {
+                page.slots_[hole] = page.slots_[slot];
+                hole = slot;
+            }
+        }
+        page.set_occupied(hole, false);
+        page.header_.count_--;
+    }
+
+    static uint64_t pages_for(size_t entries, double max_load) {
+        uint64_t pages = 1;
+        while (pages * DISK_SLOTS_PER_PAGE * max_load < entries) {
+            pages *= 2;
+        }
+        return pages;
+    }
+
+    void open_file() {
+        fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path_);
+        }
+        struct stat st;
+        if (fstat(fd_, &st) < 0) {
+            throw std::system_error(errno, std::generic_category(), "stat " + path_);
+        }
+        if (st.st_size == 0) {
+            bucket_pages_ = pages_for(config_.initial_entries, config_.max_load_factor);
+            size_ = 0;
+            // sparse: untouched buckets read back as zero pages
+            if (ftruncate(fd_, file_bytes()) < 0) {
+                throw std::system_error(errno, std::generic_category(), "truncate " + path_);
+            }
+            write_header();
+        } else {
+            DiskTableHeader header;
+            if (pread(fd_, &header, sizeof(header), 0) != sizeof(header) ||
+                std::memcmp(header.magic_, DISK_TABLE_MAGIC, sizeof(DISK_TABLE_MAGIC)) != 0) {
+                throw std::runtime_error("not a disk table file: " + path_);
+            }
+            if (header.version_ != DISK_TABLE_VERSION) {
+                throw std::runtime_error("unsupported disk table version in: " + path_);
+            }
+            if (header.page_count_ == 0 || (header.page_count_ & (header.page_count_ - 1)) != 0 ||
+                static_cast<uint64_t>(st.st_size) != (header.page_count_ + 1) * DISK_PAGE_BYTES) {
+                throw std::runtime_error("corrupt disk table header in: " + path_);
+            }
+            bucket_pages_ = header.page_count_;
+            size_ = header.size_;
+        }
+
+        if (config_.access == DiskAccess::Mmap) {
+            void* map = mmap(nullptr, file_bytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (map == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "mmap " + path_);
+            }
+            map_ = static_cast<char*>(map);
+            // lookups land on random pages; readahead would only evict useful ones
+            madvise(map_, file_bytes(), MADV_RANDOM);
+        } else {
+            pool_ = std::make_unique<BufferPool>(fd_, config_.cache_pages);
+            posix_fadvise(fd_, 0, 0, POSIX_FADV_RANDOM);
+        }
+    }
+
+    void close_file(bool keep) {
+        if (fd_ < 0) {
+            return;
+        }
+        if (keep) {
+            flush();
+        }
+        if (map_ != nullptr) {
+            munmap(map_, file_bytes());
+            map_ = nullptr;
+        }
+        pool_.reset();
+        close(fd_);
+        fd_ = -1;
+    }
+
+    void write_header() {
+        DiskTableHeader header{};
+        std::memcpy(header.magic_, DISK_TABLE_MAGIC, sizeof(DISK_TABLE_MAGIC));
+        header.version_ = DISK_TABLE_VERSION;
+        header.page_count_ = bucket_pages_;
+        header.size_ = size_;
+        if (pwrite(fd_, &header, sizeof(header), 0) != sizeof(header)) {
+            throw std::system_error(errno, std::generic_category(), "write header " + path_);
+        }
+    }
+
+    // rebuilds into a file with twice the buckets and swaps it in. doubling splits
+    // bucket b into b and b + old count, so the new file is written in two
+    // ascending streams and the pool sees mostly sequential pages
+    void grow() {
+        const std::string grow_path = path_ + ".grow";
+        std::remove(grow_path.c_str());
+        {
+            DiskTableConfig grown_config = config_;
+            grown_config.initial_entries = capacity() * 2 * config_.max_load_factor;
+            DiskTable grown(grow_path, grown_config);
+            std::vector<DiskSlot> entries;
+            for (uint64_t b = 0; b < bucket_pages_; ++b) {
+                const DiskPage* page = fetch(b, false);
+                entries.clear();
+                for (size_t slot = 0; slot < DISK_SLOTS_PER_PAGE; ++slot) {
+                    if (page->occupied(slot)) entries.push_back(page->slots_[slot]);
+                }
+                for (const DiskSlot& entry : entries) {
+                    grown.place(entry.key_, entry.val_, OpenAddressTable::hash_key(entry.key_));
+                }
+            }
+            grown.size_ = size_;
+            grown.flush();
+        }
+        close_file(false);
+        if (rename(grow_path.c_str(), path_.c_str()) < 0) {
+            throw std::system_error(errno, std::generic_category(), "rename " + grow_path);
+        }
+        open_file();
+    }
+};
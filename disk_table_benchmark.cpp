@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include "disk_table.cpp"
+
+// usage: disk_table_benchmark [dir=/tmp] [entries=20000000] [cache_pages=4096] [lookups=200000]
+//
+// builds a DiskTable of `entries` keys in dir, then times random lookups through
+// the pread buffer pool and through mmap, each starting with the file dropped
+// from the page cache. pick entries so the file (about entries / 189 pages of
+// 4 KiB) is larger than the machine's RAM to measure the device rather than the
+// page cache
+
+const size_t DEFAULT_ENTRIES = 20'000'000;
+const size_t DEFAULT_CACHE_PAGES = 4096;
+const size_t DEFAULT_LOOKUPS = 200'000;
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    const std::string path = std::string(argc > 1 ? argv[1] : "/tmp") + "/disk_table_benchmark.dat";
+    const size_t entries = argc > 2 ? std::stoull(argv[2]) : DEFAULT_ENTRIES;
+    const size_t cache_pages = argc > 3 ? std::stoull(argv[3]) : DEFAULT_CACHE_PAGES;
+    const size_t lookups = argc > 4 ? std::stoull(argv[4]) : DEFAULT_LOOKUPS;
+
+    std::remove(path.c_str());
+    {
+        DiskTableConfig config;
+        config.access = DiskAccess::Mmap;
+        config.initial_entries = entries;
+        auto start = Clock::now();
+        DiskTable table(path, config);
+        for (uint64_t key = 0; key < entries; key++) {
+            table.insert(key, key);
+        }
+        table.flush();
+        std::cout << "built " << entries << " entries in " << table.bucket_pages() << " pages ("
+                  << table.bucket_pages() * DISK_PAGE_BYTES / (1 << 20) << " MiB) in " << std::fixed
+                  << std::setprecision(2) << seconds_since(start) << " s\n";
+    }
+
+    std::cout << std::setw(8) << "access" << std::setw(14) << "lookups/s" << std::setw(12) << "us/lookup"
+              << std::setw(14) << "reads/lookup" << "\n";
+    for (DiskAccess access : {DiskAccess::Pread, DiskAccess::Mmap}) {
+        DiskTableConfig config;
+        config.access = access;
+        config.cache_pages = cache_pages;
+        DiskTable table(path, config);
+        table.drop_page_cache();
+
+        std::mt19937_64 gen(42);
+        size_t found = 0;
+        const size_t reads_before = table.page_reads();
+        auto start = Clock::now();
+        for (size_t i = 0; i < lookups; i++) {
+            found += table.get(gen() % entries).has_value();
+        }
+        const double seconds = seconds_since(start);
+        if (found != lookups) {
+            std::cerr << "missing keys: " << lookups - found << "\n";
+            return 1;
+        }
+        std::cout << std::setw(8) << (access == DiskAccess::Pread ? "pread" : "mmap") << std::setw(14)
+                  << std::setprecision(0) << lookups / seconds << std::setw(12) << std::setprecision(2)
+                  << seconds * 1e6 / lookups << std::setw(14);
+        if (access == DiskAccess::Pread) {
+            std::cout << std::setprecision(3) << static_cast<double>(table.page_reads() - reads_before) / lookups;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << "\n";
+    }
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include "disk_table.cpp"
+
+class DiskTableTest : public ::testing::TestWithParam<DiskAccess> {
+protected:
+    std::string path;
+
+    void SetUp() override {
+        path = ::testing::TempDir() + "oat_disk_table_test.dat";
+        std::remove(path.c_str());
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+        std::remove((path + ".grow").c_str());
+    }
+
+    DiskTableConfig config() const {
+        DiskTableConfig config;
+        config.access = GetParam();
+        // far fewer frames than pages, so the pool evicts and writes back
+        config.cache_pages = 8;
+        return config;
+    }
+};
+
+TEST_P(DiskTableTest, InsertGetEraseUpdate) {
+    DiskTable table(path, config());
+    EXPECT_EQ(table.get(1), std::nullopt);
+    EXPECT_TRUE(table.insert(1, 10));
+    EXPECT_FALSE(table.insert(1, 11));
+    EXPECT_EQ(table.get(1), std::optional<uint64_t>(11));
+    EXPECT_TRUE(table.erase(1));
+    EXPECT_FALSE(table.erase(1));
+    EXPECT_EQ(table.get(1), std::nullopt);
+    EXPECT_TRUE(table.empty());
+}
+
+TEST_P(DiskTableTest, GrowsAndMatchesReference) {
+    DiskTable table(path, config());
+    std::unordered_map<uint64_t, uint64_t> reference;
+    std::mt19937_64 gen(42);
+    for (size_t i = 0; i < 60000; i++) {
+        const uint64_t key = gen() % 40000;
+        if (gen() % 4 == 0) {
+            ASSERT_EQ(table.erase(key), reference.erase(key) == 1);
+        } else {
+            ASSERT_EQ(table.insert(key, i), reference.count(key) == 0);
+            reference[key] = i;
+        }
+    }
+    EXPECT_EQ(table.size(), reference.size());
+    EXPECT_GT(table.bucket_pages(), 64);
+    EXPECT_LE(table.load_factor(), 0.75);
+    for (uint64_t key = 0; key < 40000; key++) {
+        auto it = reference.find(key);
+        ASSERT_EQ(table.get(key), it == reference.end() ? std::nullopt : std::optional<uint64_t>(it->second));
+    }
+}
+
+TEST_P(DiskTableTest, SpillsPastFullPages) {
+    DiskTableConfig full = config();
+    // nearly full pages overflow into their neighbours
+    full.max_load_factor = 0.99;
+    full.initial_entries = 4 * DISK_SLOTS_PER_PAGE * 0.99;
+    DiskTable table(path, full);
+    const size_t count = table.capacity() * 0.98;
+    for (uint64_t key = 0; key < count; key++) {
+        table.insert(key, key * 3);
+    }
+    EXPECT_EQ(table.bucket_pages(), 4);
+    for (uint64_t key = 0; key < count; key += 2) {
+        ASSERT_TRUE(table.erase(key));
+    }
+    for (uint64_t key = 0; key < count; key++) {
+        ASSERT_EQ(table.get(key), key % 2 == 0 ? std::nullopt : std::optional<uint64_t>(key * 3));
+    }
+    for (uint64_t key = 0; key < count; key += 2) {
+        ASSERT_TRUE(table.insert(key, key));
+    }
+    EXPECT_EQ(table.size(), count);
+}
+
+TEST_P(DiskTableTest, ReopensFromFile) {
+    {
+        DiskTable table(path, config());
+        for (uint64_t key = 0; key < 5000; key++) {
+            table.insert(key * 7919, key);
+        }
+        table.flush();
+    }
+    DiskTable table(path, config());
+    EXPECT_EQ(table.size(), 5000);
+    for (uint64_t key = 0; key < 5000; key++) {
+        ASSERT_EQ(table.get(key * 7919), std::optional<uint64_t>(key));
+    }
+    EXPECT_EQ(table.get(1), std::nullopt);
+}
+
+INSTANTIATE_TEST_SUITE_P(Access, DiskTableTest, ::testing::Values(DiskAccess::Pread, DiskAccess::Mmap),
+                         [](const auto& info) { return info.param == DiskAccess::Pread ? "pread" : "mmap"; });
+
+TEST(DiskTablePoolTest, LookupReadsOnePage) {
+    const std::string path = ::testing::TempDir() + "oat_disk_table_pool_test.dat";
+    std::remove(path.c_str());
+    {
+        DiskTableConfig config;
+        config.initial_entries = 100000;
+        config.cache_pages = 2;
+        DiskTable table(path, config);
+        for (uint64_t key = 0; key < 100000; key++) {
+            table.insert(key, key);
+        }
+        const size_t before = table.page_reads();
+        for (uint64_t key = 0; key < 10000; key++) {
+            ASSERT_EQ(table.get(key), std::optional<uint64_t>(key));
+        }
+        EXPECT_LT(table.page_reads() - before, 10000 * 1.05);
+    }
+    std::remove(path.c_str());
+}
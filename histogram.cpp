@@ -0,0 +1,114 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// log-linear latency histogram in the style of hdrhistogram: values below 128
+// are exact, above that every power of two is split into 64 buckets, so any
+// recorded value is reported within 1/64 (~1.6%) of itself while the whole
+// uint64 range fits in a few thousand counters. recording is a shift and an
+// add, cheap enough to time every request.
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 128;
+    static constexpr size_t HALF_SUB_BUCKETS = SUB_BUCKETS / 2;
+    // exponents 1..57 cover values up to 2^64
+    static constexpr size_t BUCKET_COUNT = SUB_BUCKETS + 57 * HALF_SUB_BUCKETS;
+
+    LatencyHistogram() : counts_(BUCKET_COUNT, 0), total_(0), max_(0), min_(UINT64_MAX), sum_(0) {}
+
+    static size_t index_of(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return value;
+        }
+        const size_t exponent = 63 - __builtin_clzll(value) - 6;
+        const size_t mantissa = value >> exponent;
+        return SUB_BUCKETS + (exponent - 1) * HALF_SUB_BUCKETS + (mantissa - HALF_SUB_BUCKETS);
+    }
+
+    // largest value that lands in the bucket, what percentiles report
+    static uint64_t highest_equivalent(size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        const size_t exponent = (index - SUB_BUCKETS) / HALF_SUB_BUCKETS + 1;
+        const uint64_t mantissa = (index - SUB_BUCKETS) % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+        return ((mantissa + 1) << exponent) - 1;
+    }
+
+    void record(uint64_t value, uint64_t count = 1) {
+        counts_[index_of(value)] += count;
+        total_ += count;
+        sum_ += static_cast<double>(value) * count;
+        max_ = std::max(max_, value);
+        min_ = std::min(min_, value);
+    }
+
+    // coordinated omission correction for a sampler that meant to issue one request
+    // every expected_interval: a value of k intervals means the k - 1 requests queued
+    // behind it would have waited value - interval, value - 2 * interval, ... so those
+    // are recorded too, as if they had been sent on time
+    void record_corrected(uint64_t value, uint64_t expected_interval) {
+        record(value);
+        if (expected_interval == 0) {
+            return;
+        }
+        for (uint64_t missing = value; missing > expected_interval;) {
+            missing -= expected_interval;
+            record(missing);
+        }
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+        min_ = std::min(min_, other.min_);
+    }
+
+    // smallest recorded value v such that a fraction q of the samples are <= v
+    uint64_t percentile(double q) const {
+        if (total_ == 0) {
+            return 0;
+        }
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * total_)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                return std::min(highest_equivalent(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    uint64_t count() const { return total_; }
+
+    uint64_t max() const { return max_; }
+
+    uint64_t min() const { return total_ == 0 ? 0 : min_; }
+
+    double mean() const { return total_ == 0 ? 0.0 : sum_ / total_; }
+
+    // non-empty buckets as (highest equivalent value, count), for dumping a distribution
+    std::vector<std::pair<uint64_t, uint64_t>> buckets() const {
+        std::vector<std::pair<uint64_t, uint64_t>> out;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            if (counts_[i] != 0) {
+                out.emplace_back(std::min(highest_equivalent(i), max_), counts_[i]);
+            }
+        }
+        return out;
+    }
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t max_;
+    uint64_t min_;
+    double sum_;
+};
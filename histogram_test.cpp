@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "histogram.cpp"
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+    LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 100; v++) {
+        histogram.record(v);
+    }
+    EXPECT_EQ(histogram.count(), 100);
+    EXPECT_EQ(histogram.min(), 1);
+    EXPECT_EQ(histogram.max(), 100);
+    EXPECT_EQ(histogram.percentile(0.5), 50);
+    EXPECT_EQ(histogram.percentile(0.99), 99);
+    EXPECT_EQ(histogram.percentile(1.0), 100);
+    EXPECT_DOUBLE_EQ(histogram.mean(), 50.5);
+}
+
+TEST(LatencyHistogramTest, LargeValuesWithinRelativeError) {
+    std::mt19937_64 gen(42);
+    for (int i = 0; i < 100000; i++) {
+        const uint64_t value = gen() >> (gen() % 64);
+        const size_t index = LatencyHistogram::index_of(value);
+        ASSERT_LT(index, LatencyHistogram::BUCKET_COUNT);
+        const uint64_t reported = LatencyHistogram::highest_equivalent(index);
+        EXPECT_GE(reported, value);
+        EXPECT_LE(reported - value, value / 64 + 1);
+        // buckets are ordered, so the next one starts past this one
+        if (index + 1 < LatencyHistogram::BUCKET_COUNT) {
+            EXPECT_GT(LatencyHistogram::highest_equivalent(index + 1), reported);
+        }
+    }
+    EXPECT_EQ(LatencyHistogram::index_of(UINT64_MAX), LatencyHistogram::BUCKET_COUNT - 1);
+}
+
+TEST(LatencyHistogramTest, PercentilesOfUniformSample) {
+    LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 1000000; v++) {
+        histogram.record(v * 1000);
+    }
+    EXPECT_NEAR(histogram.percentile(0.5), 500e6, 500e6 / 64);
+    EXPECT_NEAR(histogram.percentile(0.99), 990e6, 990e6 / 64);
+    EXPECT_EQ(histogram.percentile(1.0), 1000000000);
+}
+
+// one stall of ten intervals stands for the nine requests that queued behind it
+TEST(LatencyHistogramTest, CorrectionBackfillsQueuedRequests) {
+    LatencyHistogram raw;
+    LatencyHistogram corrected;
+    for (int i = 0; i < 90; i++) {
+        raw.record(10);
+        corrected.record_corrected(10, 100);
+    }
+    raw.record(1000);
+    corrected.record_corrected(1000, 100);
+
+    EXPECT_EQ(raw.count(), 91);
+    EXPECT_EQ(corrected.count(), 100);
+    EXPECT_EQ(raw.percentile(0.95), 10);
+    EXPECT_NEAR(corrected.percentile(0.95), 500, 500 / 64);
+    EXPECT_EQ(corrected.max(), 1000);
+}
+
+TEST(LatencyHistogramTest, MergeAddsCounts) {
+    LatencyHistogram a;
+    LatencyHistogram b;
+    a.record(5, 3);
+    b.record(5000);
+    b.record(7);
+    a.merge(b);
+
+    EXPECT_EQ(a.count(), 5);
+    EXPECT_EQ(a.min(), 5);
+    EXPECT_EQ(a.max(), 5000);
+    EXPECT_EQ(a.percentile(0.6), 5);
+    EXPECT_EQ(a.percentile(0.8), 7);
+    EXPECT_EQ(a.buckets().size(), 3);
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "xxhash/xxhash.h"
+
+// hopscotch hashing: every key sits within NEIGHBOURHOOD slots of its home, and
+// the home slot carries a bitmap of which of those slots hold its keys. lookups
+// test only the flagged slots, which in practice are the first one or two cache
+// lines after home, and never move entries around, so unlike robin-hood's
+// shifting a reader only races with writers touching the same neighbourhood.
+class HopscotchTable {
+public:
+    struct Slot {
+        uint64_t key_;
+        uint64_t val_;
+        // bit i set when slot home + i holds a key whose home is this slot
+        uint32_t hop_info_;
+        uint8_t status_;
+        // 0 for empty, 2 for filled
+    };
+
+    static constexpr size_t NEIGHBOURHOOD = 32;
+    static constexpr double LOAD_FACTOR_THRESHOLD = 0.85;
+    // how far to scan for a free slot before declaring the table too crowded
+    static constexpr size_t MAX_FREE_SCAN = 4096;
+
+    explicit HopscotchTable(size_t initial_size = 64) : size_(0) {
+        size_t capacity = NEIGHBOURHOOD;
+        while (capacity < initial_size) capacity <<= 1;
+        data_.assign(capacity, Slot{0, 0, 0, 0});
+    }
+
+    static size_t hash_key(uint64_t key) {
+        return XXH64(&key, sizeof(key), 0);
+    }
+
+    bool insert(uint64_t key, uint64_t val) {
+        const size_t pos = find(key);
+        if (pos != SIZE_MAX) {
+            data_[pos].val_ = val;
+            return true;
+        }
+
+        if (static_cast<double>(size_ + 1) > data_.size() * LOAD_FACTOR_THRESHOLD) {
+            resize();
+        }
+        while (!place(key, val)) {
+            resize();
+        }
+        ++size_;
+        return true;
+    }
+
+    __attribute__((always_inline))
+    std::optional<uint64_t> get(uint64_t key) const {
+        const size_t pos = find(key);
+        if (pos == SIZE_MAX) {
+            return std::nullopt;
+        }
+        return data_[pos].val_;
+    }
+
+    bool erase(uint64_t key) {
+        const size_t mask = data_.size() - 1;
+        const size_t home = hash_key(key) & mask;
+
+        for (uint32_t hops = data_[home].hop_info_; hops != 0; hops &= hops - 1) {
+            const size_t offset = __builtin_ctz(hops);
+            Slot& slot = data_[(home + offset) & mask];
+            if (slot.key_ == key) {
+                slot.status_ = 0;
+                data_[home].hop_info_ &= ~(uint32_t(1) << offset);
+                --size_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t capacity() const { return data_.size(); }
+
+    double load_factor() const { return static_cast<double>(size_) / data_.size(); }
+
+private:
+    std::vector<Slot> data_;
+    size_t size_;
+
+    __attribute__((always_inline))
+    size_t find(uint64_t key) const {
+        const size_t mask = data_.size() - 1;
+        const size_t home = hash_key(key) & mask;
+
+        for (uint32_t hops = data_[home].hop_info_; hops != 0; hops &= hops - 1) {
+            const size_t pos = (home + __builtin_ctz(hops)) & mask;
+            if (data_[pos].key_ == key) {
+                return pos;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+    // false when no free slot can be hopped into the neighbourhood, the caller grows and retries
+    bool place(uint64_t key, uint64_t val) {
+        const size_t mask = data_.size() - 1;
+        const size_t home = hash_key(key) & mask;
+
+        size_t dist = 0;
+        while (data_[(home + dist) & mask].status_ != 0) {
+            if (++dist >= std::min(MAX_FREE_SCAN, data_.size())) {
+                return false;
+            }
+        }
+
+        // pull the free slot back towards home by moving a nearer key into it
+        while (dist >= NEIGHBOURHOOD) {
+            const size_t free_pos = (home + dist) & mask;
+            bool moved = false;
+
+            for (size_t back = NEIGHBOURHOOD - 1; back > 0 && !moved; --back) {
+                const size_t candidate_home = (free_pos - back) & mask;
+                // only a key of candidate_home that sits before the free slot may move into it
+                const uint32_t movable = data_[candidate_home].hop_info_ & ((uint32_t(1) << back) - 1);
+                if (movable == 0) {
+                    continue;
+                }
+
+                const size_t offset = __builtin_ctz(movable);
+                const size_t from = (candidate_home + offset) & mask;
+                data_[free_pos].key_ = data_[from].key_;
+                data_[free_pos].val_ = data_[from].val_;
+                data_[free_pos].status_ = 2;
+                data_[from].status_ = 0;
+                data_[candidate_home].hop_info_ = (data_[candidate_home].hop_info_ & ~(uint32_t(1) << offset)) |
+                                                  (uint32_t(1) << back);
+
+                dist -= back - offset;
+                moved = true;
+            }
+
+            if (!moved) {
+                return false;
+            }
+        }
+
+        Slot& slot = data_[(home + dist) & mask];
+        slot.key_ = key;
+        slot.val_ = val;
+        slot.status_ = 2;
+        data_[home].hop_info_ |= uint32_t(1) << dist;
+        return true;
+    }
+
+    void resize() {
+        std::vector<Slot> old = std::move(data_);
+        for (size_t new_size = old.size() * 2; ; new_size *= 2) {
+            data_.assign(new_size, Slot{0, 0, 0, 0});
+            bool placed_all = true;
+            for (const auto& slot : old) {
+                if (slot.status_ == 2 && !place(slot.key_, slot.val_)) {
+                    placed_all = false;
+                    break;
+                }
+            }
+            if (placed_all) {
+                return;
+            }
+        }
+    }
+};
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <unordered_map>
+#include "hopscotch_table.cpp"
+
+class HopscotchTableTest : public ::testing::Test {
+protected:
+    HopscotchTable table;
+
+    void SetUp() override {
+        table = HopscotchTable(32);
+    }
+};
+
+TEST_F(HopscotchTableTest, BasicOperations) {
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(table.capacity(), HopscotchTable::NEIGHBOURHOOD);
+    EXPECT_FALSE(table.get(1).has_value());
+
+    EXPECT_TRUE(table.insert(1, 100));
+    EXPECT_TRUE(table.insert(1, 200));
+    EXPECT_EQ(table.size(), 1);
+    EXPECT_EQ(table.get(1).value(), 200);
+
+    EXPECT_TRUE(table.erase(1));
+    EXPECT_FALSE(table.erase(1));
+    EXPECT_TRUE(table.empty());
+}
+
+TEST_F(HopscotchTableTest, KeysStayInsideTheirNeighbourhood) {
+    table = HopscotchTable(1 << 12);
+    std::mt19937_64 gen(42);
+    std::vector<uint64_t> keys;
+
+    while (table.load_factor() < 0.8) {
+        keys.push_back(gen());
+        EXPECT_TRUE(table.insert(keys.back(), keys.size()));
+    }
+    EXPECT_EQ(table.capacity(), 1 << 12);
+
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(table.get(keys[i]), std::optional<uint64_t>(i + 1));
+    }
+    for (size_t i = 0; i < keys.size(); i += 2) {
+        EXPECT_TRUE(table.erase(keys[i]));
+    }
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(table.get(keys[i]).has_value(), i % 2 == 1);
+    }
+}
+
+TEST_F(HopscotchTableTest, CollidingKeysGrowTheTable) {
+    const size_t mask = table.capacity() - 1;
+    std::vector<uint64_t> keys;
+
+    // more keys share one home than a neighbourhood can hold, so placement has to grow
+    for (uint64_t key = 0; keys.size() < HopscotchTable::NEIGHBOURHOOD + 8; key++) {
+        if ((HopscotchTable::hash_key(key) & mask) == 3) {
+            keys.push_back(key);
+            EXPECT_TRUE(table.insert(key, key));
+        }
+    }
+    EXPECT_GT(table.capacity(), mask + 1);
+    for (auto key : keys) {
+        EXPECT_EQ(table.get(key), std::optional<uint64_t>(key));
+    }
+}
+
+TEST_F(HopscotchTableTest, MatchesUnorderedMap) {
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<uint64_t> dis(0, 5000);
+    std::unordered_map<uint64_t, uint64_t> reference_map;
+
+    for (size_t i = 0; i < 50000; i++) {
+        uint64_t key = dis(gen);
+        switch (i % 3) {
+            case 0:
+                table.insert(key, i);
+                reference_map[key] = i;
+                break;
+            case 1: {
+                auto it = reference_map.find(key);
+                auto expected = it == reference_map.end() ? std::nullopt : std::optional<uint64_t>(it->second);
+                EXPECT_EQ(table.get(key), expected);
+                break;
+            }
+            case 2:
+                EXPECT_EQ(table.erase(key), reference_map.erase(key) > 0);
+                break;
+        }
+    }
+
+    EXPECT_EQ(table.size(), reference_map.size());
+    for (const auto& [key, value] : reference_map) {
+        EXPECT_EQ(table.get(key), std::optional<uint64_t>(value));
+    }
+}
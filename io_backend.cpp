@@ -0,0 +1,376 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define OAT_HAVE_IO_URING 1
+#else
+#define OAT_HAVE_IO_URING 0
+#endif
+
+// sequential file output for snapshots and the log. with io_uring, a writer
+// keeps several large buffers in flight and only blocks when all of them are
+// busy; without it, or when the kernel refuses a ring (old kernels, seccomp),
+// the same calls turn into plain pwrites. O_DIRECT keeps a multi-GiB snapshot
+// out of the page cache, where it would otherwise evict the pages the table
+// threads are using; filesystems without it (tmpfs) silently get buffered io.
+//
+// the ring is driven with raw syscalls on the kernel's uapi header rather than
+// liburing, so there is nothing extra to link.
+
+static constexpr size_t DIRECT_IO_ALIGNMENT = 4096;
+
+#if OAT_HAVE_IO_URING
+
+// one submission queue and one completion queue, used by a single thread
+class IoUring {
+public:
+    // nullptr when the kernel has no io_uring or does not allow it here
+    static std::unique_ptr<IoUring> create(unsigned entries) {
+        io_uring_params params{};
+        const int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return nullptr;
+        }
+        std::unique_ptr<IoUring> ring(new IoUring(fd, params));
+        if (!ring->map()) {
+            return nullptr;
+        }
+        return ring;
+    }
+
+    ~IoUring() {
+        if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_bytes_);
+        if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_bytes_);
+        if (sq_ring_ != MAP_FAILED) munmap(sq_ring_, sq_ring_bytes_);
+        close(fd_);
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // offset -1 writes at the file position and advances it
+    bool queue_write(int fd, const void* data, size_t len, int64_t offset, uint64_t user_data, bool link = false) {
+        io_uring_sqe* sqe = next_sqe();
+        if (sqe == nullptr) return false;
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(data);
+        sqe->len = static_cast<uint32_t>(len);
+        sqe->off = static_cast<uint64_t>(offset);
+        sqe->flags = link ? IOSQE_IO_LINK : 0;
+        sqe->user_data = user_data;
+        return true;
+    }
+
+    bool queue_fdatasync(int fd, uint64_t user_data) {
+        io_uring_sqe* sqe = next_sqe();
+        if (sqe == nullptr) return false;
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->user_data = user_data;
+        return true;
+    }
+
+    // submits everything queued and waits for at least wait_for completions
+    void submit(unsigned wait_for = 0) {
+        while (true) {
+            const long n = syscall(__NR_io_uring_enter, fd_, unsubmitted_, wait_for,
+                                   wait_for > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (n >= 0) {
+                unsubmitted_ -= static_cast<unsigned>(n);
+                if (unsubmitted_ == 0) return;
+                continue;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+            }
+        }
+    }
+
+    // false when no completion is ready
+    bool pop(uint64_t& user_data, int& result) {
+        const unsigned head = *cq_head_;
+        if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+        user_data = cqe.user_data;
+        result = cqe.res;
+        __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // writes with offset -1 need this (5.6+)
+    bool supports_current_position() const { return (params_.features & IORING_FEAT_RW_CUR_POS) != 0; }
+
+private:
+    int fd_;
+    io_uring_params params_;
+    void* sq_ring_ = MAP_FAILED;
+    void* cq_ring_ = MAP_FAILED;
+    void* sqes_ = MAP_FAILED;
+    size_t sq_ring_bytes_ = 0;
+    size_t cq_ring_bytes_ = 0;
+    size_t sqes_bytes_ = 0;
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned* sq_mask_;
+    unsigned* sq_array_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned* cq_mask_;
+    io_uring_cqe* cqes_;
+    unsigned unsubmitted_ = 0;
+
+    IoUring(int fd, const io_uring_params& params) : fd_(fd), params_(params) {}
+
+    bool map() {
+        sq_ring_bytes_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+        cq_ring_bytes_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params_.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sq_ring_bytes_ = cq_ring_bytes_ = std::max(sq_ring_bytes_, cq_ring_bytes_);
+        }
+        sq_ring_ = mmap(nullptr, sq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                        IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) return false;
+        cq_ring_ = single ? sq_ring_
+                          : mmap(nullptr, cq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                                 IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) return false;
+        sqes_bytes_ = params_.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes_ == MAP_FAILED) return false;
+
+        char* sq = static_cast<char*>(sq_ring_);
+        char* cq = static_cast<char*>(cq_ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params_.cq_off.cqes);
+        return true;
+    }
+
+    io_uring_sqe* next_sqe() {
+        const unsigned tail = *sq_tail_;
+        if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= params_.sq_entries) {
+            return nullptr;
+        }
+        const unsigned index = tail & *sq_mask_;
+        io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes_) + index;
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        ++unsubmitted_;
+        return sqe;
+    }
+};
+
+#else
+
+// stand-in so callers compile; create() always reports no ring
+class IoUring {
+public:
+    static std::unique_ptr<IoUring> create(unsigned) { return nullptr; }
+    bool queue_write(int, const void*, size_t, int64_t, uint64_t, bool = false) { return false; }
+    bool queue_fdatasync(int, uint64_t) { return false; }
+    void submit(unsigned = 0) {}
+    bool pop(uint64_t&, int&) { return false; }
+    bool supports_current_position() const { return false; }
+};
+
+#endif
+
+struct IoConfig {
+    // falls back to pwrite when no ring can be set up
+    bool use_io_uring = true;
+    // O_DIRECT where the filesystem supports it
+    bool direct = true;
+    size_t buffer_bytes = 1 << 20;
+    // buffers in flight at once
+    size_t queue_depth = 8;
+};
+
+// writes a stream of bytes to fd from offset 0 through aligned buffers. the
+// caller's data is copied, so it can be anything; with O_DIRECT the tail is
+// padded to a whole block and the file is truncated back after
+class SequentialFileWriter {
+public:
+    SequentialFileWriter(int fd, const std::string& path, IoConfig config = {})
+            : fd_(fd), path_(path), config_(config), offset_(0), bytes_(0), in_flight_(0) {
+        config_.buffer_bytes = std::max(DIRECT_IO_ALIGNMENT,
+                                        config_.buffer_bytes / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT);
+        config_.queue_depth = std::max<size_t>(1, config_.queue_depth);
+        if (config_.use_io_uring) {
+            ring_ = IoUring::create(static_cast<unsigned>(config_.queue_depth));
+        }
+        if (!ring_) {
+            config_.queue_depth = 1;
+        }
+        direct_ = config_.direct && fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_DIRECT) == 0;
+
+        for (size_t i = 0; i < config_.queue_depth; ++i) {
+            void* memory = nullptr;
+            if (posix_memalign(&memory, DIRECT_IO_ALIGNMENT, config_.buffer_bytes) != 0) {
+                throw std::bad_alloc();
+            }
+            buffers_.push_back({static_cast<char*>(memory), 0});
+            free_.push_back(i);
+        }
+        offsets_.resize(buffers_.size());
+        current_ = take_buffer();
+    }
+
+    ~SequentialFileWriter() {
+        // an exception mid-write can leave writes in flight, they point into our buffers
+        try {
+            while (in_flight_ > 0) reap();
+        } catch (...) {
+        }
+        for (auto& buffer : buffers_) {
+            std::free(buffer.data_);
+        }
+    }
+
+    SequentialFileWriter(const SequentialFileWriter&) = delete;
+    SequentialFileWriter& operator=(const SequentialFileWriter&) = delete;
+
+    void write(const void* data, size_t len) {
+        const char* p = static_cast<const char*>(data);
+        while (len > 0) {
+            Buffer& buffer = buffers_[current_];
+            const size_t n = std::min(len, config_.buffer_bytes - buffer.used_);
+            std::memcpy(buffer.data_ + buffer.used_, p, n);
+            buffer.used_ += n;
+            p += n;
+            len -= n;
+            bytes_ += n;
+            if (buffer.used_ == config_.buffer_bytes) {
+                issue(current_);
+                current_ = take_buffer();
+            }
+        }
+    }
+
+    // writes what is buffered and waits for every write to land. durability is
+    // still the caller's fsync
+    void finish() {
+        Buffer& buffer = buffers_[current_];
+        if (buffer.used_ > 0) {
+            if (direct_) {
+                const size_t padded = (buffer.used_ + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+                std::memset(buffer.data_ + buffer.used_, 0, padded - buffer.used_);
+                buffer.used_ = padded;
+            }
+            issue(current_);
+            current_ = take_buffer();
+        }
+        while (in_flight_ > 0) {
+            reap();
+        }
+        if (direct_ && offset_ != bytes_ && ftruncate(fd_, bytes_) < 0) {
+            throw std::system_error(errno, std::generic_category(), "truncate " + path_);
+        }
+    }
+
+    const char* backend() const { return ring_ ? "io_uring" : "pwrite"; }
+
+    bool direct() const { return direct_; }
+
+    uint64_t bytes_written() const { return bytes_; }
+
+private:
+    struct Buffer {
+        char* data_;
+        size_t used_;
+    };
+
+    int fd_;
+    std::string path_;
+    IoConfig config_;
+    std::unique_ptr<IoUring> ring_;
+    bool direct_;
+    std::vector<Buffer> buffers_;
+    std::vector<size_t> free_;
+    size_t current_;
+    // file offset of the next buffer issued, and bytes the caller handed over
+    uint64_t offset_;
+    uint64_t bytes_;
+    size_t in_flight_;
+    // where each in-flight buffer is going
+    std::vector<uint64_t> offsets_;
+
+    size_t take_buffer() {
+        while (free_.empty()) {
+            reap();
+        }
+        const size_t index = free_.back();
+        free_.pop_back();
+        buffers_[index].used_ = 0;
+        return index;
+    }
+
+    void issue(size_t index) {
+        Buffer& buffer = buffers_[index];
+        const uint64_t offset = offset_;
+        offset_ += buffer.used_;
+        if (!ring_) {
+            pwrite_all(buffer.data_, buffer.used_, offset);
+            free_.push_back(index);
+            return;
+        }
+        offsets_[index] = offset;
+        ring_->queue_write(fd_, buffer.data_, buffer.used_, static_cast<int64_t>(offset), index);
+        ring_->submit();
+        ++in_flight_;
+    }
+
+    // a short write, which the kernel may return near ENOSPC, is finished with pwrite
+    void reap() {
+        uint64_t index;
+        int result;
+        while (!ring_->pop(index, result)) {
+            ring_->submit(1);
+        }
+        --in_flight_;
+        Buffer& buffer = buffers_[index];
+        if (result < 0) {
+            throw std::system_error(-result, std::generic_category(), "write " + path_);
+        }
+        if (static_cast<size_t>(result) < buffer.used_) {
+            pwrite_all(buffer.data_ + result, buffer.used_ - result, offsets_[index] + result);
+        }
+        free_.push_back(index);
+    }
+
+    void pwrite_all(const char* data, size_t len, uint64_t offset) {
+        while (len > 0) {
+            ssize_t n = pwrite(fd_, data, len, static_cast<off_t>(offset));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "write " + path_);
+            }
+            data += n;
+            len -= n;
+            offset += n;
+        }
+    }
+};
@@ -0,0 +1,96 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "histogram.cpp"
+#include "snapshot.cpp"
+
+// usage: io_benchmark [dir=/tmp] [capacity_log2=24]
+//
+// writes a snapshot of the table through each backend while another thread
+// keeps doing random gets on it, and reports snapshot throughput next to the
+// get latency seen during the dump. "write" is the plain buffered save_snapshot;
+// the others go through SequentialFileWriter. the page cache is dropped from the
+// file after every run so buffered runs do not get a head start from the last one.
+// on a single core the reader and the writer share the cpu, so latency mostly
+// shows how much cpu each backend burns per byte
+
+const size_t DEFAULT_CAPACITY_LOG2 = 24;
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char* argv[]) {
+    const std::string dir = argc > 1 ? argv[1] : "/tmp";
+    const size_t capacity_log2 = argc > 2 ? std::stoull(argv[2]) : DEFAULT_CAPACITY_LOG2;
+    const std::string path = dir + "/io_benchmark.bin";
+
+    const size_t capacity = size_t(1) << capacity_log2;
+    OpenAddressTable table(capacity);
+    std::mt19937_64 gen(42);
+    std::vector<uint64_t> keys(capacity / 2);
+    for (auto& key : keys) {
+        key = gen();
+        table.insert(key, key);
+    }
+    const double mib = (sizeof(SnapshotHeader) + capacity * sizeof(Entry)) / double(1 << 20);
+    std::cout << "snapshot " << std::fixed << std::setprecision(0) << mib << " MiB\n\n"
+              << std::setw(18) << "backend" << std::setw(10) << "MiB/s" << std::setw(10) << "get p50"
+              << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "max ns" << "\n";
+
+    struct Backend {
+        const char* name;
+        bool plain;
+        bool uring;
+        bool direct;
+    };
+    for (const Backend& backend : {Backend{"write", true, false, false}, Backend{"pwrite", false, false, false},
+                                   Backend{"pwrite O_DIRECT", false, false, true},
+                                   Backend{"io_uring", false, true, false},
+                                   Backend{"io_uring O_DIRECT", false, true, true}}) {
+        std::atomic<bool> running{true};
+        std::atomic<uint64_t> checksum{0};
+        LatencyHistogram latency;
+        std::thread reader([&] {
+            std::mt19937_64 pick(7);
+            uint64_t sink = 0;
+            while (running.load(std::memory_order_relaxed)) {
+                const uint64_t key = keys[pick() % keys.size()];
+                const auto start = Clock::now();
+                sink += table.get(key).value_or(0);
+                latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+            }
+            checksum = sink;
+        });
+
+        const auto start = Clock::now();
+        if (backend.plain) {
+            save_snapshot(table, path);
+        } else {
+            IoConfig io;
+            io.use_io_uring = backend.uring;
+            io.direct = backend.direct;
+            save_snapshot(table, path, 0, io);
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        running = false;
+        reader.join();
+
+        std::cout << std::setw(18) << backend.name << std::setw(10) << std::setprecision(0) << mib / seconds
+                  << std::setw(10) << latency.percentile(0.5) << std::setw(10) << latency.percentile(0.99)
+                  << std::setw(10) << latency.percentile(0.999) << std::setw(10) << latency.max() << "\n";
+
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,500 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "histogram.cpp"
+#include "workload.cpp"
+
+// usage: loadgen [host=127.0.0.1] [port=6380] [mode=closed|open] [rate=0]
+//                [connections=4] [pipeline=16] [ops=1000000] [read=0.9]
+//                [keys=1000000] [theta=0] [protocol=binary|resp|memcached] [mget=1]
+//                [hist=<file>]
+//
+// drives a running server over `connections` sockets, one thread each. keys come
+// from a zipfian keyspace of `keys` values (theta=0 for uniform) that is fully
+// set before the timed run; `read` is the get fraction, the rest are sets. `ops`
+// and `rate` (requests per second) are totals over all connections. with mget > 1
+// every read asks for that many keys in one resp MGET or memcached get, the way a
+// cache client fans out a page render; the binary protocol has no multi-get and
+// ignores it. memcached speaks the text protocol, so the same run can be pointed
+// at a real memcached for comparison.
+//
+// closed: every connection sends `pipeline` requests and waits for all replies
+//         before the next batch. with rate=0 it runs flat out and reports only
+//         service time; with a rate, batches are scheduled on a fixed timeline
+//         and latency is measured from the scheduled send, so a stalled batch is
+//         charged for the time the batches behind it spent waiting.
+// open:   requests are sent on a fixed timeline whether or not earlier replies
+//         have arrived (rate is required). `pipeline` caps how many due requests
+//         are coalesced into one write. latency is again from the scheduled send.
+//
+// service time runs from the actual send; the gap between the two histograms is
+// the coordinated omission a naive closed-loop client would have hidden.
+
+enum class Protocol { Binary, Resp, Memcached };
+
+struct Config {
+    std::string host = "127.0.0.1";
+    uint16_t port = 6380;
+    bool open_loop = false;
+    double rate = 0;
+    size_t connections = 4;
+    size_t pipeline = 16;
+    size_t ops = 1'000'000;
+    double read_ratio = 0.9;
+    size_t keys = 1'000'000;
+    double theta = 0;
+    Protocol protocol = Protocol::Binary;
+    size_t mget = 1;
+    std::string hist_path;
+};
+
+struct ConnectionResult {
+    LatencyHistogram service;
+    LatencyHistogram response;
+    size_t ops = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static int connect_to(const Config& config) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config.port);
+    inet_pton(AF_INET, config.host.c_str(), &addr.sin_addr);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        throw std::runtime_error("cannot connect to " + config.host + ":" + std::to_string(config.port));
+    }
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static void send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) throw std::runtime_error("send failed");
+        sent += n;
+    }
+}
+
+static void append_set(std::string& out, Protocol protocol, uint64_t key, uint64_t val) {
+    const std::string k = std::to_string(key);
+    const std::string v = std::to_string(val);
+    switch (protocol) {
+        case Protocol::Binary: {
+            char frame[17];
+            frame[0] = 2;
+            std::memcpy(frame + 1, &key, sizeof(key));
+            std::memcpy(frame + 9, &val, sizeof(val));
+            out.append(frame, sizeof(frame));
+            break;
+        }
+        case Protocol::Resp:
+            out += "*3\r\n$3\r\nSET\r\n$" + std::to_string(k.size()) + "\r\n" + k + "\r\n$" +
+                   std::to_string(v.size()) + "\r\n" + v + "\r\n";
+            break;
+        case Protocol::Memcached:
+            out += "set " + k + " 0 0 " + std::to_string(v.size()) + "\r\n" + v + "\r\n";
+            break;
+    }
+}
+
+static void append_get(std::string& out, Protocol protocol, const uint64_t* keys, size_t n) {
+    switch (protocol) {
+        case Protocol::Binary: {
+            char frame[9];
+            frame[0] = 1;
+            std::memcpy(frame + 1, &keys[0], sizeof(keys[0]));
+            out.append(frame, sizeof(frame));
+            break;
+        }
+        case Protocol::Resp:
+            out += "*" + std::to_string(n + 1) + (n == 1 ? "\r\n$3\r\nGET\r\n" : "\r\n$4\r\nMGET\r\n");
+            for (size_t i = 0; i < n; ++i) {
+                const std::string k = std::to_string(keys[i]);
+                out += "$" + std::to_string(k.size()) + "\r\n" + k + "\r\n";
+            }
+            break;
+        case Protocol::Memcached:
+            out += "get";
+            for (size_t i = 0; i < n; ++i) {
+                out += " " + std::to_string(keys[i]);
+            }
+            out += "\r\n";
+            break;
+    }
+}
+
+// moves pos past one resp value, false if it is not complete yet
+static bool skip_resp_value(const char* data, size_t len, size_t& pos) {
+    const void* lf = std::memchr(data + pos, '\n', len - pos);
+    if (lf == nullptr) return false;
+    const char type = data[pos];
+    const long long n = std::strtoll(data + pos + 1, nullptr, 10);
+    size_t next = static_cast<const char*>(lf) - data + 1;
+    if (type == '$' && n >= 0) {
+        next += n + 2;
+        if (next > len) return false;
+    } else if (type == '*') {
+        for (long long i = 0; i < n; ++i) {
+            if (next >= len || !skip_resp_value(data, len, next)) return false;
+        }
+    }
+    pos = next;
+    return true;
+}
+
+// memcached replies end with one status line; VALUE lines and their data blocks
+// are part of a get's reply, which ends at END
+static bool skip_memcached_reply(const char* data, size_t len, size_t& pos) {
+    size_t next = pos;
+    while (next < len) {
+        const void* lf = std::memchr(data + next, '\n', len - next);
+        if (lf == nullptr) return false;
+        const size_t line_end = static_cast<const char*>(lf) - data + 1;
+        if (len - next < 6 || std::memcmp(data + next, "VALUE ", 6) != 0) {
+            pos = line_end;
+            return true;
+        }
+        // VALUE <key> <flags> <bytes>
+        const char* bytes = static_cast<const char*>(std::memchr(data + next + 6, ' ', line_end - next - 6));
+        bytes = bytes ? static_cast<const char*>(std::memchr(bytes + 1, ' ', data + line_end - bytes - 1)) : nullptr;
+        if (bytes == nullptr) return false;
+        next = line_end + std::strtoull(bytes + 1, nullptr, 10) + 2;
+    }
+    return false;
+}
+
+// counts complete replies in data, leaving `consumed` at the end of the last one
+static size_t count_replies(const char* data, size_t len, Protocol protocol, size_t& consumed) {
+    if (protocol == Protocol::Binary) {
+        consumed = len - len % 9;
+        return len / 9;
+    }
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        const bool complete = protocol == Protocol::Resp ? skip_resp_value(data, len, pos)
+                                                         : skip_memcached_reply(data, len, pos);
+        if (!complete) break;
+        ++count;
+    }
+    consumed = pos;
+    return count;
+}
+
+// sends the batch and blocks until every reply has arrived
+static void round_trip(int fd, const std::string& requests, size_t expected, Protocol protocol,
+                       std::string& buffer) {
+    send_all(fd, requests);
+    size_t replies = 0;
+    char chunk[64 * 1024];
+    while (replies < expected) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) throw std::runtime_error("connection closed by server");
+        buffer.append(chunk, n);
+        size_t consumed;
+        replies += count_replies(buffer.data(), buffer.size(), protocol, consumed);
+        buffer.erase(0, consumed);
+    }
+}
+
+static void preload(const Config& config) {
+    const size_t BATCH = 256;
+    ZipfianGenerator keyspace(config.keys, 0);
+    int fd = connect_to(config);
+    std::string requests;
+    std::string buffer;
+    for (size_t rank = 0; rank < config.keys; rank += BATCH) {
+        requests.clear();
+        const size_t end = std::min(config.keys, rank + BATCH);
+        for (size_t r = rank; r < end; ++r) {
+            append_set(requests, config.protocol, keyspace.key_for_rank(r), r);
+        }
+        round_trip(fd, requests, end - rank, config.protocol, buffer);
+    }
+    close(fd);
+}
+
+class RequestSource {
+public:
+    RequestSource(const Config& config, size_t seed)
+            : protocol_(config.protocol), mget_(config.mget), keys_(config.keys, config.theta, 42 + seed),
+              generator_(1000 + seed), is_read_(config.read_ratio), batch_(config.mget) {}
+
+    void append(std::string& out, uint64_t val) {
+        if (!is_read_(generator_)) {
+            append_set(out, protocol_, keys_.next(), val);
+            return;
+        }
+        for (auto& key : batch_) {
+            key = keys_.next();
+        }
+        append_get(out, protocol_, batch_.data(), mget_);
+    }
+
+private:
+    Protocol protocol_;
+    size_t mget_;
+    ZipfianGenerator keys_;
+    std::mt19937_64 generator_;
+    std::bernoulli_distribution is_read_;
+    std::vector<uint64_t> batch_;
+};
+
+static void run_closed(const Config& config, size_t c, size_t ops, ConnectionResult& result) {
+    int fd = connect_to(config);
+    RequestSource source(config, c);
+    std::string requests;
+    std::string buffer;
+    const int64_t interval = config.rate > 0
+                             ? static_cast<int64_t>(1e9 * config.connections * config.pipeline / config.rate)
+                             : 0;
+    int64_t scheduled = now_ns();
+
+    for (size_t done = 0; done < ops; done += config.pipeline) {
+        const size_t count = std::min(config.pipeline, ops - done);
+        requests.clear();
+        for (size_t i = 0; i < count; ++i) {
+            source.append(requests, done + i);
+        }
+
+        if (interval > 0) {
+            while (now_ns() < scheduled) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(scheduled - now_ns()));
+            }
+        }
+        const int64_t sent = now_ns();
+        round_trip(fd, requests, count, config.protocol, buffer);
+        const int64_t received = now_ns();
+
+        result.service.record(received - sent, count);
+        if (interval > 0) {
+            result.response.record(received - scheduled, count);
+            scheduled += interval;
+        }
+        result.ops += count;
+    }
+    close(fd);
+}
+
+static void run_open(const Config& config, size_t c, size_t ops, ConnectionResult& result) {
+    int fd = connect_to(config);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    RequestSource source(config, c);
+    const double interval = 1e9 * config.connections / config.rate;
+    const int64_t start = now_ns();
+
+    // scheduled and actual send time of every request still waiting for a reply
+    std::deque<std::pair<int64_t, int64_t>> outstanding;
+    std::string out;
+    size_t out_sent = 0;
+    std::string in;
+    size_t issued = 0;
+    char chunk[64 * 1024];
+
+    while (result.ops < ops) {
+        int64_t now = now_ns();
+        for (size_t n = 0; n < config.pipeline && issued < ops; ++n, ++issued) {
+            const int64_t scheduled = start + static_cast<int64_t>(issued * interval);
+            if (scheduled > now) break;
+            source.append(out, issued);
+            outstanding.emplace_back(scheduled, now);
+        }
+
+        while (out_sent < out.size()) {
+            ssize_t n = send(fd, out.data() + out_sent, out.size() - out_sent, MSG_NOSIGNAL);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n <= 0) throw std::runtime_error("send failed");
+            out_sent += n;
+        }
+        if (out_sent == out.size()) {
+            out.clear();
+            out_sent = 0;
+        }
+
+        // sleep until the next request is due or a reply arrives
+        const int64_t next_due = issued < ops ? start + static_cast<int64_t>(issued * interval) : now + 1'000'000;
+        pollfd pfd{fd, static_cast<short>(POLLIN | (out.empty() ? 0 : POLLOUT)), 0};
+        const int64_t wait = std::max<int64_t>(0, next_due - now_ns());
+        const timespec timeout{static_cast<time_t>(wait / 1'000'000'000), static_cast<long>(wait % 1'000'000'000)};
+        if (ppoll(&pfd, 1, &timeout, nullptr) <= 0 || !(pfd.revents & POLLIN)) {
+            continue;
+        }
+
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            throw std::runtime_error("connection closed by server");
+        }
+        if (n < 0) continue;
+        in.append(chunk, n);
+        size_t consumed;
+        size_t replies = count_replies(in.data(), in.size(), config.protocol, consumed);
+        in.erase(0, consumed);
+
+        const int64_t received = now_ns();
+        for (; replies > 0; --replies) {
+            result.response.record(received - outstanding.front().first);
+            result.service.record(received - outstanding.front().second);
+            outstanding.pop_front();
+            ++result.ops;
+        }
+    }
+    close(fd);
+}
+
+static void print_histogram(const std::string& label, const LatencyHistogram& histogram) {
+    std::cout << std::setw(10) << label << std::fixed << std::setprecision(1);
+    for (double q : {0.5, 0.9, 0.99, 0.999, 0.9999}) {
+        std::cout << std::setw(11) << histogram.percentile(q) / 1e3;
+    }
+    std::cout << std::setw(11) << histogram.max() / 1e3 << "\n";
+}
+
+static void write_histogram(const std::string& path, const LatencyHistogram& histogram) {
+    std::ofstream out(path);
+    out << "value_us count cumulative\n";
+    uint64_t seen = 0;
+    for (const auto& [value, count] : histogram.buckets()) {
+        seen += count;
+        out << value / 1e3 << " " << count << " " << static_cast<double>(seen) / histogram.count() << "\n";
+    }
+}
+
+static Protocol parse_protocol(const std::string& name) {
+    if (name == "binary") return Protocol::Binary;
+    if (name == "resp") return Protocol::Resp;
+    if (name == "memcached") return Protocol::Memcached;
+    throw std::invalid_argument("unknown protocol " + name);
+}
+
+static const char* protocol_name(Protocol protocol) {
+    switch (protocol) {
+        case Protocol::Resp: return "resp";
+        case Protocol::Memcached: return "memcached";
+        default: return "binary";
+    }
+}
+
+static Config parse_args(int argc, char* argv[]) {
+    Config config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (eq == std::string::npos) {
+            throw std::invalid_argument("expected key=value, got " + arg);
+        }
+        std::string key = arg.substr(0, eq);
+        std::string value = arg.substr(eq + 1);
+
+        if (key == "host") config.host = value;
+        else if (key == "port") config.port = static_cast<uint16_t>(std::stoul(value));
+        else if (key == "mode") config.open_loop = value == "open";
+        else if (key == "rate") config.rate = std::stod(value);
+        else if (key == "connections") config.connections = std::stoull(value);
+        else if (key == "pipeline") config.pipeline = std::stoull(value);
+        else if (key == "ops") config.ops = std::stoull(value);
+        else if (key == "read") config.read_ratio = std::stod(value);
+        else if (key == "keys") config.keys = std::stoull(value);
+        else if (key == "theta") config.theta = std::stod(value);
+        else if (key == "protocol") config.protocol = parse_protocol(value);
+        else if (key == "mget") config.mget = std::stoull(value);
+        else if (key == "hist") config.hist_path = value;
+        else throw std::invalid_argument("unknown option " + key);
+    }
+    if (config.open_loop && config.rate <= 0) {
+        throw std::invalid_argument("mode=open needs a rate");
+    }
+    config.connections = std::max<size_t>(1, config.connections);
+    config.pipeline = std::max<size_t>(1, config.pipeline);
+    config.keys = std::max<size_t>(1, config.keys);
+    config.mget = config.protocol == Protocol::Binary ? 1 : std::max<size_t>(1, config.mget);
+    return config;
+}
+
+int main(int argc, char* argv[]) {
+    Config config = parse_args(argc, argv);
+    std::cout << (config.open_loop ? "open" : "closed") << " loop, rate "
+              << (config.rate > 0 ? std::to_string(static_cast<uint64_t>(config.rate)) + "/s" : "unlimited")
+              << ", connections " << config.connections << ", pipeline " << config.pipeline
+              << ", ops " << config.ops << ", read " << config.read_ratio << ", keys " << config.keys
+              << ", theta " << config.theta << ", protocol " << protocol_name(config.protocol)
+              << ", mget " << config.mget << "\n";
+
+    preload(config);
+
+    std::vector<ConnectionResult> results(config.connections);
+    std::vector<std::thread> clients;
+    std::atomic<bool> failed{false};
+
+    const auto start = Clock::now();
+    for (size_t c = 0; c < config.connections; ++c) {
+        const size_t ops = config.ops / config.connections + (c < config.ops % config.connections);
+        clients.emplace_back([&, c, ops] {
+            try {
+                if (config.open_loop) {
+                    run_open(config, c, ops, results[c]);
+                } else {
+                    run_closed(config, c, ops, results[c]);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << "\n";
+                failed = true;
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (failed) {
+        return 1;
+    }
+
+    ConnectionResult total;
+    for (const auto& result : results) {
+        total.service.merge(result.service);
+        total.response.merge(result.response);
+        total.ops += result.ops;
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "throughput: " << total.ops / seconds / 1e6 << " Mops/s over "
+              << std::setprecision(2) << seconds << " s\n\n"
+              << std::setw(10) << "us" << std::setw(11) << "p50" << std::setw(11) << "p90"
+              << std::setw(11) << "p99" << std::setw(11) << "p99.9" << std::setw(11) << "p99.99"
+              << std::setw(11) << "max" << "\n";
+    print_histogram("service", total.service);
+    if (total.response.count() > 0) {
+        print_histogram("response", total.response);
+    } else {
+        std::cout << "(no rate, so no schedule to measure response time against)\n";
+    }
+
+    if (!config.hist_path.empty()) {
+        write_histogram(config.hist_path, total.response.count() > 0 ? total.response : total.service);
+    }
+    return 0;
+}
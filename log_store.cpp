@@ -0,0 +1,673 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "snapshot.cpp"
+#include "table.cpp"
+
+// bitcask-style store: values live in append-only segment files on disk and
+// only the index, an OpenAddressTable from key to (segment, offset), is kept
+// in memory, so the data can be far larger than RAM while a read is still one
+// pread. overwrites and erases leave the old record behind as garbage; once
+// enough of the sealed segments is garbage, a background compaction copies the
+// live records into fresh segments and deletes the old ones.
+//
+// segment <major>.<minor>.seg, records back to back:
+//   u64 xxh64 of the rest of the record, u64 key, u32 value bytes, u32 flags
+//   (1 = erase), then the value
+// a segment is appended to while it is active and immutable once sealed.
+// sealing writes <major>.<minor>.hint, every record's key and location without
+// the values, so startup rebuilds the index from hints instead of reading all
+// the data. writes go to segments (n, 0); compacting everything up to major n
+// produces (n, 1), (n, 2) ..., which sort after the segments they replace and
+// before (n + 1, 0), the next active one. replaying segments in that order is
+// correct even if a compaction was cut short and both generations exist.
+
+struct LogRecordHeader {
+    uint64_t checksum_;
+    uint64_t key_;
+    uint32_t value_bytes_;
+    uint32_t flags_;
+};
+
+struct LogHintEntry {
+    uint64_t key_;
+    uint64_t offset_;
+    uint32_t value_bytes_;
+    uint32_t flags_;
+};
+
+static constexpr uint32_t LOG_RECORD_ERASE = 1;
+static constexpr char LOG_HINT_MAGIC[4] = {'O', 'A', 'T', 'H'};
+
+struct LogStoreConfig {
+    // the active segment is sealed once it grows past this
+    size_t segment_bytes = 64 << 20;
+    // fdatasync after every put and erase
+    bool sync = false;
+    // compact in the background once this fraction of records in sealed
+    // segments is garbage; 0 leaves compaction to explicit compact() calls
+    double compact_garbage_ratio = 0.5;
+};
+
+class LogStore {
+public:
+    // the index packs a segment slot and an offset into the table's value
+    static constexpr unsigned OFFSET_BITS = 40;
+    static constexpr uint64_t OFFSET_MASK = (uint64_t(1) << OFFSET_BITS) - 1;
+    // one pread covers the header and a value up to this size
+    static constexpr size_t READ_AHEAD = 4096;
+    // records compaction moves in the index per exclusive lock
+    static constexpr size_t COMPACTION_BATCH = 4096;
+
+    explicit LogStore(const std::string& dir, LogStoreConfig config = {})
+            : dir_(dir), config_(config), stopping_(false), compact_requested_(false) {
+        if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) {
+            throw std::system_error(errno, std::generic_category(), "mkdir " + dir);
+        }
+        recover();
+        if (config_.compact_garbage_ratio > 0) {
+            compactor_ = std::thread([this] { compact_loop(); });
+        }
+    }
+
+    ~LogStore() {
+        {
+            std::lock_guard<std::mutex> lock(compact_mutex_);
+            stopping_ = true;
+        }
+        compact_cv_.notify_one();
+        if (compactor_.joinable()) {
+            compactor_.join();
+        }
+        for (auto& segment : segments_) {
+            if (segment) close(segment->fd_);
+        }
+    }
+
+    LogStore(const LogStore&) = delete;
+    LogStore& operator=(const LogStore&) = delete;
+
+    void put(uint64_t key, std::string_view value) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        const uint64_t location = append(key, value, 0);
+        auto previous = index_.get(key);
+        if (previous) {
+            mark_dead(*previous);
+        }
+        index_.insert(key, location);
+        after_write(lock);
+    }
+
+    std::optional<std::string> get(uint64_t key) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto location = index_.get(key);
+        if (!location) {
+            return std::nullopt;
+        }
+        const Segment& segment = *segments_[*location >> OFFSET_BITS];
+        return read_value(segment, *location & OFFSET_MASK, key);
+    }
+
+    bool erase(uint64_t key) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto previous = index_.get(key);
+        if (!previous) {
+            return false;
+        }
+        const uint64_t location = append(key, {}, LOG_RECORD_ERASE);
+        mark_dead(*previous);
+        mark_dead(location);
+        index_.erase(key);
+        after_write(lock);
+        return true;
+    }
+
+    // copies the live records of every sealed segment into new segments and
+    // deletes the old ones. the active segment is sealed first so its garbage
+    // goes too. readers and writers only wait for short index updates
+    void compact() {
+        std::lock_guard<std::mutex> compaction_lock(compaction_mutex_);
+        std::vector<std::pair<size_t, Segment*>> inputs;
+        uint64_t major = 0;
+        uint32_t minor = 1;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            if (Segment* rolled = roll()) {
+                seal_rolled(rolled, lock);
+            }
+            // the sealed prefix of the replay order; a segment a writer is still
+            // sealing ends it, so no older segment outlives the erases dropped here
+            size_t dead = 0;
+            for (size_t slot : order_) {
+                Segment* segment = segments_[slot].get();
+                if (!segment->sealed_) {
+                    break;
+                }
+                inputs.emplace_back(slot, segment);
+                dead += segment->dead_;
+                if (segment->major_ != major) {
+                    major = segment->major_;
+                    minor = 1;
+                }
+                minor = std::max(minor, segment->minor_ + 1);
+            }
+            if (dead == 0) {
+                return;
+            }
+        }
+
+        Segment* output = nullptr;
+        size_t output_slot = 0;
+        std::vector<Move> moves;
+        auto apply_moves = [&] {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            for (const Move& move : moves) {
+                auto current = index_.get(move.key_);
+                if (current && *current == move.from_) {
+                    index_.insert(move.key_, move.to_);
+                } else {
+                    // overwritten while it was being copied
+                    output->dead_++;
+                }
+            }
+            moves.clear();
+        };
+        auto finish_output = [&] {
+            apply_moves();
+            seal(*output);
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            output->sealed_ = true;
+        };
+
+        for (const auto& [slot, input] : inputs) {
+            for_each_record(*input, [&, slot = slot](const LogRecordHeader& header, uint64_t offset, const char* value) {
+                if (header.flags_ & LOG_RECORD_ERASE) {
+                    return;
+                }
+                const uint64_t from = (uint64_t(slot) << OFFSET_BITS) | offset;
+                {
+                    std::shared_lock<std::shared_mutex> lock(mutex_);
+                    auto current = index_.get(header.key_);
+                    if (!current || *current != from) {
+                        return;
+                    }
+                }
+                if (output == nullptr || output->bytes_ >= config_.segment_bytes) {
+                    if (output != nullptr) {
+                        finish_output();
+                    }
+                    std::unique_lock<std::shared_mutex> lock(mutex_);
+                    output_slot = open_segment(major, minor++, true);
+                    output = segments_[output_slot].get();
+                }
+                const uint64_t to = (uint64_t(output_slot) << OFFSET_BITS) |
+                                    write_record(*output, header.key_, std::string_view(value, header.value_bytes_), 0);
+                moves.push_back({header.key_, from, to});
+                if (moves.size() >= COMPACTION_BATCH) {
+                    apply_moves();
+                }
+            });
+        }
+        if (output != nullptr) {
+            finish_output();
+        }
+        sync_dir();
+
+        // oldest first: a crash part way leaves a suffix of the old segments,
+        // and replaying a suffix before the new ones still ends in the right state
+        std::vector<std::string> doomed;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            for (const auto& [slot, input] : inputs) {
+                doomed.push_back(input->path_);
+                close(input->fd_);
+                segments_[slot].reset();
+                free_slots_.push_back(slot);
+            }
+            order_.erase(std::remove_if(order_.begin(), order_.end(), [&](size_t slot) { return !segments_[slot]; }),
+                         order_.end());
+        }
+        for (const std::string& path : doomed) {
+            unlink(path.c_str());
+            unlink(hint_path(path).c_str());
+        }
+        sync_dir();
+        compactions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t size() {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return index_.size();
+    }
+
+    size_t segment_count() {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return order_.size();
+    }
+
+    // fraction of records in sealed segments that are garbage
+    double garbage_ratio() {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return sealed_garbage_ratio();
+    }
+
+    size_t compactions() const { return compactions_.load(std::memory_order_relaxed); }
+
+    // segments whose index came from a hint file rather than a scan at startup
+    size_t recovered_from_hints() const { return recovered_from_hints_; }
+
+    // makes every write so far durable, for sync = false. a segment rolled out
+    // but not yet sealed has not been fsynced either
+    void sync() {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (size_t slot : order_) {
+            if (!segments_[slot]->sealed_ && fdatasync(segments_[slot]->fd_) < 0) {
+                throw std::system_error(errno, std::generic_category(), "fdatasync " + segments_[slot]->path_);
+            }
+        }
+    }
+
+private:
+    struct Segment {
+        uint64_t major_;
+        uint32_t minor_;
+        std::string path_;
+        int fd_;
+        uint64_t bytes_;
+        size_t records_;
+        size_t dead_;
+        bool sealed_;
+        // the hint file's entries, gathered as records are appended until sealed
+        std::vector<LogHintEntry> hints_;
+    };
+
+    struct Move {
+        uint64_t key_;
+        uint64_t from_;
+        uint64_t to_;
+    };
+
+    std::string dir_;
+    LogStoreConfig config_;
+    std::shared_mutex mutex_;
+    OpenAddressTable index_;
+    std::vector<std::unique_ptr<Segment>> segments_;
+    std::vector<size_t> free_slots_;
+    // slots in replay order
+    std::vector<size_t> order_;
+    size_t active_;
+    size_t recovered_from_hints_ = 0;
+    std::atomic<size_t> compactions_{0};
+
+    std::mutex compaction_mutex_;
+    std::mutex compact_mutex_;
+    std::condition_variable compact_cv_;
+    bool stopping_;
+    bool compact_requested_;
+    std::thread compactor_;
+
+    std::string segment_path(uint64_t major, uint32_t minor) const {
+        char name[48];
+        std::snprintf(name, sizeof(name), "/%016llx.%04x.seg", static_cast<unsigned long long>(major), minor);
+        return dir_ + name;
+    }
+
+    static std::string hint_path(const std::string& segment_path) {
+        return segment_path.substr(0, segment_path.size() - 4) + ".hint";
+    }
+
+    void sync_dir() {
+        int fd = open(dir_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+
+    // registers a segment in a free slot; compaction output goes before the active one in replay order
+    size_t open_segment(uint64_t major, uint32_t minor, bool create) {
+        const std::string path = segment_path(major, minor);
+        const int fd = open(path.c_str(), (create ? O_CREAT | O_TRUNC : 0) | O_RDWR | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        size_t slot;
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            slot = segments_.size();
+            segments_.emplace_back();
+        }
+        segments_[slot].reset(new Segment{major, minor, path, fd, 0, 0, 0, false, {}});
+        auto position = std::find_if(order_.begin(), order_.end(), [&](size_t other) {
+            const Segment& s = *segments_[other];
+            return s.major_ > major || (s.major_ == major && s.minor_ > minor);
+        });
+        order_.insert(position, slot);
+        return slot;
+    }
+
+    // appends at the end of the segment and returns the record's offset
+    uint64_t write_record(Segment& segment, uint64_t key, std::string_view value, uint32_t flags) {
+        std::string record(sizeof(LogRecordHeader) + value.size(), '\0');
+        LogRecordHeader header{0, key, static_cast<uint32_t>(value.size()), flags};
+        std::memcpy(&record[0], &header, sizeof(header));
+        std::memcpy(&record[sizeof(header)], value.data(), value.size());
+        header.checksum_ = XXH64(record.data() + 8, record.size() - 8, 0);
+        std::memcpy(&record[0], &header.checksum_, 8);
+
+        const uint64_t offset = segment.bytes_;
+        if (offset + record.size() > OFFSET_MASK) {
+            throw std::runtime_error("segment too large: " + segment.path_);
+        }
+        for (size_t done = 0; done < record.size();) {
+            ssize_t n = pwrite(segment.fd_, record.data() + done, record.size() - done, offset + done);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "write " + segment.path_);
+            }
+            done += n;
+        }
+        segment.bytes_ += record.size();
+        segment.records_++;
+        segment.hints_.push_back({key, offset, static_cast<uint32_t>(value.size()), flags});
+        return offset;
+    }
+
+    uint64_t append(uint64_t key, std::string_view value, uint32_t flags) {
+        Segment& segment = *segments_[active_];
+        const uint64_t offset = write_record(segment, key, value, flags);
+        if (config_.sync && fdatasync(segment.fd_) < 0) {
+            throw std::system_error(errno, std::generic_category(), "fdatasync " + segment.path_);
+        }
+        return (uint64_t(active_) << OFFSET_BITS) | offset;
+    }
+
+    void mark_dead(uint64_t location) {
+        segments_[location >> OFFSET_BITS]->dead_++;
+    }
+
+    void after_write(std::unique_lock<std::shared_mutex>& lock) {
+        if (segments_[active_]->bytes_ < config_.segment_bytes) {
+            return;
+        }
+        if (Segment* rolled = roll()) {
+            seal_rolled(rolled, lock);
+        }
+        if (config_.compact_garbage_ratio > 0 && sealed_garbage_ratio() >= config_.compact_garbage_ratio) {
+            {
+                std::lock_guard<std::mutex> lock(compact_mutex_);
+                compact_requested_ = true;
+            }
+            compact_cv_.notify_one();
+        }
+    }
+
+    double sealed_garbage_ratio() const {
+        size_t records = 0;
+        size_t dead = 0;
+        for (size_t slot : order_) {
+            if (segments_[slot]->sealed_) {
+                records += segments_[slot]->records_;
+                dead += segments_[slot]->dead_;
+            }
+        }
+        return records == 0 ? 0.0 : static_cast<double>(dead) / records;
+    }
+
+    // starts (major + 1, 0) as the active segment and returns the old one for
+    // seal_rolled(), or nullptr if it was empty; called with mutex_ held
+    Segment* roll() {
+        Segment* segment = segments_[active_].get();
+        if (segment->records_ == 0) {
+            return nullptr;
+        }
+        const size_t slot = open_segment(segment->major_ + 1, 0, true);
+        // the new file's directory entry is durable before any write can be
+        // synced into it and acknowledged
+        sync_dir();
+        active_ = slot;
+        return segment;
+    }
+
+    // seals a segment roll() retired with mutex_ released, so reads and writes
+    // to the new active segment go on during the fsync. nothing appends to the
+    // retired segment any more and compaction skips it until it is sealed
+    void seal_rolled(Segment* segment, std::unique_lock<std::shared_mutex>& lock) {
+        lock.unlock();
+        seal(*segment);
+        lock.lock();
+        segment->sealed_ = true;
+    }
+
+    // fsyncs the segment and writes its hint file; the caller marks it sealed
+    void seal(Segment& segment) {
+        if (fsync(segment.fd_) < 0) {
+            throw std::system_error(errno, std::generic_category(), "fsync " + segment.path_);
+        }
+        std::string hints(LOG_HINT_MAGIC, sizeof(LOG_HINT_MAGIC));
+        hints.append(reinterpret_cast<const char*>(segment.hints_.data()), segment.hints_.size() * sizeof(LogHintEntry));
+        std::vector<LogHintEntry>().swap(segment.hints_);
+        const uint64_t checksum = XXH64(hints.data(), hints.size(), 0);
+        hints.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        write_file_atomically(hint_path(segment.path_), [&](int fd, const std::string& tmp_path) {
+            write_all(fd, hints.data(), hints.size(), tmp_path);
+        });
+    }
+
+    std::optional<std::string> read_value(const Segment& segment, uint64_t offset, uint64_t key) const {
+        char buffer[READ_AHEAD];
+        ssize_t n = pread(segment.fd_, buffer, sizeof(buffer), offset);
+        if (n < static_cast<ssize_t>(sizeof(LogRecordHeader))) {
+            throw std::runtime_error("short read in " + segment.path_);
+        }
+        LogRecordHeader header;
+        std::memcpy(&header, buffer, sizeof(header));
+        std::string record(sizeof(header) + header.value_bytes_, '\0');
+        const size_t have = std::min<size_t>(n, record.size());
+        std::memcpy(&record[0], buffer, have);
+        if (have < record.size() &&
+            pread(segment.fd_, &record[have], record.size() - have, offset + have) !=
+                    static_cast<ssize_t>(record.size() - have)) {
+            throw std::runtime_error("short read in " + segment.path_);
+        }
+        if (header.key_ != key || XXH64(record.data() + 8, record.size() - 8, 0) != header.checksum_) {
+            throw std::runtime_error("corrupt record in " + segment.path_);
+        }
+        return record.substr(sizeof(header));
+    }
+
+    // visits every intact record in order and returns the length of the intact
+    // prefix; a segment can only be torn at its end
+    template <typename Fn>
+    uint64_t for_each_record(const Segment& segment, Fn fn) const {
+        struct stat st;
+        const uint64_t file_bytes = fstat(segment.fd_, &st) == 0 ? st.st_size : 0;
+        std::vector<char> chunk(1 << 20);
+        uint64_t chunk_start = 0;
+        size_t chunk_len = 0;
+        uint64_t offset = 0;
+        auto fill = [&](uint64_t at, size_t len) {
+            if (at >= chunk_start && at + len <= chunk_start + chunk_len) {
+                return true;
+            }
+            if (chunk.size() < len) {
+                chunk.resize(len);
+            }
+            ssize_t n = pread(segment.fd_, chunk.data(), chunk.size(), at);
+            chunk_start = at;
+            chunk_len = n < 0 ? 0 : n;
+            return chunk_len >= len;
+        };
+        while (true) {
+            if (!fill(offset, sizeof(LogRecordHeader))) {
+                break;
+            }
+            LogRecordHeader header;
+            std::memcpy(&header, chunk.data() + (offset - chunk_start), sizeof(header));
+            const size_t length = sizeof(header) + header.value_bytes_;
+            if (offset + length > file_bytes || !fill(offset, length)) {
+                break;
+            }
+            const char* record = chunk.data() + (offset - chunk_start);
+            if (XXH64(record + 8, length - 8, 0) != header.checksum_) {
+                break;
+            }
+            fn(header, offset, record + sizeof(header));
+            offset += length;
+        }
+        return offset;
+    }
+
+    // reads the hint file into entries; false if it is missing or damaged
+    static bool read_hints(const std::string& path, std::vector<LogHintEntry>& entries) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        std::string data;
+        const bool ok = fstat(fd, &st) == 0 && (data.resize(st.st_size), read_all(fd, &data[0], data.size(), path));
+        close(fd);
+        const size_t body = data.size() - sizeof(LOG_HINT_MAGIC) - sizeof(uint64_t);
+        if (!ok || data.size() < sizeof(LOG_HINT_MAGIC) + sizeof(uint64_t) || body % sizeof(LogHintEntry) != 0 ||
+            std::memcmp(data.data(), LOG_HINT_MAGIC, sizeof(LOG_HINT_MAGIC)) != 0) {
+            return false;
+        }
+        uint64_t checksum;
+        std::memcpy(&checksum, data.data() + data.size() - sizeof(checksum), sizeof(checksum));
+        if (XXH64(data.data(), data.size() - sizeof(checksum), 0) != checksum) {
+            return false;
+        }
+        entries.resize(body / sizeof(LogHintEntry));
+        std::memcpy(entries.data(), data.data() + sizeof(LOG_HINT_MAGIC), body);
+        return true;
+    }
+
+    void replay(size_t slot, uint64_t key, uint64_t offset, uint32_t flags) {
+        Segment& segment = *segments_[slot];
+        segment.records_++;
+        auto previous = index_.get(key);
+        if (previous) {
+            mark_dead(*previous);
+        }
+        if (flags & LOG_RECORD_ERASE) {
+            segment.dead_++;
+            index_.erase(key);
+        } else {
+            index_.insert(key, (uint64_t(slot) << OFFSET_BITS) | offset);
+        }
+    }
+
+    void recover() {
+        std::vector<std::pair<uint64_t, uint32_t>> found;
+        if (DIR* dir = opendir(dir_.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                unsigned long long major;
+                unsigned minor;
+                char suffix[8];
+                if (std::sscanf(entry->d_name, "%16llx.%4x.%7s", &major, &minor, suffix) == 3 &&
+                    std::strcmp(suffix, "seg") == 0) {
+                    found.emplace_back(major, minor);
+                }
+            }
+            closedir(dir);
+        }
+        std::sort(found.begin(), found.end());
+
+        uint64_t next_major = 1;
+        std::optional<size_t> reuse;
+        for (size_t i = 0; i < found.size(); ++i) {
+            const auto& [major, minor] = found[i];
+            const size_t slot = open_segment(major, minor, false);
+            Segment& segment = *segments_[slot];
+            std::vector<LogHintEntry> hints;
+            struct stat st;
+            if (read_hints(hint_path(segment.path_), hints)) {
+                for (const LogHintEntry& hint : hints) {
+                    replay(slot, hint.key_, hint.offset_, hint.flags_);
+                }
+                segment.bytes_ = fstat(segment.fd_, &st) == 0 ? st.st_size : 0;
+                segment.sealed_ = true;
+                ++recovered_from_hints_;
+            } else {
+                // the segment that was active, or one whose hint was lost: scan it and
+                // cut off a torn tail, then seal it like any other
+                segment.bytes_ = for_each_record(segment, [&](const LogRecordHeader& header, uint64_t offset,
+                                                              const char*) {
+                    replay(slot, header.key_, offset, header.flags_);
+                    segment.hints_.push_back({header.key_, offset, header.value_bytes_, header.flags_});
+                });
+                if (ftruncate(segment.fd_, segment.bytes_) < 0) {
+                    throw std::system_error(errno, std::generic_category(), "truncate " + segment.path_);
+                }
+                // an open without writes leaves its active segment empty; the
+                // last one carries on as the active segment instead of sealing
+                if (segment.records_ == 0 && minor == 0 && i + 1 == found.size()) {
+                    reuse = slot;
+                    continue;
+                }
+                if (segment.records_ > 0) {
+                    seal(segment);
+                    segment.sealed_ = true;
+                }
+            }
+            next_major = std::max<uint64_t>(next_major, major + 1);
+            // nothing to replay or compact, and compaction would never reclaim it
+            if (segment.records_ == 0) {
+                drop_segment(slot);
+            }
+        }
+        active_ = reuse ? *reuse : open_segment(next_major, 0, true);
+        sync_dir();
+    }
+
+    // closes and deletes a segment no index entry points into
+    void drop_segment(size_t slot) {
+        const std::string path = segments_[slot]->path_;
+        close(segments_[slot]->fd_);
+        segments_[slot].reset();
+        free_slots_.push_back(slot);
+        order_.erase(std::find(order_.begin(), order_.end(), slot));
+        unlink(path.c_str());
+        unlink(hint_path(path).c_str());
+    }
+
+    void compact_loop() {
+        std::unique_lock<std::mutex> lock(compact_mutex_);
+        while (true) {
+            compact_cv_.wait(lock, [&] { return stopping_ || compact_requested_; });
+            if (stopping_) {
+                return;
+            }
+            compact_requested_ = false;
+            lock.unlock();
+            try {
+                compact();
+            } catch (const std::exception&) {
+                // left for the next trigger or an explicit compact() to retry
+            }
+            lock.lock();
+        }
+    }
+};
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <dirent.h>
+#include "log_store.cpp"
+
+// usage: log_store_benchmark [dir=/tmp] [keys=1000000] [value_bytes=256]
+//
+// loads `keys` values into a LogStore, overwrites half of them, then times
+// random gets, a compaction, and reopening the store from hint files and from
+// a full scan of the segments. point dir at the device under test; with more
+// data than RAM the gets measure one pread each
+
+const size_t DEFAULT_KEYS = 1'000'000;
+const size_t DEFAULT_VALUE_BYTES = 256;
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void report(const std::string& name, size_t ops, double seconds) {
+    std::cout << std::setw(18) << name << std::setw(10) << std::fixed << std::setprecision(2) << seconds
+              << std::setw(14) << std::setprecision(0) << ops / seconds << "\n";
+}
+
+static void remove_files(const std::string& dir, const std::string& suffix) {
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* entry = readdir(d)) {
+            const std::string name = entry->d_name;
+            if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                std::remove((dir + "/" + name).c_str());
+            }
+        }
+        closedir(d);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const std::string dir = std::string(argc > 1 ? argv[1] : "/tmp") + "/log_store_benchmark";
+    const size_t keys = argc > 2 ? std::stoull(argv[2]) : DEFAULT_KEYS;
+    const size_t value_bytes = argc > 3 ? std::stoull(argv[3]) : DEFAULT_VALUE_BYTES;
+
+    remove_files(dir, "");
+    LogStoreConfig config;
+    config.compact_garbage_ratio = 0;
+    const std::string value(value_bytes, 'v');
+
+    std::cout << std::setw(18) << "phase" << std::setw(10) << "seconds" << std::setw(14) << "ops/s" << "\n";
+    {
+        LogStore store(dir, config);
+        auto start = Clock::now();
+        for (uint64_t key = 0; key < keys; key++) {
+            store.put(key, value);
+        }
+        report("put", keys, seconds_since(start));
+
+        start = Clock::now();
+        for (uint64_t key = 0; key < keys; key += 2) {
+            store.put(key, value);
+        }
+        report("overwrite half", keys / 2, seconds_since(start));
+
+        std::mt19937_64 gen(42);
+        size_t found = 0;
+        start = Clock::now();
+        for (size_t i = 0; i < keys; i++) {
+            found += store.get(gen() % keys).has_value();
+        }
+        report("random get", keys, seconds_since(start));
+        if (found != keys) {
+            std::cerr << "missing keys: " << keys - found << "\n";
+            return 1;
+        }
+
+        start = Clock::now();
+        store.compact();
+        report("compact", keys, seconds_since(start));
+    }
+    {
+        auto start = Clock::now();
+        LogStore store(dir, config);
+        report("open with hints", store.size(), seconds_since(start));
+    }
+    remove_files(dir, ".hint");
+    {
+        auto start = Clock::now();
+        LogStore store(dir, config);
+        report("open by scan", store.size(), seconds_since(start));
+    }
+
+    remove_files(dir, "");
+    rmdir(dir.c_str());
+    return 0;
+}
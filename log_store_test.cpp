@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include <dirent.h>
+#include <random>
+#include <thread>
+#include "log_store.cpp"
+
+class LogStoreTest : public ::testing::Test {
+protected:
+    std::string dir;
+
+    void SetUp() override {
+        dir = ::testing::TempDir() + "oat_log_store_test";
+        remove_dir();
+    }
+
+    void TearDown() override {
+        remove_dir();
+    }
+
+    std::vector<std::string> files(const std::string& suffix) {
+        std::vector<std::string> out;
+        if (DIR* d = opendir(dir.c_str())) {
+            while (dirent* entry = readdir(d)) {
+                const std::string name = entry->d_name;
+                if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                    out.push_back(dir + "/" + name);
+                }
+            }
+            closedir(d);
+        }
+        return out;
+    }
+
+    void remove_dir() {
+        for (const auto& path : files("")) {
+            std::remove(path.c_str());
+        }
+        rmdir(dir.c_str());
+    }
+
+    static std::string value_for(uint64_t key, size_t round) {
+        return std::string(key % 300, char('a' + (key + round) % 26)) + std::to_string(round);
+    }
+};
+
+TEST_F(LogStoreTest, PutGetEraseOverwrite) {
+    LogStore store(dir);
+    EXPECT_EQ(store.get(1), std::nullopt);
+    store.put(1, "one");
+    store.put(2, "");
+    store.put(3, std::string(10000, 'x'));
+    EXPECT_EQ(store.get(1), std::optional<std::string>("one"));
+    EXPECT_EQ(store.get(2), std::optional<std::string>(""));
+    EXPECT_EQ(store.get(3), std::optional<std::string>(std::string(10000, 'x')));
+
+    store.put(1, "uno");
+    EXPECT_EQ(store.get(1), std::optional<std::string>("uno"));
+    EXPECT_TRUE(store.erase(2));
+    EXPECT_FALSE(store.erase(2));
+    EXPECT_EQ(store.get(2), std::nullopt);
+    EXPECT_EQ(store.size(), 2);
+}
+
+TEST_F(LogStoreTest, ReopenRebuildsIndexFromHintsAndScans) {
+    LogStoreConfig config;
+    config.segment_bytes = 16 << 10;
+    config.compact_garbage_ratio = 0;
+    {
+        LogStore store(dir, config);
+        for (uint64_t key = 0; key < 2000; key++) {
+            store.put(key, value_for(key, 0));
+        }
+        for (uint64_t key = 0; key < 2000; key += 3) {
+            store.erase(key);
+        }
+        EXPECT_GT(store.segment_count(), 10);
+    }
+    size_t from_hints;
+    {
+        LogStore store(dir, config);
+        from_hints = store.recovered_from_hints();
+        EXPECT_GT(from_hints, 10);
+        EXPECT_EQ(store.size(), 2000 - 667);
+        for (uint64_t key = 0; key < 2000; key++) {
+            ASSERT_EQ(store.get(key), key % 3 == 0 ? std::nullopt : std::optional<std::string>(value_for(key, 0)));
+        }
+    }
+
+    // without hints every segment is scanned, with the same result
+    for (const auto& path : files(".hint")) {
+        std::remove(path.c_str());
+    }
+    LogStore store(dir, config);
+    EXPECT_EQ(store.recovered_from_hints(), 0);
+    EXPECT_EQ(store.size(), 2000 - 667);
+    for (uint64_t key = 1; key < 2000; key += 3) {
+        ASSERT_EQ(store.get(key), std::optional<std::string>(value_for(key, 0)));
+    }
+}
+
+TEST_F(LogStoreTest, TornTailIsDropped) {
+    LogStoreConfig config;
+    config.compact_garbage_ratio = 0;
+    {
+        LogStore store(dir, config);
+        store.put(1, "kept");
+        store.put(2, "torn");
+    }
+    // the last segment has no hint yet; cut its last record in half
+    for (const auto& path : files(".hint")) {
+        std::remove(path.c_str());
+    }
+    for (const auto& path : files(".seg")) {
+        struct stat st;
+        stat(path.c_str(), &st);
+        if (st.st_size > 0) {
+            ASSERT_EQ(truncate(path.c_str(), st.st_size - 2), 0);
+        }
+    }
+    LogStore store(dir, config);
+    EXPECT_EQ(store.get(1), std::optional<std::string>("kept"));
+    EXPECT_EQ(store.get(2), std::nullopt);
+    store.put(3, "after");
+    EXPECT_EQ(store.get(3), std::optional<std::string>("after"));
+}
+
+TEST_F(LogStoreTest, ReopeningWithoutWritesLeavesNoEmptySegments) {
+    LogStoreConfig config;
+    config.compact_garbage_ratio = 0;
+    {
+        LogStore store(dir, config);
+        store.put(1, "one");
+    }
+    for (size_t open = 0; open < 5; open++) {
+        LogStore store(dir, config);
+        EXPECT_EQ(store.segment_count(), 2);
+        EXPECT_EQ(files(".seg").size(), 2);
+        EXPECT_EQ(store.get(1), std::optional<std::string>("one"));
+    }
+    {
+        LogStore store(dir, config);
+        store.put(2, "two");
+    }
+    LogStore store(dir, config);
+    EXPECT_EQ(store.segment_count(), 3);
+    EXPECT_EQ(store.get(2), std::optional<std::string>("two"));
+}
+
+TEST_F(LogStoreTest, CompactionDropsGarbage) {
+    LogStoreConfig config;
+    config.segment_bytes = 16 << 10;
+    config.compact_garbage_ratio = 0;
+    {
+        LogStore store(dir, config);
+        for (size_t round = 0; round < 5; round++) {
+            for (uint64_t key = 0; key < 500; key++) {
+                store.put(key, value_for(key, round));
+            }
+        }
+        for (uint64_t key = 0; key < 500; key += 2) {
+            store.erase(key);
+        }
+        const size_t before = store.segment_count();
+        EXPECT_GT(store.garbage_ratio(), 0.8);
+        store.compact();
+        EXPECT_EQ(store.compactions(), 1);
+        EXPECT_LT(store.segment_count(), before / 4);
+        EXPECT_EQ(store.garbage_ratio(), 0.0);
+        for (uint64_t key = 0; key < 500; key++) {
+            ASSERT_EQ(store.get(key), key % 2 == 0 ? std::nullopt : std::optional<std::string>(value_for(key, 4)));
+        }
+        // nothing left to reclaim
+        store.compact();
+        EXPECT_EQ(store.compactions(), 1);
+    }
+    LogStore store(dir, config);
+    EXPECT_EQ(store.size(), 250);
+    for (uint64_t key = 1; key < 500; key += 2) {
+        ASSERT_EQ(store.get(key), std::optional<std::string>(value_for(key, 4)));
+    }
+}
+
+TEST_F(LogStoreTest, BackgroundCompactionWithConcurrentWriters) {
+    LogStoreConfig config;
+    config.segment_bytes = 32 << 10;
+    config.compact_garbage_ratio = 0.5;
+    const size_t threads = 4;
+    const uint64_t keys_per_thread = 200;
+    {
+        LogStore store(dir, config);
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < threads; t++) {
+            writers.emplace_back([&, t] {
+                for (size_t round = 0; round < 20; round++) {
+                    for (uint64_t key = t * keys_per_thread; key < (t + 1) * keys_per_thread; key++) {
+                        store.put(key, value_for(key, round));
+                        ASSERT_EQ(store.get(key), std::optional<std::string>(value_for(key, round)));
+                    }
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        EXPECT_GT(store.compactions(), 0);
+        for (uint64_t key = 0; key < threads * keys_per_thread; key++) {
+            ASSERT_EQ(store.get(key), std::optional<std::string>(value_for(key, 19)));
+        }
+    }
+    LogStore store(dir, config);
+    EXPECT_EQ(store.size(), threads * keys_per_thread);
+    for (uint64_t key = 0; key < threads * keys_per_thread; key++) {
+        ASSERT_EQ(store.get(key), std::optional<std::string>(value_for(key, 19)));
+    }
+}
@@ -0,0 +1,407 @@
+#pragma once
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <endian.h>
+#include "request_batch.cpp"
+
+// memcached front end for the server, text and binary protocols. like the rest of
+// the server, keys and values are uint64 written as decimal text: a set whose key
+// or data is not an integer is refused, and a get for such a key is simply a miss.
+// flags and exptime are accepted and ignored, flags read back as 0 and gets
+// reports a cas of 0. binary incr / decr on a missing key stores and returns
+// the extras' initial value, as memcached does, unless the expiration is
+// 0xffffffff, which answers not found; the expiration is otherwise ignored. a multi-key get becomes one MGet request, so its keys go
+// through get_batch together.
+//
+//   text    get / gets <key>*, set <key> <flags> <exptime> <bytes> [noreply],
+//           delete <key> [noreply], incr / decr <key> <delta> [noreply], version, quit
+//   binary  get, getq, getk, getkq, set, setq, delete, deleteq, incr, incrq,
+//           decr, decrq, noop, version, quit. a binary multi-get is the usual run
+//           of getkq ending in noop, which arrives in one read and batches the same way
+
+static constexpr uint8_t MEMCACHED_NOREPLY = 1;
+static constexpr uint8_t MEMCACHED_GETS = 2;
+static constexpr uint8_t MEMCACHED_WITH_KEY = 4;
+
+// a multi-get line carries a few thousand keys at most
+static constexpr size_t MEMCACHED_MAX_LINE = 64 * 1024;
+
+static constexpr const char* MEMCACHED_ERROR = "ERROR\r\n";
+static constexpr const char* MEMCACHED_ERR_FORMAT = "CLIENT_ERROR bad command line format\r\n";
+static constexpr const char* MEMCACHED_ERR_CHUNK = "CLIENT_ERROR bad data chunk\r\n";
+static constexpr const char* MEMCACHED_ERR_DELTA = "CLIENT_ERROR invalid numeric delta argument\r\n";
+static constexpr const char* MEMCACHED_ERR_LINE = "CLIENT_ERROR line too long\r\n";
+static constexpr const char* MEMCACHED_VERSION = "1.6.0-oat";
+
+inline void append_decimal(uint64_t value, std::string& out) {
+    char digits[24];
+    auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end);
+}
+
+// ---- text protocol ----
+
+inline void split_tokens(const char* line, size_t len, std::vector<std::string_view>& tokens) {
+    tokens.clear();
+    size_t pos = 0;
+    while (pos < len) {
+        while (pos < len && line[pos] == ' ') ++pos;
+        const size_t start = pos;
+        while (pos < len && line[pos] != ' ') ++pos;
+        if (pos > start) {
+            tokens.emplace_back(line + start, pos - start);
+        }
+    }
+}
+
+// returns the number of bytes consumed, stopping at the first incomplete command
+inline size_t parse_memcached_text(const char* data, size_t len, RequestBatch& batch) {
+    std::vector<std::string_view> tokens;
+    size_t consumed = 0;
+
+    while (consumed < len) {
+        const char* line = data + consumed;
+        const void* lf = std::memchr(line, '\n', len - consumed);
+        if (lf == nullptr) {
+            if (len - consumed > MEMCACHED_MAX_LINE) {
+                batch.add_error(MEMCACHED_ERR_LINE);
+                return PARSE_ERROR;
+            }
+            break;
+        }
+        size_t line_len = static_cast<const char*>(lf) - line;
+        size_t next = consumed + line_len + 1;
+        if (line_len > 0 && line[line_len - 1] == '\r') {
+            --line_len;
+        }
+        split_tokens(line, line_len, tokens);
+
+        if (tokens.empty()) {
+            batch.add_error(MEMCACHED_ERROR);
+            consumed = next;
+            continue;
+        }
+        const std::string_view command = tokens[0];
+        const bool noreply = tokens.back() == "noreply";
+        const size_t argc = tokens.size() - noreply;
+
+        if (command == "get" || command == "gets") {
+            if (tokens.size() < 2) {
+                batch.add_error(MEMCACHED_ERROR);
+            } else {
+                const size_t first = batch.keys_.size();
+                for (size_t i = 1; i < tokens.size(); ++i) {
+                    uint64_t key;
+                    // a key that is not an integer cannot be stored, so it is a miss
+                    if (parse_u64(tokens[i], key)) {
+                        batch.keys_.push_back(key);
+                    }
+                }
+                batch.add_multi(RequestOp::MGet, first).wire_flags_ = command == "gets" ? MEMCACHED_GETS : 0;
+            }
+        } else if (command == "set") {
+            uint64_t bytes;
+            if (argc != 5 || !parse_u64(tokens[4], bytes) || bytes > MEMCACHED_MAX_LINE) {
+                batch.add_error(MEMCACHED_ERR_FORMAT);
+                consumed = next;
+                continue;
+            }
+            if (len - next < bytes + 2) {
+                break;
+            }
+            uint64_t key, val;
+            const std::string_view block(data + next, bytes);
+            const bool terminated = data[next + bytes] == '\r' && data[next + bytes + 1] == '\n';
+            if (!terminated || !parse_u64(tokens[1], key) || !parse_u64(block, val)) {
+                batch.add_error(MEMCACHED_ERR_CHUNK);
+            } else {
+                batch.add(RequestOp::Set, key, val).wire_flags_ = noreply ? MEMCACHED_NOREPLY : 0;
+            }
+            next += bytes + 2;
+        } else if (command == "delete") {
+            uint64_t key;
+            if (argc != 2) {
+                batch.add_error(MEMCACHED_ERR_FORMAT);
+            } else if (!parse_u64(tokens[1], key)) {
+                Request& request = batch.add_multi(RequestOp::Del, batch.keys_.size());
+                request.wire_flags_ = noreply ? MEMCACHED_NOREPLY : 0;
+            } else {
+                batch.add(RequestOp::Del, key).wire_flags_ = noreply ? MEMCACHED_NOREPLY : 0;
+            }
+        } else if (command == "incr" || command == "decr") {
+            uint64_t key, delta;
+            const RequestOp op = command == "incr" ? RequestOp::Incr : RequestOp::Decr;
+            if (argc != 3) {
+                batch.add_error(MEMCACHED_ERR_FORMAT);
+            } else if (!parse_u64(tokens[2], delta)) {
+                batch.add_error(MEMCACHED_ERR_DELTA);
+            } else if (!parse_u64(tokens[1], key)) {
+                batch.add_multi(op, batch.keys_.size()).wire_flags_ = noreply ? MEMCACHED_NOREPLY : 0;
+            } else {
+                batch.add(op, key, delta).wire_flags_ = noreply ? MEMCACHED_NOREPLY : 0;
+            }
+        } else if (command == "version") {
+            batch.add_multi(RequestOp::Ping, batch.keys_.size());
+        } else if (command == "quit") {
+            return PARSE_ERROR;
+        } else {
+            batch.add_error(MEMCACHED_ERROR);
+        }
+        consumed = next;
+    }
+    return consumed;
+}
+
+inline void encode_memcached_text(const RequestBatch& batch, std::string& out) {
+    for (const auto& request : batch.requests_) {
+        const size_t first = request.first_key_;
+        const bool noreply = request.wire_flags_ & MEMCACHED_NOREPLY;
+        // requests built from a non-integer key have no key and always miss
+        const bool found = request.key_count_ > 0 && batch.results_[first].has_value();
+
+        switch (request.op_) {
+            case RequestOp::Get:
+            case RequestOp::MGet:
+                for (size_t i = first; i < first + request.key_count_; ++i) {
+                    if (!batch.results_[i].has_value()) {
+                        continue;
+                    }
+                    char value[24];
+                    auto end = std::to_chars(value, value + sizeof(value), *batch.results_[i]).ptr;
+                    out += "VALUE ";
+                    append_decimal(batch.keys_[i], out);
+                    out += " 0 ";
+                    append_decimal(end - value, out);
+                    out += request.wire_flags_ & MEMCACHED_GETS ? " 0\r\n" : "\r\n";
+                    out.append(value, end);
+                    out += "\r\n";
+                }
+                out += "END\r\n";
+                break;
+            case RequestOp::Set:
+                if (!noreply) out += "STORED\r\n";
+                break;
+            case RequestOp::Del:
+                if (!noreply) out += found ? "DELETED\r\n" : "NOT_FOUND\r\n";
+                break;
+            case RequestOp::Incr:
+            case RequestOp::Decr:
+                if (noreply) break;
+                if (found) {
+                    append_decimal(*batch.results_[first], out);
+                    out += "\r\n";
+                } else {
+                    out += "NOT_FOUND\r\n";
+                }
+                break;
+            case RequestOp::Ping:
+                out += "VERSION ";
+                out += MEMCACHED_VERSION;
+                out += "\r\n";
+                break;
+            case RequestOp::Error:
+                out += request.error_;
+                break;
+        }
+    }
+}
+
+// ---- binary protocol ----
+
+static constexpr uint8_t MEMCACHED_REQUEST_MAGIC = 0x80;
+static constexpr uint8_t MEMCACHED_RESPONSE_MAGIC = 0x81;
+static constexpr size_t MEMCACHED_HEADER_SIZE = 24;
+static constexpr size_t MEMCACHED_MAX_BODY = 1 << 20;
+
+enum MemcachedOpcode : uint8_t {
+    MC_GET = 0x00, MC_SET = 0x01, MC_DELETE = 0x04, MC_INCR = 0x05, MC_DECR = 0x06,
+    MC_QUIT = 0x07, MC_GETQ = 0x09, MC_NOOP = 0x0a, MC_VERSION = 0x0b, MC_GETK = 0x0c,
+    MC_GETKQ = 0x0d, MC_SETQ = 0x11, MC_DELETEQ = 0x14, MC_INCRQ = 0x15, MC_DECRQ = 0x16,
+    MC_QUITQ = 0x17,
+};
+
+// incr / decr expiration that turns off creating a missing counter
+static constexpr uint32_t MC_NO_AUTO_CREATE = 0xffffffff;
+
+static constexpr uint16_t MC_STATUS_OK = 0x0000;
+static constexpr uint16_t MC_STATUS_NOT_FOUND = 0x0001;
+static constexpr uint16_t MC_STATUS_INVALID = 0x0004;
+static constexpr uint16_t MC_STATUS_UNKNOWN = 0x0081;
+
+inline uint16_t load_be16(const char* p) { uint16_t v; std::memcpy(&v, p, 2); return be16toh(v); }
+inline uint32_t load_be32(const char* p) { uint32_t v; std::memcpy(&v, p, 4); return be32toh(v); }
+inline uint64_t load_be64(const char* p) { uint64_t v; std::memcpy(&v, p, 8); return be64toh(v); }
+
+// returns the number of bytes consumed, stopping at the first incomplete packet
+inline size_t parse_memcached_binary(const char* data, size_t len, RequestBatch& batch) {
+    size_t pos = 0;
+    while (len - pos >= MEMCACHED_HEADER_SIZE) {
+        const char* header = data + pos;
+        const uint8_t opcode = static_cast<uint8_t>(header[1]);
+        const uint16_t key_len = load_be16(header + 2);
+        const uint8_t extras_len = static_cast<uint8_t>(header[4]);
+        const uint32_t body_len = load_be32(header + 8);
+        uint32_t opaque;
+        std::memcpy(&opaque, header + 12, sizeof(opaque));
+
+        if (static_cast<uint8_t>(header[0]) != MEMCACHED_REQUEST_MAGIC || body_len > MEMCACHED_MAX_BODY ||
+            key_len + extras_len > body_len) {
+            return PARSE_ERROR;
+        }
+        if (len - pos < MEMCACHED_HEADER_SIZE + body_len) {
+            break;
+        }
+
+        const char* extras = header + MEMCACHED_HEADER_SIZE;
+        const std::string_view key_text(extras + extras_len, key_len);
+        const std::string_view value_text(extras + extras_len + key_len, body_len - extras_len - key_len);
+        const bool quiet = opcode == MC_GETQ || opcode == MC_GETKQ || opcode == MC_SETQ ||
+                           opcode == MC_DELETEQ || opcode == MC_INCRQ || opcode == MC_DECRQ;
+        uint64_t key = 0;
+        const bool key_ok = parse_u64(key_text, key);
+
+        Request* request = nullptr;
+        switch (opcode) {
+            case MC_GET:
+            case MC_GETQ:
+            case MC_GETK:
+            case MC_GETKQ:
+                request = key_ok ? &batch.add(RequestOp::Get, key) : &batch.add_error("Not found");
+                if (!key_ok) request->val_ = MC_STATUS_NOT_FOUND;
+                if (opcode == MC_GETK || opcode == MC_GETKQ) request->wire_flags_ |= MEMCACHED_WITH_KEY;
+                break;
+            case MC_SET:
+            case MC_SETQ: {
+                uint64_t val;
+                if (extras_len == 8 && key_ok && parse_u64(value_text, val)) {
+                    request = &batch.add(RequestOp::Set, key, val);
+                } else {
+                    request = &batch.add_error("Invalid arguments");
+                    request->val_ = MC_STATUS_INVALID;
+                }
+                break;
+            }
+            case MC_DELETE:
+            case MC_DELETEQ:
+                request = key_ok ? &batch.add(RequestOp::Del, key) : &batch.add_multi(RequestOp::Del, batch.keys_.size());
+                break;
+            case MC_INCR:
+            case MC_INCRQ:
+            case MC_DECR:
+            case MC_DECRQ: {
+                const RequestOp op = opcode == MC_INCR || opcode == MC_INCRQ ? RequestOp::Incr : RequestOp::Decr;
+                if (extras_len != 20) {
+                    request = &batch.add_error("Invalid arguments");
+                    request->val_ = MC_STATUS_INVALID;
+                } else if (key_ok) {
+                    request = &batch.add(op, key, load_be64(extras));
+                    if (load_be32(extras + 16) != MC_NO_AUTO_CREATE) {
+                        request->initial_ = load_be64(extras + 8);
+                    }
+                } else {
+                    request = &batch.add_multi(op, batch.keys_.size());
+                }
+                break;
+            }
+            case MC_NOOP:
+            case MC_VERSION:
+                request = &batch.add_multi(RequestOp::Ping, batch.keys_.size());
+                break;
+            case MC_QUIT:
+            case MC_QUITQ:
+                return PARSE_ERROR;
+            default:
+                request = &batch.add_error("Unknown command");
+                request->val_ = MC_STATUS_UNKNOWN;
+                break;
+        }
+        request->wire_op_ = opcode;
+        request->opaque_ = opaque;
+        if (quiet) request->wire_flags_ |= MEMCACHED_NOREPLY;
+        pos += MEMCACHED_HEADER_SIZE + body_len;
+    }
+    return pos;
+}
+
+inline void append_memcached_response(const Request& request, uint16_t status, std::string_view extras,
+                                      std::string_view key, std::string_view value, std::string& out) {
+    char header[MEMCACHED_HEADER_SIZE] = {};
+    header[0] = static_cast<char>(MEMCACHED_RESPONSE_MAGIC);
+    header[1] = static_cast<char>(request.wire_op_);
+    const uint16_t key_len = htobe16(static_cast<uint16_t>(key.size()));
+    const uint16_t status_be = htobe16(status);
+    const uint32_t body_len = htobe32(static_cast<uint32_t>(extras.size() + key.size() + value.size()));
+    std::memcpy(header + 2, &key_len, 2);
+    header[4] = static_cast<char>(extras.size());
+    std::memcpy(header + 6, &status_be, 2);
+    std::memcpy(header + 8, &body_len, 4);
+    std::memcpy(header + 12, &request.opaque_, 4);
+    out.append(header, sizeof(header));
+    out.append(extras.data(), extras.size());
+    out.append(key.data(), key.size());
+    out.append(value.data(), value.size());
+}
+
+inline void encode_memcached_binary(const RequestBatch& batch, std::string& out) {
+    static constexpr char ZERO_FLAGS[4] = {};
+    for (const auto& request : batch.requests_) {
+        const size_t first = request.first_key_;
+        const bool quiet = request.wire_flags_ & MEMCACHED_NOREPLY;
+        const bool found = request.key_count_ > 0 && batch.results_[first].has_value();
+
+        char key[24];
+        size_t key_len = 0;
+        if (request.key_count_ > 0 && (request.wire_flags_ & MEMCACHED_WITH_KEY)) {
+            key_len = std::to_chars(key, key + sizeof(key), batch.keys_[first]).ptr - key;
+        }
+
+        switch (request.op_) {
+            case RequestOp::Get:
+            case RequestOp::MGet:
+                if (found) {
+                    char value[24];
+                    auto end = std::to_chars(value, value + sizeof(value), *batch.results_[first]).ptr;
+                    append_memcached_response(request, MC_STATUS_OK, {ZERO_FLAGS, 4}, {key, key_len},
+                                              {value, static_cast<size_t>(end - value)}, out);
+                } else if (!quiet) {
+                    append_memcached_response(request, MC_STATUS_NOT_FOUND, {}, {key, key_len},
+                                              key_len ? "" : "Not found", out);
+                }
+                break;
+            case RequestOp::Set:
+                if (!quiet) append_memcached_response(request, MC_STATUS_OK, {}, {}, {}, out);
+                break;
+            case RequestOp::Del:
+                if (!found) {
+                    append_memcached_response(request, MC_STATUS_NOT_FOUND, {}, {}, "Not found", out);
+                } else if (!quiet) {
+                    append_memcached_response(request, MC_STATUS_OK, {}, {}, {}, out);
+                }
+                break;
+            case RequestOp::Incr:
+            case RequestOp::Decr:
+                if (!found) {
+                    append_memcached_response(request, MC_STATUS_NOT_FOUND, {}, {}, "Not found", out);
+                } else if (!quiet) {
+                    const uint64_t value = htobe64(*batch.results_[first]);
+                    append_memcached_response(request, MC_STATUS_OK, {}, {},
+                                              {reinterpret_cast<const char*>(&value), 8}, out);
+                }
+                break;
+            case RequestOp::Ping:
+                append_memcached_response(request, MC_STATUS_OK, {}, {},
+                                          request.wire_op_ == MC_VERSION ? MEMCACHED_VERSION : "", out);
+                break;
+            case RequestOp::Error:
+                // a quiet get that misses stays quiet, every other error is reported
+                if (!(quiet && request.val_ == MC_STATUS_NOT_FOUND)) {
+                    append_memcached_response(request, static_cast<uint16_t>(request.val_), {}, {},
+                                              request.error_, out);
+                }
+                break;
+        }
+    }
+}
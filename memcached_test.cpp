@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include "server.cpp"
+
+class MemcachedTest : public ::testing::Test {
+protected:
+    std::unique_ptr<KvServer> server;
+
+    void SetUp() override {
+        ServerConfig config;
+        config.port = 0;
+        config.workers = 2;
+        config.initial_size = 64;
+        server = std::make_unique<KvServer>(config);
+        server->start();
+    }
+
+    int connect_client() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(server->port());
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        timeval timeout{5, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+    static std::string request(int fd, const std::string& data, size_t reply_len) {
+        EXPECT_EQ(send(fd, data.data(), data.size(), MSG_NOSIGNAL), static_cast<ssize_t>(data.size()));
+        std::string reply(reply_len, '\0');
+        size_t got = 0;
+        while (got < reply_len) {
+            ssize_t n = recv(fd, &reply[got], reply_len - got, 0);
+            if (n <= 0) break;
+            got += n;
+        }
+        reply.resize(got);
+        return reply;
+    }
+
+    static std::string packet(uint8_t opcode, const std::string& key, const std::string& value = "",
+                              const std::string& extras = "", uint32_t opaque = 0) {
+        std::string header(MEMCACHED_HEADER_SIZE, '\0');
+        header[0] = static_cast<char>(MEMCACHED_REQUEST_MAGIC);
+        header[1] = static_cast<char>(opcode);
+        const uint16_t key_len = htobe16(key.size());
+        const uint32_t body_len = htobe32(extras.size() + key.size() + value.size());
+        std::memcpy(&header[2], &key_len, 2);
+        header[4] = static_cast<char>(extras.size());
+        std::memcpy(&header[8], &body_len, 4);
+        std::memcpy(&header[12], &opaque, 4);
+        return header + extras + key + value;
+    }
+
+    struct Response {
+        uint8_t opcode;
+        uint16_t status;
+        uint32_t opaque;
+        std::string key;
+        std::string value;
+    };
+
+    static std::vector<Response> decode(const std::string& data) {
+        std::vector<Response> responses;
+        size_t pos = 0;
+        while (pos + MEMCACHED_HEADER_SIZE <= data.size()) {
+            const char* header = data.data() + pos;
+            EXPECT_EQ(static_cast<uint8_t>(header[0]), MEMCACHED_RESPONSE_MAGIC);
+            const uint16_t key_len = load_be16(header + 2);
+            const uint8_t extras_len = static_cast<uint8_t>(header[4]);
+            const uint32_t body_len = load_be32(header + 8);
+            Response response{static_cast<uint8_t>(header[1]), load_be16(header + 6), 0, "", ""};
+            std::memcpy(&response.opaque, header + 12, 4);
+            response.key.assign(header + MEMCACHED_HEADER_SIZE + extras_len, key_len);
+            response.value.assign(header + MEMCACHED_HEADER_SIZE + extras_len + key_len,
+                                  body_len - extras_len - key_len);
+            responses.push_back(response);
+            pos += MEMCACHED_HEADER_SIZE + body_len;
+        }
+        return responses;
+    }
+};
+
+TEST_F(MemcachedTest, TextSetGetDelete) {
+    int fd = connect_client();
+    auto expect_reply = [&](const std::string& command, const std::string& expected) {
+        EXPECT_EQ(request(fd, command, expected.size()), expected);
+    };
+    expect_reply("set 1 0 0 3\r\n100\r\n", "STORED\r\n");
+    expect_reply("get 1\r\n", "VALUE 1 0 3\r\n100\r\nEND\r\n");
+    expect_reply("gets 1\r\n", "VALUE 1 0 3 0\r\n100\r\nEND\r\n");
+    expect_reply("delete 1\r\n", "DELETED\r\n");
+    expect_reply("delete 1\r\n", "NOT_FOUND\r\n");
+    expect_reply("get 1\r\n", "END\r\n");
+    close(fd);
+}
+
+TEST_F(MemcachedTest, TextMultiGetAndNoreply) {
+    int fd = connect_client();
+    const std::string sets = "set 1 0 0 2 noreply\r\n11\r\nset 3 5 0 2 noreply\r\n33\r\n";
+    const std::string expected = "VALUE 1 0 2\r\n11\r\nVALUE 3 0 2\r\n33\r\nEND\r\n";
+    EXPECT_EQ(request(fd, sets + "get 1 2 3 abc\r\n", expected.size()), expected);
+    close(fd);
+}
+
+TEST_F(MemcachedTest, TextIncrDecr) {
+    int fd = connect_client();
+    const std::string max = std::to_string(UINT64_MAX);
+    const std::string requests = "incr 9 1\r\n"
+                                 "set 9 0 0 1\r\n5\r\n"
+                                 "incr 9 10\r\n"
+                                 "decr 9 100\r\n"
+                                 "set 8 0 0 " + std::to_string(max.size()) + "\r\n" + max + "\r\n"
+                                 "incr 8 2\r\n"
+                                 "incr 9 x\r\n";
+    const std::string expected = "NOT_FOUND\r\nSTORED\r\n15\r\n0\r\nSTORED\r\n1\r\n"
+                                 "CLIENT_ERROR invalid numeric delta argument\r\n";
+    EXPECT_EQ(request(fd, requests, expected.size()), expected);
+    close(fd);
+}
+
+TEST_F(MemcachedTest, TextErrorsKeepTheConnection) {
+    int fd = connect_client();
+    const std::string requests = "bogus\r\n"
+                                 "set 1 0 0\r\n"
+                                 "set abc 0 0 1\r\n1\r\n"
+                                 "set 2 0 0 3\r\nxyz\r\n"
+                                 "version\r\n";
+    const std::string expected = "ERROR\r\n"
+                                 "CLIENT_ERROR bad command line format\r\n"
+                                 "CLIENT_ERROR bad data chunk\r\n"
+                                 "CLIENT_ERROR bad data chunk\r\n"
+                                 "VERSION 1.6.0-oat\r\n";
+    EXPECT_EQ(request(fd, requests, expected.size()), expected);
+    EXPECT_EQ(request(fd, "quit\r\n", 1), "");
+    close(fd);
+}
+
+TEST_F(MemcachedTest, TextDataBlockSplitAcrossReads) {
+    int fd = connect_client();
+    ASSERT_EQ(send(fd, "set 4 0 0 4\r\n12", 15, 0), 15);
+    usleep(20000);
+    const std::string expected = "STORED\r\nVALUE 4 0 4\r\n1234\r\nEND\r\n";
+    EXPECT_EQ(request(fd, "34\r\nget 4\r\n", expected.size()), expected);
+    close(fd);
+}
+
+TEST_F(MemcachedTest, BinarySetGetDelete) {
+    int fd = connect_client();
+    const std::string set_extras(8, '\0');
+    auto responses = decode(request(fd, packet(MC_SET, "7", "700", set_extras, 11) + packet(MC_GET, "7", "", "", 12) +
+                                        packet(MC_GETK, "8", "", "", 13) + packet(MC_DELETE, "7", "", "", 14),
+                                    24 + (24 + 4 + 3) + (24 + 1) + 24));
+    ASSERT_EQ(responses.size(), 4);
+    EXPECT_EQ(responses[0].status, MC_STATUS_OK);
+    EXPECT_EQ(responses[0].opaque, 11);
+    EXPECT_EQ(responses[1].status, MC_STATUS_OK);
+    EXPECT_EQ(responses[1].value, "700");
+    EXPECT_EQ(responses[2].status, MC_STATUS_NOT_FOUND);
+    EXPECT_EQ(responses[2].key, "8");
+    EXPECT_EQ(responses[3].opcode, MC_DELETE);
+    EXPECT_EQ(responses[3].status, MC_STATUS_OK);
+    close(fd);
+}
+
+// the getkq ... noop idiom: misses stay silent and noop marks the end
+TEST_F(MemcachedTest, BinaryQuietMultiGet) {
+    int fd = connect_client();
+    const std::string set_extras(8, '\0');
+    std::string requests;
+    for (int key = 0; key < 10; key += 2) {
+        requests += packet(MC_SETQ, std::to_string(key), std::to_string(key * 10), set_extras);
+    }
+    for (int key = 0; key < 10; key++) {
+        requests += packet(MC_GETKQ, std::to_string(key), "", "", key);
+    }
+    requests += packet(MC_NOOP, "");
+
+    size_t reply_len = 24;
+    for (int key = 0; key < 10; key += 2) {
+        reply_len += 24 + 4 + std::to_string(key).size() + std::to_string(key * 10).size();
+    }
+    auto responses = decode(request(fd, requests, reply_len));
+    ASSERT_EQ(responses.size(), 6);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(responses[i].key, std::to_string(i * 2));
+        EXPECT_EQ(responses[i].value, std::to_string(i * 20));
+        EXPECT_EQ(responses[i].opaque, i * 2);
+    }
+    EXPECT_EQ(responses[5].opcode, MC_NOOP);
+    close(fd);
+}
+
+TEST_F(MemcachedTest, BinaryIncrDecr) {
+    int fd = connect_client();
+    // an expiration of 0xffffffff leaves a missing counter missing
+    std::string extras(20, '\xff');
+    const uint64_t delta = htobe64(5);
+    std::memcpy(&extras[0], &delta, 8);
+
+    auto responses = decode(request(fd, packet(MC_INCR, "3", "", extras) +
+                                        packet(MC_SET, "3", "10", std::string(8, '\0')) +
+                                        packet(MC_INCR, "3", "", extras) + packet(MC_DECR, "3", "", extras) +
+                                        packet(0x42, "3"),
+                                    (24 + 9) + 24 + (24 + 8) + (24 + 8) + (24 + 15)));
+    ASSERT_EQ(responses.size(), 5);
+    EXPECT_EQ(responses[0].status, MC_STATUS_NOT_FOUND);
+    EXPECT_EQ(load_be64(responses[2].value.data()), 15);
+    EXPECT_EQ(load_be64(responses[3].value.data()), 10);
+    EXPECT_EQ(responses[4].status, MC_STATUS_UNKNOWN);
+    close(fd);
+}
+
+TEST_F(MemcachedTest, BinaryIncrCreatesMissingCounter) {
+    int fd = connect_client();
+    std::string extras(20, '\0');
+    const uint64_t delta = htobe64(5);
+    const uint64_t initial = htobe64(100);
+    std::memcpy(&extras[0], &delta, 8);
+    std::memcpy(&extras[8], &initial, 8);
+
+    // the first incr stores the initial value untouched, the second applies the delta
+    auto responses = decode(request(fd, packet(MC_INCR, "4", "", extras) + packet(MC_DECR, "4", "", extras) +
+                                        packet(MC_GET, "4"),
+                                    (24 + 8) + (24 + 8) + (24 + 4 + 2)));
+    ASSERT_EQ(responses.size(), 3);
+    EXPECT_EQ(responses[0].status, MC_STATUS_OK);
+    EXPECT_EQ(load_be64(responses[0].value.data()), 100);
+    EXPECT_EQ(load_be64(responses[1].value.data()), 95);
+    EXPECT_EQ(responses[2].value, "95");
+    close(fd);
+}
+
+TEST_F(MemcachedTest, MultiGetIsOneBatchedRequest) {
+    RequestBatch batch;
+    const std::string line = "get 1 2 3 4 5\r\nget 6\r\n";
+    EXPECT_EQ(parse_memcached_text(line.data(), line.size(), batch), line.size());
+    ASSERT_EQ(batch.requests_.size(), 2);
+    EXPECT_EQ(batch.requests_[0].op_, RequestOp::MGet);
+    EXPECT_EQ(batch.requests_[0].key_count_, 5);
+    EXPECT_EQ(batch.keys_.size(), 6);
+}
@@ -0,0 +1,181 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <unordered_map>
+#include <malloc.h>
+#include <unistd.h>
+#include "table.cpp"
+
+// every allocation in this binary goes through these counters, so the
+// figures below include vector slack, node overhead and the old array that
+// is still alive while resize() rehashes into the new one
+static std::atomic<size_t> g_allocated_bytes{0};
+static std::atomic<size_t> g_peak_bytes{0};
+
+static void count_allocation(void* p) {
+    // usable size rather than n, malloc rounding is memory we pay for too
+    size_t bytes = malloc_usable_size(p);
+    size_t now = g_allocated_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    size_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+    while (now > peak && !g_peak_bytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+}
+
+// the replacements below all allocate and free through these two, so every
+// form of new is paired with a delete that releases memory the same way
+static void* counted_alloc(size_t n, size_t alignment) {
+    void* p = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        p = std::malloc(n ? n : 1);
+    } else if (posix_memalign(&p, alignment, n ? n : 1) != 0) {
+        p = nullptr;
+    }
+    if (!p) throw std::bad_alloc();
+    count_allocation(p);
+    return p;
+}
+
+static void counted_free(void* p) noexcept {
+    if (!p) return;
+    g_allocated_bytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+    std::free(p);
+}
+
+void* operator new(size_t n) { return counted_alloc(n, 0); }
+void* operator new[](size_t n) { return counted_alloc(n, 0); }
+void* operator new(size_t n, std::align_val_t al) { return counted_alloc(n, static_cast<size_t>(al)); }
+void* operator new[](size_t n, std::align_val_t al) { return counted_alloc(n, static_cast<size_t>(al)); }
+
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, size_t) noexcept { counted_free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { counted_free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { counted_free(p); }
+
+// rss is reported as a delta, it reads low when malloc hands back pages freed by an
+// earlier case, so filter to a single case when the rss column matters
+static size_t current_rss_bytes() {
+    long pages = 0;
+    long resident = 0;
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    std::fclose(f);
+    return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+static size_t next_power_of_two(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+struct MemorySample {
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t rss_bytes;
+};
+
+// builds a table with `count` distinct keys and reports what it cost relative to an empty heap
+template <typename Build>
+MemorySample measure(Build&& build) {
+    size_t base_allocated = g_allocated_bytes.load();
+    g_peak_bytes.store(base_allocated);
+    size_t base_rss = current_rss_bytes();
+
+    MemorySample sample{};
+    build([&] {
+        sample.live_bytes = g_allocated_bytes.load() - base_allocated;
+        sample.peak_bytes = g_peak_bytes.load() - base_allocated;
+        size_t rss = current_rss_bytes();
+        sample.rss_bytes = rss > base_rss ? rss - base_rss : 0;
+    });
+    return sample;
+}
+
+static void report(benchmark::State& state, const MemorySample& sample, size_t count, double load_factor) {
+    state.counters["live_entries"] = static_cast<double>(count);
+    state.counters["load_factor"] = load_factor;
+    state.counters["alloc_bytes"] = static_cast<double>(sample.live_bytes);
+    state.counters["peak_bytes"] = static_cast<double>(sample.peak_bytes);
+    state.counters["rss_bytes"] = static_cast<double>(sample.rss_bytes);
+    state.counters["bytes_per_entry"] = static_cast<double>(sample.live_bytes) / count;
+    state.counters["peak_bytes_per_entry"] = static_cast<double>(sample.peak_bytes) / count;
+}
+
+// range(0): number of live entries
+// range(1): target load factor in percent, 0 lets the table grow from its default size
+static void BM_OpenAddressTable_Memory(benchmark::State& state) {
+    const size_t count = state.range(0);
+    const int64_t lf_pct = state.range(1);
+
+    for (auto _ : state) {
+        double load_factor = 0;
+        auto sample = measure([&](auto&& snapshot) {
+            // presized tables must stay under LOAD_FACTOR_THRESHOLD or the first insert past it doubles them
+            OpenAddressTable hashmap = lf_pct == 0
+                    ? OpenAddressTable()
+                    : OpenAddressTable(next_power_of_two(count * 100 / lf_pct));
+            std::mt19937_64 generator(42);
+            while (hashmap.size() < count) {
+                hashmap.insert(generator(), 0);
+            }
+            load_factor = hashmap.load_factor();
+            snapshot();
+            benchmark::DoNotOptimize(hashmap.data_.data());
+        });
+        report(state, sample, count, load_factor);
+    }
+}
+
+static void BM_UnorderedMap_Memory(benchmark::State& state) {
+    const size_t count = state.range(0);
+    const int64_t lf_pct = state.range(1);
+
+    for (auto _ : state) {
+        double load_factor = 0;
+        auto sample = measure([&](auto&& snapshot) {
+            std::unordered_map<uint64_t, uint64_t> hashmap;
+            if (lf_pct != 0) {
+                hashmap.max_load_factor(lf_pct / 100.0f);
+                hashmap.reserve(count);
+            }
+            std::mt19937_64 generator(42);
+            while (hashmap.size() < count) {
+                hashmap.insert({generator(), 0});
+            }
+            load_factor = hashmap.load_factor();
+            snapshot();
+            benchmark::DoNotOptimize(&hashmap);
+        });
+        report(state, sample, count, load_factor);
+    }
+}
+
+static void MemoryArgs(benchmark::internal::Benchmark* b) {
+    for (int64_t count : {10'000, 100'000, 1'000'000, 10'000'000}) {
+        for (int64_t lf_pct : {0, 25, 50, 70}) {
+            b->Args({count, lf_pct});
+        }
+    }
+}
+
+// a single iteration is exact here, repeating only re-measures the same allocations
+BENCHMARK(BM_OpenAddressTable_Memory)
+        ->Apply(MemoryArgs)
+        ->ArgNames({"entries", "lf_pct"})
+        ->Iterations(1)
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_UnorderedMap_Memory)
+        ->Apply(MemoryArgs)
+        ->ArgNames({"entries", "lf_pct"})
+        ->Iterations(1)
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include "parallel_merge.cpp"
+
+// usage: merge_benchmark [tables=200] [keys_per_table=50000] [key_space=5000000] [threads=0]
+//
+// merges `tables` partial tables whose keys overlap, summing values on
+// conflict: one get and insert per entry, merge_from one table at a time, and
+// merge_parallel over all of them
+
+const size_t DEFAULT_TABLES = 200;
+const size_t DEFAULT_KEYS_PER_TABLE = 50'000;
+const size_t DEFAULT_KEY_SPACE = 5'000'000;
+
+using Clock = std::chrono::steady_clock;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static std::vector<OpenAddressTable> make_tables(size_t tables, size_t keys_per_table, size_t key_space) {
+    std::mt19937_64 gen(42);
+    std::vector<OpenAddressTable> out(tables);
+    for (auto& table : out) {
+        for (size_t i = 0; i < keys_per_table; i++) {
+            table.insert(gen() % key_space, 1);
+        }
+    }
+    return out;
+}
+
+static void report(const std::string& name, double seconds, size_t entries, size_t size) {
+    std::cout << std::setw(16) << name << std::setw(10) << std::fixed << std::setprecision(3) << seconds
+              << std::setw(14) << std::setprecision(0) << entries / seconds << std::setw(12) << size << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    const size_t tables = argc > 1 ? std::stoull(argv[1]) : DEFAULT_TABLES;
+    const size_t keys_per_table = argc > 2 ? std::stoull(argv[2]) : DEFAULT_KEYS_PER_TABLE;
+    const size_t key_space = argc > 3 ? std::stoull(argv[3]) : DEFAULT_KEY_SPACE;
+    const size_t threads = argc > 4 ? std::stoull(argv[4]) : 0;
+    auto add = [](uint64_t, uint64_t a, uint64_t b) { return a + b; };
+
+    size_t entries = 0;
+    for (const auto& table : make_tables(tables, keys_per_table, key_space)) {
+        entries += table.size();
+    }
+
+    std::cout << std::setw(16) << "method" << std::setw(10) << "seconds" << std::setw(14) << "entries/s"
+              << std::setw(12) << "size" << "\n";
+    {
+        auto inputs = make_tables(tables, keys_per_table, key_space);
+        auto start = Clock::now();
+        OpenAddressTable result;
+        for (auto& input : inputs) {
+            for (const auto& entry : input.data_) {
+                if (entry.status_ != 2) continue;
+                auto current = result.get(entry.key_);
+                result.insert(entry.key_, current ? *current + entry.val_ : entry.val_);
+            }
+        }
+        report("get + insert", seconds_since(start), entries, result.size());
+    }
+    {
+        auto inputs = make_tables(tables, keys_per_table, key_space);
+        auto start = Clock::now();
+        OpenAddressTable result;
+        for (auto& input : inputs) {
+            result.merge_from(std::move(input), add);
+        }
+        report("merge_from", seconds_since(start), entries, result.size());
+    }
+    {
+        auto inputs = make_tables(tables, keys_per_table, key_space);
+        auto start = Clock::now();
+        OpenAddressTable result;
+        merge_parallel(result, std::move(inputs), add, threads);
+        report("merge_parallel", seconds_since(start), entries, result.size());
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+#include "table.cpp"
+
+// merges many tables into one on several threads. the result's slot array is
+// split into one home range per thread and built from scratch:
+//   scatter: each thread walks a contiguous share of the inputs, in input
+//            order, and buckets every entry by the range its final home is in
+//   place:   each thread takes one range, counting-sorts it by home, folds
+//            duplicate keys with fn in input order and writes the survivors
+//            straight into their slots, as robin-hood would have left them
+// entries that would run past the end of their range are set aside and inserted
+// normally at the end; at the default load there are a handful per range.
+
+struct MergeItem {
+    uint64_t key_;
+    uint64_t val_;
+    uint64_t home_;
+};
+
+// below this many entries in total, threads cost more than they save
+static constexpr size_t PARALLEL_MERGE_MIN_ENTRIES = 1 << 16;
+// slots of one input a scatter thread takes at a time
+static constexpr size_t PARALLEL_MERGE_UNIT_SLOTS = 1 << 16;
+
+// folds inputs into target in order: for a key in several tables, fn(key,
+// value so far, next value) decides. fn is called from several threads at
+// once. threads = 0 uses every hardware thread
+template <typename Fn>
+void merge_parallel(OpenAddressTable& target, std::vector<OpenAddressTable>&& inputs, Fn fn, size_t threads = 0) {
+    size_t total = target.size();
+    for (const auto& input : inputs) {
+        total += input.size();
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threads == 1 || total < PARALLEL_MERGE_MIN_ENTRIES) {
+        for (auto& input : inputs) {
+            target.merge_from(std::move(input), fn);
+        }
+        inputs.clear();
+        return;
+    }
+
+    // the capacity reserve() would pick for every entry, as if no key repeated
+    size_t capacity = 16;
+    while (total > capacity * OpenAddressTable::LOAD_FACTOR_THRESHOLD) {
+        capacity *= 2;
+    }
+    const size_t mask = capacity - 1;
+    auto range_of = [&](uint64_t home) { return static_cast<size_t>(home * threads / capacity); };
+    auto range_begin = [&](size_t range) { return (capacity * range + threads - 1) / threads; };
+
+    struct Unit {
+        const OpenAddressTable* table_;
+        size_t begin_;
+        size_t end_;
+    };
+    std::vector<Unit> units;
+    std::vector<const OpenAddressTable*> sources{&target};
+    for (const auto& input : inputs) {
+        sources.push_back(&input);
+    }
+    for (const OpenAddressTable* table : sources) {
+        if (table->size() == 0) continue;
+        for (size_t begin = 0; begin < table->capacity(); begin += PARALLEL_MERGE_UNIT_SLOTS) {
+            units.push_back({table, begin, std::min(table->capacity(), begin + PARALLEL_MERGE_UNIT_SLOTS)});
+        }
+    }
+
+    std::vector<std::exception_ptr> errors(threads);
+    auto run = [&](auto body) {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                try {
+                    body(t);
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    };
+
+    // buckets[t][r]: what scatter thread t found for range r, in input order
+    std::vector<std::vector<std::vector<MergeItem>>> buckets(threads, std::vector<std::vector<MergeItem>>(threads));
+    run([&](size_t t) {
+        for (size_t u = units.size() * t / threads; u < units.size() * (t + 1) / threads; ++u) {
+            const Unit& unit = units[u];
+            for (size_t i = unit.begin_; i < unit.end_; ++i) {
+                const Entry& entry = unit.table_->data_[i];
+                if (entry.status_ != 2) continue;
+                const uint64_t home = OpenAddressTable::hash_key(entry.key_) & mask;
+                buckets[t][range_of(home)].push_back({entry.key_, entry.val_, home});
+            }
+        }
+    });
+
+    std::vector<Entry> data(capacity, Entry{0, 0, 0, 0});
+    std::vector<size_t> placed(threads, 0);
+    std::vector<std::vector<MergeItem>> overflow(threads);
+    run([&](size_t r) {
+        const size_t begin = range_begin(r);
+        const size_t end = range_begin(r + 1);
+
+        // counting sort by home; stable, so a key's values stay in input order
+        std::vector<uint32_t> starts(end - begin + 1, 0);
+        size_t count = 0;
+        for (size_t t = 0; t < threads; ++t) {
+            for (const MergeItem& item : buckets[t][r]) {
+                ++starts[item.home_ - begin + 1];
+            }
+            count += buckets[t][r].size();
+        }
+        for (size_t i = 1; i < starts.size(); ++i) {
+            starts[i] += starts[i - 1];
+        }
+        std::vector<MergeItem> items(count);
+        for (size_t t = 0; t < threads; ++t) {
+            for (const MergeItem& item : buckets[t][r]) {
+                items[starts[item.home_ - begin]++] = item;
+            }
+            std::vector<MergeItem>().swap(buckets[t][r]);
+        }
+
+        // equal keys share a home, so duplicates are folded within each home's
+        // run; a run is a few entries long
+        size_t pos = begin;
+        size_t kept = 0;
+        for (size_t first = 0; first < count;) {
+            size_t last = first;
+            while (last < count && items[last].home_ == items[first].home_) {
+                ++last;
+            }
+            const size_t run_start = kept;
+            for (size_t i = first; i < last; ++i) {
+                size_t j = run_start;
+                while (j < kept && items[j].key_ != items[i].key_) {
+                    ++j;
+                }
+                if (j < kept) {
+                    items[j].val_ = fn(items[i].key_, items[j].val_, items[i].val_);
+                } else {
+                    items[kept++] = items[i];
+                }
+            }
+            first = last;
+        }
+
+        for (size_t i = 0; i < kept; ++i) {
+            const MergeItem& item = items[i];
+            pos = std::max<size_t>(pos, item.home_);
+            if (pos >= end) {
+                overflow[r].push_back(item);
+                continue;
+            }
+            data[pos] = Entry{item.key_, item.val_, static_cast<uint16_t>(pos - item.home_), 2};
+            ++pos;
+            ++placed[r];
+        }
+    });
+
+    inputs.clear();
+    target.data_ = std::move(data);
+    target.size_ = 0;
+    target.tombstone_ct_ = 0;
+    for (size_t count : placed) {
+        target.size_ += count;
+    }
+    // the set-aside tails, in range order; robin-hood insertion shifts them into
+    // the next range as far as it has to
+    for (const auto& items : overflow) {
+        for (const MergeItem& item : items) {
+            target.insert_at(item.home_, item.key_, item.val_);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <unordered_map>
+#include "parallel_merge.cpp"
+
+// the result records the order values were folded in, so input order is checked too
+static uint64_t fold(uint64_t, uint64_t so_far, uint64_t next) {
+    return so_far * 10 + next;
+}
+
+static std::vector<OpenAddressTable> partial_tables(size_t count, size_t keys_each, uint64_t key_space,
+                                                    std::unordered_map<uint64_t, uint64_t>& expected,
+                                                    OpenAddressTable* seed = nullptr) {
+    std::mt19937_64 gen(42);
+    std::vector<OpenAddressTable> tables(count);
+    if (seed != nullptr) {
+        for (const auto& entry : seed->data_) {
+            if (entry.status_ == 2) expected[entry.key_] = entry.val_;
+        }
+    }
+    for (size_t t = 0; t < count; t++) {
+        for (size_t i = 0; i < keys_each; i++) {
+            const uint64_t key = gen() % key_space;
+            const uint64_t val = t % 9 + 1;
+            if (tables[t].get(key)) continue;
+            tables[t].insert(key, val);
+            auto it = expected.find(key);
+            if (it == expected.end()) expected[key] = val;
+            else it->second = fold(key, it->second, val);
+        }
+    }
+    return tables;
+}
+
+static void expect_matches(OpenAddressTable& table, const std::unordered_map<uint64_t, uint64_t>& expected) {
+    EXPECT_EQ(table.size(), expected.size());
+    EXPECT_LE(table.load_factor(), OpenAddressTable::LOAD_FACTOR_THRESHOLD);
+    for (const auto& [key, val] : expected) {
+        ASSERT_EQ(table.get(key), std::optional<uint64_t>(val));
+    }
+    // probe distances the placement wrote must agree with where entries sit
+    const size_t mask = table.capacity() - 1;
+    for (size_t i = 0; i < table.capacity(); i++) {
+        const Entry& entry = table.data_[i];
+        if (entry.status_ == 2) {
+            ASSERT_EQ(entry.probe_dist_, (i - OpenAddressTable::hash_key(entry.key_)) & mask);
+        }
+    }
+}
+
+TEST(ParallelMergeTest, MatchesSequentialFoldInInputOrder) {
+    for (size_t threads : {size_t(2), size_t(3), size_t(8)}) {
+        std::unordered_map<uint64_t, uint64_t> expected;
+        OpenAddressTable target;
+        for (uint64_t key = 0; key < 20000; key++) {
+            target.insert(key * 13, 7);
+        }
+        auto inputs = partial_tables(12, 15000, 400000, expected, &target);
+
+        merge_parallel(target, std::move(inputs), fold, threads);
+        EXPECT_TRUE(inputs.empty());
+        expect_matches(target, expected);
+    }
+}
+
+TEST(ParallelMergeTest, DenseKeysSpillAcrossRanges) {
+    // many keys per home range at full load, so some runs cross into the next range
+    std::unordered_map<uint64_t, uint64_t> expected;
+    auto inputs = partial_tables(4, 40000, 1 << 30, expected);
+    OpenAddressTable target;
+    merge_parallel(target, std::move(inputs), fold, 16);
+    expect_matches(target, expected);
+}
+
+TEST(ParallelMergeTest, SmallInputsMergeSequentially) {
+    std::unordered_map<uint64_t, uint64_t> expected;
+    auto inputs = partial_tables(5, 100, 300, expected);
+    OpenAddressTable target;
+    merge_parallel(target, std::move(inputs), fold, 4);
+    expect_matches(target, expected);
+}
@@ -0,0 +1,221 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "table.cpp"
+
+// isolated timings for the building blocks of OpenAddressTable, so a regression
+// in the end-to-end benchmark can be pinned on one of them.
+//
+// benchmarks taking a cold arg run hot (0, everything touched is already in
+// l1/l2) or cold (1, the slots involved are flushed before every timed op).
+// cold runs time a single op per iteration with manual timing, pausing the
+// benchmark timer per op costs more than the ops themselves.
+
+enum CacheState { HOT = 0, COLD = 1 };
+
+static void evict(const void* p, size_t bytes) {
+#if defined(__x86_64__) || defined(__i386__)
+    const char* c = static_cast<const char*>(p);
+    for (size_t i = 0; i < bytes; i += OpenAddressTable::CACHE_LINE_SIZE) {
+        _mm_clflush(c + i);
+    }
+    _mm_mfence();
+#else
+    // no portable flush, stream through a buffer bigger than the last level cache instead
+    static std::vector<char> scratch(256 << 20);
+    for (size_t i = 0; i < scratch.size(); i += 64) {
+        scratch[i]++;
+    }
+    benchmark::DoNotOptimize(scratch.data());
+    (void)p;
+    (void)bytes;
+#endif
+}
+
+template <typename F>
+static double time_seconds(F&& f) {
+    auto start = std::chrono::high_resolution_clock::now();
+    f();
+    auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+// brute-forces `count` keys whose home slot in a table of `capacity` is `home`
+static std::vector<uint64_t> keys_with_home(size_t capacity, size_t home, size_t count, uint64_t& next) {
+    std::vector<uint64_t> keys;
+    while (keys.size() < count) {
+        if ((OpenAddressTable::hash_key(next) & (capacity - 1)) == home) {
+            keys.push_back(next);
+        }
+        ++next;
+    }
+    return keys;
+}
+
+static void BM_Primitive_HashKey(benchmark::State& state) {
+    std::vector<uint64_t> keys(4096);
+    std::mt19937_64 generator(42);
+    for (auto& key : keys) key = generator();
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(OpenAddressTable::hash_key(keys[i++ & (keys.size() - 1)]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_Primitive_NextProbePosition_Hot(benchmark::State& state) {
+    const size_t capacity = 1 << 10;
+    OpenAddressTable hashmap(capacity);
+    size_t pos = 0;
+
+    for (auto _ : state) {
+        pos = hashmap.next_probe_position(pos);
+        benchmark::DoNotOptimize(pos);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_Primitive_NextProbePosition_Cold(benchmark::State& state) {
+    const size_t capacity = 1 << 22;
+    OpenAddressTable hashmap(capacity);
+    size_t pos = 0;
+
+    for (auto _ : state) {
+        // flush the line the step lands on plus the lines its prefetch would pull
+        // in, masked the same way next_probe_position masks them
+        const size_t next_pos = (pos + 1) & (capacity - 1);
+        evict(&hashmap.data_[next_pos], sizeof(Entry));
+        for (size_t i = 1; i <= OpenAddressTable::PREFETCH_DISTANCE; ++i) {
+            evict(&hashmap.data_[(next_pos + i * OpenAddressTable::CACHE_LINE_SIZE) & (capacity - 1)], sizeof(Entry));
+        }
+        state.SetIterationTime(time_seconds([&] {
+            pos = hashmap.next_probe_position(pos);
+            benchmark::DoNotOptimize(hashmap.data_[pos].status_);
+        }));
+        // land just before a cache line boundary so every step exercises the prefetch branch
+        pos = (pos + OpenAddressTable::ENTRIES_PER_CACHE_LINE * 97 - 1) & (capacity - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// range(0): cache state, range(1): length k of the run an insert has to swap its way through
+static void BM_Primitive_RobinHoodSwapChain(benchmark::State& state) {
+    const size_t capacity = 1 << 16;
+    const size_t k = state.range(1);
+    const size_t home = capacity / 2;
+    uint64_t next = 0;
+
+    // one resident per slot at distance 0, so a newcomer homed at `home` swaps at every step after the first
+    OpenAddressTable pristine(capacity);
+    for (size_t i = 0; i < k; ++i) {
+        pristine.insert(keys_with_home(capacity, home + i, 1, next)[0], i);
+    }
+    const uint64_t newcomer = keys_with_home(capacity, home, 1, next)[0];
+
+    OpenAddressTable hashmap = pristine;
+    for (auto _ : state) {
+        std::copy(pristine.data_.begin() + home, pristine.data_.begin() + home + k + 1, hashmap.data_.begin() + home);
+        hashmap.size_ = pristine.size_;
+        if (state.range(0) == COLD) {
+            evict(&hashmap.data_[home], (k + 1) * sizeof(Entry));
+        }
+        state.SetIterationTime(time_seconds([&] {
+            hashmap.insert(newcomer, 0);
+        }));
+    }
+    state.counters["run_length"] = static_cast<double>(k);
+}
+
+// range(0): cache state, range(1): length k of the run shifted back by one erase
+static void BM_Primitive_BackwardShift(benchmark::State& state) {
+    const size_t capacity = 1 << 16;
+    const size_t k = state.range(1);
+    const size_t home = capacity / 2;
+    uint64_t next = 0;
+
+    // k keys sharing one home slot, erasing the first shifts the other k - 1
+    auto keys = keys_with_home(capacity, home, k, next);
+    OpenAddressTable pristine(capacity);
+    for (size_t i = 0; i < k; ++i) {
+        pristine.insert(keys[i], i);
+    }
+    const uint64_t victim = pristine.data_[home].key_;
+
+    OpenAddressTable hashmap = pristine;
+    for (auto _ : state) {
+        std::copy(pristine.data_.begin() + home, pristine.data_.begin() + home + k + 1, hashmap.data_.begin() + home);
+        hashmap.size_ = pristine.size_;
+        if (state.range(0) == COLD) {
+            evict(&hashmap.data_[home], (k + 1) * sizeof(Entry));
+        }
+        state.SetIterationTime(time_seconds([&] {
+            hashmap.erase(victim);
+        }));
+    }
+    state.counters["run_length"] = static_cast<double>(k);
+}
+
+// range(0): cache state. hot rehashes into an l1-sized array, cold into a flushed 512 MiB one
+static void BM_Primitive_InsertDuringResize(benchmark::State& state) {
+    const size_t batch = 1024;
+    const size_t capacity = state.range(0) == HOT ? 2 * batch : size_t(1) << 24;
+
+    OpenAddressTable hashmap(16);
+    std::vector<Entry> new_data(capacity);
+    std::vector<uint64_t> keys(batch);
+    std::mt19937_64 generator(42);
+
+    for (auto _ : state) {
+        for (auto& key : keys) key = generator();
+        if (state.range(0) == COLD) {
+            for (auto key : keys) {
+                evict(&new_data[OpenAddressTable::hash_key(key) & (capacity - 1)], OpenAddressTable::CACHE_LINE_SIZE);
+            }
+        }
+
+        state.SetIterationTime(time_seconds([&] {
+            for (auto key : keys) {
+                hashmap.insert_during_resize(new_data, key, key);
+            }
+        }));
+        benchmark::DoNotOptimize(new_data.data());
+
+        // clear every run this batch created so the array never fills up across iterations
+        for (auto key : keys) {
+            for (size_t pos = OpenAddressTable::hash_key(key) & (capacity - 1);
+                 new_data[pos].status_ != 0; pos = (pos + 1) & (capacity - 1)) {
+                new_data[pos] = Entry{0, 0, 0, 0};
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+BENCHMARK(BM_Primitive_HashKey);
+
+BENCHMARK(BM_Primitive_NextProbePosition_Hot);
+
+BENCHMARK(BM_Primitive_NextProbePosition_Cold)->UseManualTime();
+
+BENCHMARK(BM_Primitive_RobinHoodSwapChain)
+        ->ArgNames({"cold", "k"})
+        ->ArgsProduct({{HOT, COLD}, {1, 4, 16, 64}})
+        ->UseManualTime();
+
+BENCHMARK(BM_Primitive_BackwardShift)
+        ->ArgNames({"cold", "k"})
+        ->ArgsProduct({{HOT, COLD}, {1, 4, 16, 64}})
+        ->UseManualTime();
+
+BENCHMARK(BM_Primitive_InsertDuringResize)
+        ->ArgName("cold")
+        ->Arg(HOT)
+        ->Arg(COLD)
+        ->UseManualTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,471 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "xxhash/xxhash.h"
+
+// reference hash tables used to measure what robin-hood buys OpenAddressTable.
+// each one is the textbook version of its scheme, not a tuned competitor, and
+// exposes the OpenAddressTable call surface:
+//   explicit T(size_t initial_size = 64)
+//   bool insert(key, val)              inserts or updates, always true
+//   std::optional<uint64_t> get(key)
+//   bool erase(key)
+//   size(), empty(), capacity(), load_factor()
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 16;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// linear or quadratic (triangular) probing with tombstones. no displacement
+// bookkeeping, a miss only stops at a truly empty slot
+template <bool Quadratic>
+class ProbingTable {
+public:
+    struct Slot {
+        uint64_t key_;
+        uint64_t val_;
+        uint8_t status_;
+        // 0 for empty, 1 for deleted, 2 for filled
+    };
+
+    // tombstones count towards the load, they lengthen probes just like live entries
+    static constexpr double LOAD_FACTOR_THRESHOLD = 0.75;
+
+    explicit ProbingTable(size_t initial_size = 64)
+            : data_(round_up_pow2(initial_size), Slot{0, 0, 0}), size_(0), tombstone_ct_(0) {}
+
+    static size_t hash_key(uint64_t key) {
+        return XXH64(&key, sizeof(key), 0);
+    }
+
+    bool insert(uint64_t key, uint64_t val) {
+        if (static_cast<double>(size_ + tombstone_ct_ + 1) > data_.size() * LOAD_FACTOR_THRESHOLD) {
+            // only grow when live entries need the room, otherwise just sweep the tombstones
+            rehash(size_ + 1 > data_.size() / 2 ? data_.size() * 2 : data_.size());
+        }
+
+        const size_t mask = data_.size() - 1;
+        size_t pos = hash_key(key) & mask;
+        size_t first_deleted = SIZE_MAX;
+
+        for (size_t i = 1; ; ++i) {
+            Slot& slot = data_[pos];
+            if (slot.status_ == 0) {
+                if (first_deleted != SIZE_MAX) {
+                    data_[first_deleted] = Slot{key, val, 2};
+                    --tombstone_ct_;
+                } else {
+                    slot = Slot{key, val, 2};
+                }
+                ++size_;
+                return true;
+            }
+            if (slot.status_ == 2 && slot.key_ == key) {
+                slot.val_ = val;
+                return true;
+            }
+            if (slot.status_ == 1 && first_deleted == SIZE_MAX) {
+                first_deleted = pos;
+            }
+            pos = next(pos, i, mask);
+        }
+    }
+
+    std::optional<uint64_t> get(uint64_t key) const {
+        const size_t pos = find(key);
+        if (pos == SIZE_MAX) {
+            return std::nullopt;
+        }
+        return data_[pos].val_;
+    }
+
+    bool erase(uint64_t key) {
+        const size_t pos = find(key);
+        if (pos == SIZE_MAX) {
+            return false;
+        }
+        data_[pos].status_ = 1;
+        --size_;
+        ++tombstone_ct_;
+        return true;
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t capacity() const { return data_.size(); }
+
+    double load_factor() const { return static_cast<double>(size_) / data_.size(); }
+
+private:
+    std::vector<Slot> data_;
+    size_t size_;
+    size_t tombstone_ct_;
+
+    // triangular steps visit every slot of a power-of-two table exactly once
+    static size_t next(size_t pos, size_t step, size_t mask) {
+        return (pos + (Quadratic ? step : 1)) & mask;
+    }
+
+    size_t find(uint64_t key) const {
+        const size_t mask = data_.size() - 1;
+        size_t pos = hash_key(key) & mask;
+
+        for (size_t i = 1; i <= data_.size(); ++i) {
+            const Slot& slot = data_[pos];
+            if (slot.status_ == 0) {
+                return SIZE_MAX;
+            }
+            if (slot.status_ == 2 && slot.key_ == key) {
+                return pos;
+            }
+            pos = next(pos, i, mask);
+        }
+        return SIZE_MAX;
+    }
+
+    void rehash(size_t new_size) {
+        std::vector<Slot> old = std::move(data_);
+        data_.assign(new_size, Slot{0, 0, 0});
+        size_ = 0;
+        tombstone_ct_ = 0;
+        for (const auto& slot : old) {
+            if (slot.status_ == 2) {
+                insert(slot.key_, slot.val_);
+            }
+        }
+    }
+};
+
+using LinearProbingTable = ProbingTable<false>;
+using QuadraticProbingTable = ProbingTable<true>;
+
+// classic two-choice cuckoo hashing, one slot per bucket. every key lives in one
+// of its two candidate slots so lookups touch at most two lines, inserts pay for
+// it with eviction chains and a low usable load factor
+class CuckooTable {
+public:
+    struct Slot {
+        uint64_t key_;
+        uint64_t val_;
+        uint8_t status_;
+        // 0 for empty, 2 for filled
+    };
+
+    // single-slot buckets start failing inserts a little below 0.5
+    static constexpr double LOAD_FACTOR_THRESHOLD = 0.45;
+    static constexpr size_t MAX_KICKS = 500;
+
+    explicit CuckooTable(size_t initial_size = 64)
+            : data_(round_up_pow2(initial_size), Slot{0, 0, 0}), size_(0) {}
+
+    static size_t hash_key(uint64_t key, size_t which) {
+        return XXH64(&key, sizeof(key), which == 0 ? 0 : 0x9e3779b97f4a7c15ULL);
+    }
+
+    bool insert(uint64_t key, uint64_t val) {
+        const size_t pos = find(key);
+        if (pos != SIZE_MAX) {
+            data_[pos].val_ = val;
+            return true;
+        }
+
+        if (static_cast<double>(size_ + 1) > data_.size() * LOAD_FACTOR_THRESHOLD) {
+            rehash(data_.size() * 2);
+        }
+        Slot carry{key, val, 2};
+        while (!place(carry)) {
+            rehash(data_.size() * 2);
+        }
+        ++size_;
+        return true;
+    }
+
+    std::optional<uint64_t> get(uint64_t key) const {
+        const size_t pos = find(key);
+        if (pos == SIZE_MAX) {
+            return std::nullopt;
+        }
+        return data_[pos].val_;
+    }
+
+    bool erase(uint64_t key) {
+        const size_t pos = find(key);
+        if (pos == SIZE_MAX) {
+            return false;
+        }
+        data_[pos].status_ = 0;
+        --size_;
+        return true;
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t capacity() const { return data_.size(); }
+
+    double load_factor() const { return static_cast<double>(size_) / data_.size(); }
+
+private:
+    std::vector<Slot> data_;
+    size_t size_;
+
+    size_t find(uint64_t key) const {
+        const size_t mask = data_.size() - 1;
+        const size_t a = hash_key(key, 0) & mask;
+        if (data_[a].status_ == 2 && data_[a].key_ == key) return a;
+        const size_t b = hash_key(key, 1) & mask;
+        if (data_[b].status_ == 2 && data_[b].key_ == key) return b;
+        return SIZE_MAX;
+    }
+
+    // on failure `carry` holds whichever entry was left homeless
+    bool place(Slot& carry) {
+        const size_t mask = data_.size() - 1;
+        size_t pos = hash_key(carry.key_, 0) & mask;
+
+        for (size_t kick = 0; kick < MAX_KICKS; ++kick) {
+            if (data_[pos].status_ == 0) {
+                data_[pos] = carry;
+                return true;
+            }
+            std::swap(carry, data_[pos]);
+            // send the evicted entry to its other candidate
+            const size_t first = hash_key(carry.key_, 0) & mask;
+            pos = pos == first ? hash_key(carry.key_, 1) & mask : first;
+        }
+        return false;
+    }
+
+    void rehash(size_t new_size) {
+        std::vector<Slot> items;
+        items.reserve(size_);
+        for (const auto& slot : data_) {
+            if (slot.status_ == 2) {
+                items.push_back(slot);
+            }
+        }
+
+        // a failed placement scrambles the attempt, rebuild from the saved entries one size up
+        for (;; new_size *= 2) {
+            data_.assign(new_size, Slot{0, 0, 0});
+            bool placed_all = true;
+            for (auto item : items) {
+                if (!place(item)) {
+                    placed_all = false;
+                    break;
+                }
+            }
+            if (placed_all) {
+                return;
+            }
+        }
+    }
+};
+
+// swiss-table-style layout: a separate array of one control byte per slot,
+// 7 bits of hash for live entries, probed 16 at a time so one compare rules
+// out most of a group without touching the slots
+class SwissTable {
+public:
+    struct Slot {
+        uint64_t key_;
+        uint64_t val_;
+    };
+
+    static constexpr size_t GROUP_SIZE = 16;
+    static constexpr int8_t CTRL_EMPTY = -128;
+    static constexpr int8_t CTRL_DELETED = -2;
+    static constexpr double LOAD_FACTOR_THRESHOLD = 0.875;
+
+    explicit SwissTable(size_t initial_size = 64) : size_(0), tombstone_ct_(0) {
+        allocate(round_up_pow2(initial_size));
+    }
+
+    static size_t hash_key(uint64_t key) {
+        return XXH64(&key, sizeof(key), 0);
+    }
+
+    bool insert(uint64_t key, uint64_t val) {
+        const size_t hash = hash_key(key);
+        const size_t pos = find(key, hash);
+        if (pos != SIZE_MAX) {
+            slots_[pos].val_ = val;
+            return true;
+        }
+
+        if (static_cast<double>(size_ + tombstone_ct_ + 1) > slots_.size() * LOAD_FACTOR_THRESHOLD) {
+            rehash(size_ + 1 > slots_.size() / 2 ? slots_.size() * 2 : slots_.size());
+        }
+
+        const size_t groups_mask = slots_.size() / GROUP_SIZE - 1;
+        size_t group = h1(hash) & groups_mask;
+        for (size_t step = 1; ; ++step) {
+            uint32_t free = match_free(group);
+            if (free != 0) {
+                const size_t i = group * GROUP_SIZE + __builtin_ctz(free);
+                tombstone_ct_ -= ctrl_[i] == CTRL_DELETED;
+                ctrl_[i] = h2(hash);
+                slots_[i] = Slot{key, val};
+                ++size_;
+                return true;
+            }
+            group = (group + step) & groups_mask;
+        }
+    }
+
+    std::optional<uint64_t> get(uint64_t key) const {
+        const size_t pos = find(key, hash_key(key));
+        if (pos == SIZE_MAX) {
+            return std::nullopt;
+        }
+        return slots_[pos].val_;
+    }
+
+    bool erase(uint64_t key) {
+        const size_t pos = find(key, hash_key(key));
+        if (pos == SIZE_MAX) {
+            return false;
+        }
+        // a group that still has an empty byte was never full, so no probe sequence
+        // runs through it and the slot can go straight back to empty
+        const size_t group = pos / GROUP_SIZE;
+        if (match(group, CTRL_EMPTY) != 0) {
+            ctrl_[pos] = CTRL_EMPTY;
+        } else {
+            ctrl_[pos] = CTRL_DELETED;
+            ++tombstone_ct_;
+        }
+        --size_;
+        return true;
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t capacity() const { return slots_.size(); }
+
+    double load_factor() const { return static_cast<double>(size_) / slots_.size(); }
+
+private:
+    std::vector<int8_t> ctrl_;
+    std::vector<Slot> slots_;
+    size_t size_;
+    size_t tombstone_ct_;
+
+    static size_t h1(size_t hash) { return hash >> 7; }
+
+    static int8_t h2(size_t hash) { return static_cast<int8_t>(hash & 0x7f); }
+
+    void allocate(size_t n) {
+        ctrl_.assign(n, CTRL_EMPTY);
+        slots_.assign(n, Slot{0, 0});
+    }
+
+    // bit i set when control byte i of the group equals `value`
+    uint32_t match(size_t group, int8_t value) const {
+        const int8_t* ctrl = &ctrl_[group * GROUP_SIZE];
+#if defined(__SSE2__)
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(value))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP_SIZE; ++i) {
+            mask |= static_cast<uint32_t>(ctrl[i] == value) << i;
+        }
+        return mask;
+#endif
+    }
+
+    // empty and deleted are the only control bytes with the top bit set
+    uint32_t match_free(size_t group) const {
+        const int8_t* ctrl = &ctrl_[group * GROUP_SIZE];
+#if defined(__SSE2__)
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+        return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < GROUP_SIZE; ++i) {
+            mask |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+        }
+        return mask;
+#endif
+    }
+
+    size_t find(uint64_t key, size_t hash) const {
+        const size_t groups_mask = slots_.size() / GROUP_SIZE - 1;
+        size_t group = h1(hash) & groups_mask;
+
+        for (size_t step = 1; step <= groups_mask + 1; ++step) {
+            for (uint32_t hits = match(group, h2(hash)); hits != 0; hits &= hits - 1) {
+                const size_t i = group * GROUP_SIZE + __builtin_ctz(hits);
+                if (slots_[i].key_ == key) {
+                    return i;
+                }
+            }
+            if (match(group, CTRL_EMPTY) != 0) {
+                return SIZE_MAX;
+            }
+            group = (group + step) & groups_mask;
+        }
+        return SIZE_MAX;
+    }
+
+    void rehash(size_t new_size) {
+        std::vector<int8_t> old_ctrl = std::move(ctrl_);
+        std::vector<Slot> old_slots = std::move(slots_);
+        allocate(new_size);
+        size_ = 0;
+        tombstone_ct_ = 0;
+        for (size_t i = 0; i < old_slots.size(); ++i) {
+            if (old_ctrl[i] >= 0) {
+                insert(old_slots[i].key_, old_slots[i].val_);
+            }
+        }
+    }
+};
+
+// std::unordered_map behind the same call surface
+class UnorderedMapTable {
+public:
+    explicit UnorderedMapTable(size_t initial_size = 64) {
+        map_.reserve(initial_size);
+    }
+
+    bool insert(uint64_t key, uint64_t val) {
+        map_[key] = val;
+        return true;
+    }
+
+    std::optional<uint64_t> get(uint64_t key) const {
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    bool erase(uint64_t key) { return map_.erase(key) > 0; }
+
+    size_t size() const { return map_.size(); }
+
+    bool empty() const { return map_.empty(); }
+
+    size_t capacity() const { return map_.bucket_count(); }
+
+    double load_factor() const { return map_.load_factor(); }
+
+private:
+    std::unordered_map<uint64_t, uint64_t> map_;
+};
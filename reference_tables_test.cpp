@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <unordered_map>
+#include "reference_tables.cpp"
+
+// the reference tables only matter if they are correct, so each one runs the
+// same randomized differential check against std::unordered_map
+
+template <typename Table>
+class ReferenceTableTest : public ::testing::Test {
+protected:
+    Table table{16};
+};
+
+using ReferenceTables = ::testing::Types<LinearProbingTable, QuadraticProbingTable, CuckooTable, SwissTable>;
+TYPED_TEST_SUITE(ReferenceTableTest, ReferenceTables);
+
+TYPED_TEST(ReferenceTableTest, BasicOperations) {
+    EXPECT_TRUE(this->table.empty());
+    EXPECT_FALSE(this->table.get(1).has_value());
+    EXPECT_FALSE(this->table.erase(1));
+
+    EXPECT_TRUE(this->table.insert(1, 100));
+    EXPECT_TRUE(this->table.insert(1, 200));
+    EXPECT_EQ(this->table.size(), 1);
+    EXPECT_EQ(this->table.get(1).value(), 200);
+
+    EXPECT_TRUE(this->table.erase(1));
+    EXPECT_TRUE(this->table.empty());
+    EXPECT_FALSE(this->table.get(1).has_value());
+}
+
+TYPED_TEST(ReferenceTableTest, MatchesUnorderedMap) {
+    std::mt19937_64 gen(42);
+    // a small keyspace so erases and re-inserts hit tombstones and evictions often
+    std::uniform_int_distribution<uint64_t> dis(0, 5000);
+    std::unordered_map<uint64_t, uint64_t> reference_map;
+
+    for (size_t i = 0; i < 50000; i++) {
+        uint64_t key = dis(gen);
+        switch (i % 3) {
+            case 0:
+                this->table.insert(key, i);
+                reference_map[key] = i;
+                break;
+            case 1: {
+                auto result = this->table.get(key);
+                auto it = reference_map.find(key);
+                ASSERT_EQ(result.has_value(), it != reference_map.end());
+                if (result.has_value()) {
+                    EXPECT_EQ(result.value(), it->second);
+                }
+                break;
+            }
+            case 2:
+                EXPECT_EQ(this->table.erase(key), reference_map.erase(key) > 0);
+                break;
+        }
+    }
+
+    EXPECT_EQ(this->table.size(), reference_map.size());
+    for (const auto& [key, value] : reference_map) {
+        EXPECT_EQ(this->table.get(key), std::optional<uint64_t>(value));
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// the protocol-independent middle of the server: parsers turn bytes into a
+// RequestBatch, execute_batch runs it against a table, and encoders turn the
+// results back into the same protocol's replies.
+
+enum class RequestOp : uint8_t { Get, MGet, Set, Del, Incr, Decr, Ping, Error };
+
+struct Request {
+    RequestOp op_;
+    // the request's keys are keys_[first_key_, first_key_ + key_count_)
+    uint32_t first_key_;
+    uint32_t key_count_;
+    // set: the value, incr / decr: the delta
+    uint64_t val_;
+    const char* error_;
+    // protocol-specific bits the encoder echoes back: opcode, quiet / noreply, opaque
+    uint8_t wire_op_ = 0;
+    uint8_t wire_flags_ = 0;
+    uint32_t opaque_ = 0;
+    // incr / decr: stored and returned as is when the key is missing
+    std::optional<uint64_t> initial_;
+};
+
+struct RequestBatch {
+    std::vector<Request> requests_;
+    std::vector<uint64_t> keys_;
+    // one answer per key: the value for reads, the new value for incr / decr,
+    // has_value() for a successful del
+    std::vector<std::optional<uint64_t>> results_;
+
+    void clear() {
+        requests_.clear();
+        keys_.clear();
+        results_.clear();
+    }
+
+    Request& add(RequestOp op, uint64_t key, uint64_t val = 0) {
+        requests_.push_back({op, static_cast<uint32_t>(keys_.size()), 1, val, nullptr});
+        keys_.push_back(key);
+        return requests_.back();
+    }
+
+    // a request over keys_[first, keys_.size()), for the multi-key commands
+    Request& add_multi(RequestOp op, size_t first) {
+        requests_.push_back({op, static_cast<uint32_t>(first), static_cast<uint32_t>(keys_.size() - first), 0,
+                             nullptr});
+        return requests_.back();
+    }
+
+    Request& add_error(const char* error) {
+        requests_.push_back({RequestOp::Error, static_cast<uint32_t>(keys_.size()), 0, 0, error});
+        return requests_.back();
+    }
+};
+
+// runs the batch in request order. consecutive reads are collected and looked up
+// together; a write flushes them first so a get never sees a later set
+template <typename Table>
+void execute_batch(RequestBatch& batch, Table& table) {
+    batch.results_.assign(batch.keys_.size(), std::nullopt);
+    size_t read_begin = 0;
+    size_t read_end = 0;
+
+    auto flush_reads = [&] {
+        if (read_end > read_begin) {
+            table.get_batch(&batch.keys_[read_begin], read_end - read_begin, &batch.results_[read_begin]);
+        }
+    };
+
+    for (const auto& request : batch.requests_) {
+        const size_t first = request.first_key_;
+        const size_t last = first + request.key_count_;
+
+        switch (request.op_) {
+            case RequestOp::Get:
+            case RequestOp::MGet:
+                if (read_end != first) {
+                    flush_reads();
+                    read_begin = first;
+                }
+                read_end = last;
+                break;
+            case RequestOp::Set:
+                flush_reads();
+                read_begin = read_end = last;
+                table.insert(batch.keys_[first], request.val_);
+                break;
+            case RequestOp::Del:
+                flush_reads();
+                read_begin = read_end = last;
+                for (size_t i = first; i < last; ++i) {
+                    if (table.erase(batch.keys_[i])) {
+                        batch.results_[i] = 1;
+                    }
+                }
+                break;
+            case RequestOp::Incr:
+            case RequestOp::Decr: {
+                flush_reads();
+                read_begin = read_end = last;
+                if (request.key_count_ == 0) {
+                    break;
+                }
+                const uint64_t delta = request.val_;
+                const bool incr = request.op_ == RequestOp::Incr;
+                // memcached semantics: incr wraps at 2^64, decr stops at 0
+                batch.results_[first] = table.update(batch.keys_[first], [&](uint64_t val) {
+                    return incr ? val + delta : val - std::min(val, delta);
+                }, request.initial_);
+                break;
+            }
+            case RequestOp::Ping:
+            case RequestOp::Error:
+                break;
+        }
+    }
+    flush_reads();
+}
+
+// returned by the parsers when the stream cannot be resynchronised; whatever was
+// parsed before the bad bytes is still answered, then the connection closes
+static constexpr size_t PARSE_ERROR = SIZE_MAX;
+
+inline bool parse_u64(std::string_view text, uint64_t& out) {
+    if (text.empty()) {
+        return false;
+    }
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+    return ec == std::errc() && end == text.data() + text.size();
+}
@@ -0,0 +1,159 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "table.cpp"
+
+// fills a table to one insert short of LOAD_FACTOR_THRESHOLD, so the next insert resizes
+static void fill_to_threshold(OpenAddressTable& hashmap, std::mt19937_64& generator) {
+    const size_t limit = static_cast<size_t>(hashmap.capacity() * OpenAddressTable::LOAD_FACTOR_THRESHOLD);
+    while (hashmap.size() + 1 < limit) {
+        hashmap.insert(generator(), 0);
+    }
+}
+
+static void report_resize(benchmark::State& state, size_t old_capacity, size_t entries) {
+    state.counters["old_capacity"] = static_cast<double>(old_capacity);
+    state.counters["entries"] = static_cast<double>(entries);
+    // old and new arrays are both alive for the whole rehash
+    state.counters["peak_bytes"] = static_cast<double>(3 * old_capacity * sizeof(Entry));
+    state.counters["ns_per_entry"] = benchmark::Counter(
+            static_cast<double>(entries), benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+// range(0): capacity before the doubling
+static void BM_Resize_Doubling(benchmark::State& state) {
+    const size_t capacity = state.range(0);
+    size_t entries = 0;
+
+    // declared outside the loop so tearing down the grown table happens while timing is paused
+    OpenAddressTable hashmap;
+    for (auto _ : state) {
+        state.PauseTiming();
+        hashmap = OpenAddressTable(capacity);
+        std::mt19937_64 generator(42);
+        fill_to_threshold(hashmap, generator);
+        entries = hashmap.size();
+        state.ResumeTiming();
+
+        hashmap.resize();
+        benchmark::DoNotOptimize(hashmap.data_.data());
+    }
+
+    report_resize(state, capacity, entries);
+}
+
+// the rehash loop alone, allocating and zeroing the new array is left outside the timed region
+static void BM_Resize_InsertDuringResize(benchmark::State& state) {
+    const size_t capacity = state.range(0);
+    size_t entries = 0;
+
+    // declared outside the loop so tearing down the grown table happens while timing is paused
+    OpenAddressTable hashmap;
+    std::vector<Entry> new_data;
+    for (auto _ : state) {
+        state.PauseTiming();
+        hashmap = OpenAddressTable(capacity);
+        std::mt19937_64 generator(42);
+        fill_to_threshold(hashmap, generator);
+        entries = hashmap.size();
+        new_data = std::vector<Entry>(capacity * 2);
+        // insert_during_resize recounts size_ as it goes
+        hashmap.size_ = 0;
+        state.ResumeTiming();
+
+        for (const auto& entry : hashmap.data_) {
+            if (entry.status_ == 2) {
+                hashmap.insert_during_resize(new_data, entry.key_, entry.val_);
+            }
+        }
+        benchmark::DoNotOptimize(new_data.data());
+    }
+
+    report_resize(state, capacity, entries);
+}
+
+// latency of the one insert that crosses the threshold, next to an ordinary insert into the same table
+static void BM_Resize_TriggeringInsert(benchmark::State& state) {
+    const size_t capacity = state.range(0);
+    double ordinary_ns = 0;
+
+    // declared outside the loop so tearing down the grown table happens while timing is paused
+    OpenAddressTable hashmap;
+    for (auto _ : state) {
+        state.PauseTiming();
+        hashmap = OpenAddressTable(capacity);
+        std::mt19937_64 generator(42);
+        fill_to_threshold(hashmap, generator);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        hashmap.insert(generator(), 0);
+        auto stop = std::chrono::high_resolution_clock::now();
+        ordinary_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+        state.ResumeTiming();
+
+        // the ordinary insert above took the last slot below the threshold
+        hashmap.insert(generator(), 0);
+        benchmark::DoNotOptimize(hashmap.data_.data());
+    }
+
+    // the benchmark's own time column is the triggering insert
+    state.counters["ordinary_insert_ns"] = benchmark::Counter(
+            ordinary_ns, benchmark::Counter::kAvgIterations);
+    state.counters["old_capacity"] = static_cast<double>(capacity);
+}
+
+// grows a default table to range(0) entries and splits the time between resizes and everything else
+static void BM_Resize_GrowthProfile(benchmark::State& state) {
+    const size_t count = state.range(0);
+    double resize_ns = 0;
+    double max_insert_ns = 0;
+    double doublings = 0;
+
+    for (auto _ : state) {
+        OpenAddressTable hashmap;
+        std::mt19937_64 generator(42);
+
+        for (size_t i = 0; i < count; ++i) {
+            const size_t capacity = hashmap.capacity();
+            auto start = std::chrono::high_resolution_clock::now();
+            hashmap.insert(generator(), 0);
+            auto stop = std::chrono::high_resolution_clock::now();
+
+            if (hashmap.capacity() != capacity) {
+                double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+                resize_ns += ns;
+                max_insert_ns = std::max(max_insert_ns, ns);
+                doublings += 1;
+            }
+        }
+        benchmark::DoNotOptimize(hashmap.data_.data());
+    }
+
+    state.counters["resize_ns"] = benchmark::Counter(resize_ns, benchmark::Counter::kAvgIterations);
+    state.counters["doublings"] = benchmark::Counter(doublings, benchmark::Counter::kAvgIterations);
+    state.counters["max_insert_ns"] = max_insert_ns;
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+BENCHMARK(BM_Resize_Doubling)
+        ->RangeMultiplier(4)
+        ->Range(1 << 10, 1 << 24)
+        ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_Resize_InsertDuringResize)
+        ->RangeMultiplier(4)
+        ->Range(1 << 10, 1 << 24)
+        ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_Resize_TriggeringInsert)
+        ->RangeMultiplier(4)
+        ->Range(1 << 10, 1 << 24)
+        ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_Resize_GrowthProfile)
+        ->RangeMultiplier(10)
+        ->Range(10'000, 10'000'000)
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,182 @@
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include "table.cpp"
+#include "concurrent_table.cpp"
+#include "stats.cpp"
+#include "workload.cpp"
+
+// usage: scaling_benchmark [threads=N] [read=0.9] [theta=0.99] [keys=1000000] [ops=2000000] [pin=1]
+//
+// runs 1, 2, 4 .. N threads against each concurrent table. every thread draws
+// keys from the same zipfian keyspace (theta=0 for uniform), reads with
+// probability `read` and otherwise alternates insert/erase so the table holds
+// a steady size. `ops` is per thread.
+
+struct Config {
+    size_t threads = std::thread::hardware_concurrency();
+    double read_ratio = 0.9;
+    double theta = 0.99;
+    size_t keys = 1'000'000;
+    size_t ops = 2'000'000;
+    bool pin = true;
+};
+
+// time every 16th op, reading the clock on every op costs as much as the lookup
+const size_t LATENCY_SAMPLE_EVERY = 16;
+
+struct ThreadResult {
+    double seconds;
+    std::vector<double> latencies;
+};
+
+static void pin_to_cpu(size_t cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % std::thread::hardware_concurrency(), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+template <typename Table>
+void run_scaling(const Config& config, const std::string& label) {
+    std::cout << label << ":\n"
+              << std::setw(8) << "threads" << std::setw(12) << "Mops/s"
+              << std::setw(10) << "p50 ns" << std::setw(10) << "p99 ns"
+              << std::setw(11) << "p99.9 ns" << std::setw(12) << "worst p99" << "\n";
+
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < config.threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(config.threads);
+
+    for (size_t threads : thread_counts) {
+        Table table;
+        {
+            ZipfianGenerator keys(config.keys, 0);
+            for (size_t rank = 0; rank < config.keys; rank += 2) {
+                table.insert(keys.key_for_rank(rank), rank);
+            }
+        }
+
+        std::vector<ThreadResult> results(threads);
+        std::atomic<size_t> ready{0};
+        std::atomic<bool> go{false};
+        // every thread adds its lookup sum, so the lookups are not optimised away
+        std::atomic<uint64_t> checksum{0};
+        std::vector<std::thread> workers;
+
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                if (config.pin) {
+                    pin_to_cpu(t);
+                }
+                ZipfianGenerator keys(config.keys, config.theta, 42 + t);
+                std::mt19937_64 generator(1000 + t);
+                std::bernoulli_distribution is_read(config.read_ratio);
+                auto& result = results[t];
+                result.latencies.reserve(config.ops / LATENCY_SAMPLE_EVERY + 1);
+                uint64_t sink = 0;
+                bool insert_next = true;
+
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) {}
+
+                auto start = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < config.ops; ++i) {
+                    const uint64_t key = keys.next();
+                    const bool read = is_read(generator);
+                    const bool sampled = i % LATENCY_SAMPLE_EVERY == 0;
+                    auto op_start = sampled ? std::chrono::steady_clock::now() : start;
+
+                    if (read) {
+                        sink += table.get(key).value_or(0);
+                    } else if (insert_next) {
+                        table.insert(key, i);
+                    } else {
+                        table.erase(key);
+                    }
+                    insert_next ^= !read;
+
+                    if (sampled) {
+                        result.latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - op_start).count());
+                    }
+                }
+                result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                checksum.fetch_add(sink, std::memory_order_relaxed);
+            });
+        }
+
+        while (ready.load() < threads) {}
+        go.store(true, std::memory_order_release);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        // aggregate throughput is bounded by the slowest thread
+        double slowest = 0;
+        double worst_p99 = 0;
+        std::vector<double> all;
+        for (auto& result : results) {
+            slowest = std::max(slowest, result.seconds);
+            std::sort(result.latencies.begin(), result.latencies.end());
+            worst_p99 = std::max(worst_p99, percentile(result.latencies, 0.99));
+            all.insert(all.end(), result.latencies.begin(), result.latencies.end());
+        }
+        std::sort(all.begin(), all.end());
+
+        std::cout << std::setw(8) << threads
+                  << std::setw(12) << std::fixed << std::setprecision(2) << threads * config.ops / slowest / 1e6
+                  << std::setw(10) << std::setprecision(0) << percentile(all, 0.5)
+                  << std::setw(10) << percentile(all, 0.99)
+                  << std::setw(11) << percentile(all, 0.999)
+                  << std::setw(12) << worst_p99 << "\n";
+    }
+    std::cout << "\n";
+}
+
+static Config parse_args(int argc, char* argv[]) {
+    Config config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (eq == std::string::npos) {
+            throw std::invalid_argument("expected key=value, got " + arg);
+        }
+        std::string key = arg.substr(0, eq);
+        std::string value = arg.substr(eq + 1);
+
+        if (key == "threads") config.threads = std::stoull(value);
+        else if (key == "read") config.read_ratio = std::stod(value);
+        else if (key == "theta") config.theta = std::stod(value);
+        else if (key == "keys") config.keys = std::stoull(value);
+        else if (key == "ops") config.ops = std::stoull(value);
+        else if (key == "pin") config.pin = value != "0";
+        else throw std::invalid_argument("unknown option " + key);
+    }
+    if (!(config.theta < 1.0)) {
+        throw std::invalid_argument("theta must be below 1");
+    }
+    config.threads = std::max<size_t>(1, config.threads);
+    return config;
+}
+
+int main(int argc, char* argv[]) {
+    Config config = parse_args(argc, argv);
+    std::cout << "threads 1.." << config.threads << ", read " << config.read_ratio
+              << ", theta " << config.theta << ", keys " << config.keys
+              << ", ops/thread " << config.ops << ", pin " << config.pin << "\n\n";
+
+    run_scaling<LockedTable>(config, "LockedTable (mutex baseline)");
+    run_scaling<ShardedTable>(config, "ShardedTable (64 shards)");
+
+    return 0;
+}
@@ -0,0 +1,617 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "concurrent_table.cpp"
+#include "memcached.cpp"
+#include "request_batch.cpp"
+
+// a small key-value server over ShardedTable. keys and values are uint64, the
+// same as the table. a connection speaks one of four protocols, chosen by its
+// first byte:
+//
+//   binary     request:  u8 op (1 get, 2 set, 3 del), u64 key, u64 val (set only)
+//              response: u8 status (0 ok / found, 1 not found), u64 val
+//   resp       redis arrays of bulk strings: GET, SET, DEL, MGET, PING, with keys
+//              and values written as decimal integers
+//   memcached  binary when the first byte is the 0x80 request magic, text
+//              otherwise, see memcached.cpp
+//
+// integers in binary frames are in host byte order, little-endian everywhere
+// we run. every request that arrives in one read is parsed into a RequestBatch
+// before anything executes, so a pipelining client's gets reach the table as a
+// single get_batch call instead of one lookup per round trip.
+
+enum class Protocol : uint8_t { Unknown, Binary, Resp, MemcachedText, MemcachedBinary };
+
+// ---- binary protocol ----
+
+static constexpr uint8_t BINARY_GET = 1;
+static constexpr uint8_t BINARY_SET = 2;
+static constexpr uint8_t BINARY_DEL = 3;
+static constexpr size_t BINARY_RESPONSE_SIZE = 9;
+
+// returns the number of bytes consumed, stopping at the first incomplete frame
+inline size_t parse_binary(const char* data, size_t len, RequestBatch& batch) {
+    size_t pos = 0;
+    while (pos < len) {
+        const uint8_t op = static_cast<uint8_t>(data[pos]);
+        const size_t frame = op == BINARY_SET ? 17 : 9;
+        if (op < BINARY_GET || op > BINARY_DEL) {
+            return PARSE_ERROR;
+        }
+        if (len - pos < frame) {
+            break;
+        }
+
+        uint64_t key;
+        std::memcpy(&key, data + pos + 1, sizeof(key));
+        if (op == BINARY_SET) {
+            uint64_t val;
+            std::memcpy(&val, data + pos + 9, sizeof(val));
+            batch.add(RequestOp::Set, key, val);
+        } else {
+            batch.add(op == BINARY_GET ? RequestOp::Get : RequestOp::Del, key);
+        }
+        pos += frame;
+    }
+    return pos;
+}
+
+inline void encode_binary(const RequestBatch& batch, std::string& out) {
+    for (const auto& request : batch.requests_) {
+        char response[BINARY_RESPONSE_SIZE] = {};
+        if (request.op_ == RequestOp::Get || request.op_ == RequestOp::Del) {
+            const auto& result = batch.results_[request.first_key_];
+            response[0] = result.has_value() ? 0 : 1;
+            if (request.op_ == RequestOp::Get && result.has_value()) {
+                const uint64_t val = *result;
+                std::memcpy(response + 1, &val, sizeof(val));
+            }
+        }
+        out.append(response, sizeof(response));
+    }
+}
+
+// ---- resp protocol ----
+
+// bulk strings carry decimal uint64s or command names, anything longer is garbage
+static constexpr size_t RESP_MAX_BULK = 64;
+static constexpr size_t RESP_MAX_ARGS = 1 << 16;
+
+static constexpr const char* RESP_ERR_PROTOCOL = "-ERR protocol error\r\n";
+static constexpr const char* RESP_ERR_UNKNOWN = "-ERR unknown command\r\n";
+static constexpr const char* RESP_ERR_ARITY = "-ERR wrong number of arguments\r\n";
+static constexpr const char* RESP_ERR_INTEGER = "-ERR value is not an integer or out of range\r\n";
+
+// reads "<prefix><integer>\r\n" at pos. returns 0 if incomplete, -1 if malformed,
+// otherwise 1 with pos moved past the line
+inline int parse_resp_header(const char* data, size_t len, size_t& pos, char prefix, int64_t& value) {
+    if (pos >= len) {
+        return 0;
+    }
+    if (data[pos] != prefix) {
+        return -1;
+    }
+    const void* cr = std::memchr(data + pos + 1, '\r', len - pos - 1);
+    if (cr == nullptr) {
+        return len - pos > 32 ? -1 : 0;
+    }
+    const char* end = static_cast<const char*>(cr);
+    if (end + 1 >= data + len) {
+        return 0;
+    }
+    auto [parsed, ec] = std::from_chars(data + pos + 1, end, value);
+    if (ec != std::errc() || parsed != end || end[1] != '\n') {
+        return -1;
+    }
+    pos = end + 2 - data;
+    return 1;
+}
+
+inline bool command_is(std::string_view arg, const char* name) {
+    const size_t n = std::strlen(name);
+    if (arg.size() != n) {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if ((arg[i] & ~0x20) != name[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void add_resp_command(const std::vector<std::string_view>& args, RequestBatch& batch) {
+    const std::string_view name = args[0];
+    const bool is_get = command_is(name, "GET");
+    const bool is_mget = command_is(name, "MGET");
+    const bool is_del = command_is(name, "DEL");
+
+    if (command_is(name, "PING")) {
+        if (args.size() != 1) {
+            batch.add_error(RESP_ERR_ARITY);
+        } else {
+            batch.add_multi(RequestOp::Ping, batch.keys_.size());
+        }
+        return;
+    }
+
+    if (command_is(name, "SET")) {
+        uint64_t key, val;
+        if (args.size() != 3) {
+            batch.add_error(RESP_ERR_ARITY);
+        } else if (!parse_u64(args[1], key) || !parse_u64(args[2], val)) {
+            batch.add_error(RESP_ERR_INTEGER);
+        } else {
+            batch.add(RequestOp::Set, key, val);
+        }
+        return;
+    }
+
+    if (!is_get && !is_mget && !is_del) {
+        batch.add_error(RESP_ERR_UNKNOWN);
+        return;
+    }
+    if (args.size() < 2 || (is_get && args.size() != 2)) {
+        batch.add_error(RESP_ERR_ARITY);
+        return;
+    }
+
+    const size_t first = batch.keys_.size();
+    for (size_t i = 1; i < args.size(); ++i) {
+        uint64_t key;
+        if (!parse_u64(args[i], key)) {
+            batch.keys_.resize(first);
+            batch.add_error(RESP_ERR_INTEGER);
+            return;
+        }
+        batch.keys_.push_back(key);
+    }
+    batch.add_multi(is_get ? RequestOp::Get : is_mget ? RequestOp::MGet : RequestOp::Del, first);
+}
+
+// returns the number of bytes consumed, stopping at the first incomplete command
+inline size_t parse_resp(const char* data, size_t len, RequestBatch& batch) {
+    std::vector<std::string_view> args;
+    size_t consumed = 0;
+
+    while (consumed < len) {
+        size_t pos = consumed;
+        int64_t argc;
+        int status = parse_resp_header(data, len, pos, '*', argc);
+        if (status == 0) {
+            break;
+        }
+        if (status < 0 || argc < 1 || argc > static_cast<int64_t>(RESP_MAX_ARGS)) {
+            batch.add_error(RESP_ERR_PROTOCOL);
+            return PARSE_ERROR;
+        }
+
+        args.clear();
+        for (int64_t i = 0; i < argc && status == 1; ++i) {
+            int64_t bulk_len;
+            status = parse_resp_header(data, len, pos, '$', bulk_len);
+            if (status == 1 && (bulk_len < 0 || bulk_len > static_cast<int64_t>(RESP_MAX_BULK))) {
+                status = -1;
+            }
+            if (status != 1) {
+                break;
+            }
+            if (len - pos < static_cast<size_t>(bulk_len) + 2) {
+                status = 0;
+                break;
+            }
+            if (data[pos + bulk_len] != '\r' || data[pos + bulk_len + 1] != '\n') {
+                status = -1;
+                break;
+            }
+            args.emplace_back(data + pos, bulk_len);
+            pos += bulk_len + 2;
+        }
+
+        if (status == 0) {
+            break;
+        }
+        if (status < 0) {
+            batch.add_error(RESP_ERR_PROTOCOL);
+            return PARSE_ERROR;
+        }
+        add_resp_command(args, batch);
+        consumed = pos;
+    }
+    return consumed;
+}
+
+inline void append_resp_bulk(const std::optional<uint64_t>& value, std::string& out) {
+    if (!value.has_value()) {
+        out += "$-1\r\n";
+        return;
+    }
+    char digits[24];
+    auto end = std::to_chars(digits, digits + sizeof(digits), *value).ptr;
+    out += '$';
+    out += std::to_string(end - digits);
+    out += "\r\n";
+    out.append(digits, end);
+    out += "\r\n";
+}
+
+inline void encode_resp(const RequestBatch& batch, std::string& out) {
+    for (const auto& request : batch.requests_) {
+        switch (request.op_) {
+            case RequestOp::Get:
+                append_resp_bulk(batch.results_[request.first_key_], out);
+                break;
+            case RequestOp::MGet:
+                out += '*';
+                out += std::to_string(request.key_count_);
+                out += "\r\n";
+                for (size_t i = 0; i < request.key_count_; ++i) {
+                    append_resp_bulk(batch.results_[request.first_key_ + i], out);
+                }
+                break;
+            case RequestOp::Set:
+                out += "+OK\r\n";
+                break;
+            case RequestOp::Del: {
+                size_t removed = 0;
+                for (size_t i = 0; i < request.key_count_; ++i) {
+                    removed += batch.results_[request.first_key_ + i].has_value();
+                }
+                out += ':';
+                out += std::to_string(removed);
+                out += "\r\n";
+                break;
+            }
+            case RequestOp::Incr:
+            case RequestOp::Decr:
+                // only the memcached front end issues these
+                out += RESP_ERR_UNKNOWN;
+                break;
+            case RequestOp::Ping:
+                out += "+PONG\r\n";
+                break;
+            case RequestOp::Error:
+                out += request.error_;
+                break;
+        }
+    }
+}
+
+// ---- server ----
+
+struct ServerConfig {
+    std::string host = "127.0.0.1";
+    // 0 picks a free port, read it back with KvServer::port()
+    uint16_t port = 6380;
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    // per shard, the table grows past it as usual
+    size_t initial_size = 1 << 16;
+};
+
+// every worker owns an epoll loop and its own SO_REUSEPORT listener, so the
+// kernel spreads connections across workers and no accept lock is shared. the
+// table has one shard per worker; a connection's keys still span all shards,
+// so workers meet only on the shard locks
+class KvServer {
+public:
+    explicit KvServer(ServerConfig config = {})
+            : config_(std::move(config)), table_(std::max<size_t>(1, config_.workers), config_.initial_size),
+              port_(0), stop_fd_(-1), running_(false) {}
+
+    ~KvServer() { stop(); }
+
+    KvServer(const KvServer&) = delete;
+    KvServer& operator=(const KvServer&) = delete;
+
+    // binds every listener before any worker starts, so a bad address throws here
+    void start() {
+        if (running_) {
+            return;
+        }
+        stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (stop_fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "eventfd");
+        }
+
+        port_ = config_.port;
+        workers_ = std::vector<Worker>(std::max<size_t>(1, config_.workers));
+        try {
+            for (auto& worker : workers_) {
+                worker.listen_fd_ = open_listener(port_);
+                worker.epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+                if (worker.epoll_fd_ < 0) {
+                    throw std::system_error(errno, std::generic_category(), "epoll_create1");
+                }
+                watch(worker.epoll_fd_, worker.listen_fd_, EPOLLIN);
+                watch(worker.epoll_fd_, stop_fd_, EPOLLIN);
+            }
+        } catch (...) {
+            close_all();
+            throw;
+        }
+
+        running_ = true;
+        for (auto& worker : workers_) {
+            worker.thread_ = std::thread([this, &worker] { run(worker); });
+        }
+    }
+
+    void stop() {
+        if (!running_) {
+            return;
+        }
+        // never read back, so the eventfd stays readable and wakes every worker
+        const uint64_t one = 1;
+        if (write(stop_fd_, &one, sizeof(one)) < 0) {
+            // the counter only fails to grow when it is already non-zero
+        }
+        for (auto& worker : workers_) {
+            worker.thread_.join();
+        }
+        running_ = false;
+        close_all();
+    }
+
+    uint16_t port() const { return port_; }
+
+    size_t worker_count() const { return workers_.size(); }
+
+    ShardedTable& table() { return table_; }
+
+private:
+    static constexpr size_t READ_CHUNK = 64 * 1024;
+    // stop reading from a client that is not draining its replies
+    static constexpr size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+    static constexpr int MAX_EVENTS = 64;
+
+    struct Worker {
+        int listen_fd_ = -1;
+        int epoll_fd_ = -1;
+        std::thread thread_;
+    };
+
+    struct Connection {
+        int fd_;
+        Protocol protocol_ = Protocol::Unknown;
+        std::string in_;
+        std::string out_;
+        size_t out_sent_ = 0;
+        uint32_t events_ = EPOLLIN;
+        // answer what was parsed, then close
+        bool closing_ = false;
+    };
+
+    ServerConfig config_;
+    ShardedTable table_;
+    std::vector<Worker> workers_;
+    uint16_t port_;
+    int stop_fd_;
+    bool running_;
+
+    static void watch(int epoll_fd, int fd, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+        }
+    }
+
+    // the first listener may bind port 0, the rest reuse whatever it was given
+    int open_listener(uint16_t& port) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "socket");
+        }
+        const int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, config_.host.c_str(), &addr.sin_addr) != 1) {
+            close(fd);
+            throw std::system_error(EINVAL, std::generic_category(), "bad host " + config_.host);
+        }
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "bind " + config_.host);
+        }
+
+        socklen_t addr_len = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addr_len);
+        port = ntohs(addr.sin_port);
+        return fd;
+    }
+
+    void close_all() {
+        for (auto& worker : workers_) {
+            if (worker.listen_fd_ >= 0) close(worker.listen_fd_);
+            if (worker.epoll_fd_ >= 0) close(worker.epoll_fd_);
+            worker.listen_fd_ = worker.epoll_fd_ = -1;
+        }
+        if (stop_fd_ >= 0) {
+            close(stop_fd_);
+            stop_fd_ = -1;
+        }
+    }
+
+    void run(Worker& worker) {
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        RequestBatch batch;
+        epoll_event events[MAX_EVENTS];
+        bool stopping = false;
+
+        while (!stopping) {
+            const int ready = epoll_wait(worker.epoll_fd_, events, MAX_EVENTS, -1);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+
+            for (int i = 0; i < ready; ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == stop_fd_) {
+                    stopping = true;
+                    continue;
+                }
+                if (fd == worker.listen_fd_) {
+                    accept_all(worker, connections);
+                    continue;
+                }
+
+                auto it = connections.find(fd);
+                if (it == connections.end()) {
+                    continue;
+                }
+                Connection& conn = *it->second;
+                bool open = true;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    open = on_readable(conn, batch);
+                }
+                if (open) {
+                    open = flush(conn) && !(conn.closing_ && conn.out_.empty());
+                }
+                if (open) {
+                    update_interest(worker, conn);
+                } else {
+                    close(fd);
+                    connections.erase(it);
+                }
+            }
+        }
+
+        for (auto& entry : connections) {
+            close(entry.first);
+        }
+    }
+
+    void accept_all(Worker& worker, std::unordered_map<int, std::unique_ptr<Connection>>& connections) {
+        while (true) {
+            int fd = accept4(worker.listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            const int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            auto conn = std::make_unique<Connection>();
+            conn->fd_ = fd;
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(worker.epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+                close(fd);
+                continue;
+            }
+            connections.emplace(fd, std::move(conn));
+        }
+    }
+
+    static Protocol detect_protocol(uint8_t first) {
+        if (first == '*') return Protocol::Resp;
+        if (first >= BINARY_GET && first <= BINARY_DEL) return Protocol::Binary;
+        if (first == MEMCACHED_REQUEST_MAGIC) return Protocol::MemcachedBinary;
+        return Protocol::MemcachedText;
+    }
+
+    // false when the connection should be dropped right away
+    bool on_readable(Connection& conn, RequestBatch& batch) {
+        if (conn.closing_) {
+            return true;
+        }
+        const size_t old_size = conn.in_.size();
+        conn.in_.resize(old_size + READ_CHUNK);
+        const ssize_t n = recv(conn.fd_, &conn.in_[old_size], READ_CHUNK, 0);
+        if (n <= 0) {
+            conn.in_.resize(old_size);
+            if (n == 0) {
+                // the client shut down its side, still deliver what it asked for
+                conn.closing_ = true;
+                return true;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        conn.in_.resize(old_size + n);
+
+        if (conn.protocol_ == Protocol::Unknown) {
+            conn.protocol_ = detect_protocol(static_cast<uint8_t>(conn.in_[0]));
+        }
+
+        batch.clear();
+        const char* data = conn.in_.data();
+        const size_t len = conn.in_.size();
+        size_t consumed = 0;
+        switch (conn.protocol_) {
+            case Protocol::Resp: consumed = parse_resp(data, len, batch); break;
+            case Protocol::MemcachedText: consumed = parse_memcached_text(data, len, batch); break;
+            case Protocol::MemcachedBinary: consumed = parse_memcached_binary(data, len, batch); break;
+            default: consumed = parse_binary(data, len, batch); break;
+        }
+        execute_batch(batch, table_);
+        switch (conn.protocol_) {
+            case Protocol::Resp: encode_resp(batch, conn.out_); break;
+            case Protocol::MemcachedText: encode_memcached_text(batch, conn.out_); break;
+            case Protocol::MemcachedBinary: encode_memcached_binary(batch, conn.out_); break;
+            default: encode_binary(batch, conn.out_); break;
+        }
+
+        if (consumed == PARSE_ERROR) {
+            conn.in_.clear();
+            conn.closing_ = true;
+        } else {
+            conn.in_.erase(0, consumed);
+        }
+        return true;
+    }
+
+    // false on a write error
+    bool flush(Connection& conn) {
+        while (conn.out_sent_ < conn.out_.size()) {
+            const ssize_t n = send(conn.fd_, conn.out_.data() + conn.out_sent_,
+                                   conn.out_.size() - conn.out_sent_, MSG_NOSIGNAL);
+            if (n < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            conn.out_sent_ += n;
+        }
+        conn.out_.clear();
+        conn.out_sent_ = 0;
+        return true;
+    }
+
+    void update_interest(Worker& worker, Connection& conn) {
+        const size_t pending = conn.out_.size() - conn.out_sent_;
+        uint32_t events = 0;
+        if (pending < MAX_PENDING_OUTPUT && !conn.closing_) events |= EPOLLIN;
+        if (pending > 0) events |= EPOLLOUT;
+        if (events == conn.events_) {
+            return;
+        }
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = conn.fd_;
+        epoll_ctl(worker.epoll_fd_, EPOLL_CTL_MOD, conn.fd_, &event);
+        conn.events_ = events;
+    }
+};
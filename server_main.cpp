@@ -0,0 +1,53 @@
+#include <csignal>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <pthread.h>
+#include "server.cpp"
+
+// usage: server [host=127.0.0.1] [port=6380] [workers=N] [initial=65536]
+//
+// serves until SIGINT or SIGTERM. see server.cpp for the wire protocols; any
+// redis client works for the resp side as long as keys and values are integers.
+
+static ServerConfig parse_args(int argc, char* argv[]) {
+    ServerConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (eq == std::string::npos) {
+            throw std::invalid_argument("expected key=value, got " + arg);
+        }
+        std::string key = arg.substr(0, eq);
+        std::string value = arg.substr(eq + 1);
+
+        if (key == "host") config.host = value;
+        else if (key == "port") config.port = static_cast<uint16_t>(std::stoul(value));
+        else if (key == "workers") config.workers = std::stoull(value);
+        else if (key == "initial") config.initial_size = std::stoull(value);
+        else throw std::invalid_argument("unknown option " + key);
+    }
+    return config;
+}
+
+int main(int argc, char* argv[]) {
+    ServerConfig config = parse_args(argc, argv);
+
+    // block the signals before the workers start so only sigwait below sees them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    KvServer server(config);
+    server.start();
+    std::cout << "listening on " << config.host << ":" << server.port()
+              << " with " << server.worker_count() << " workers" << std::endl;
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.stop();
+    std::cout << "stopped, " << server.table().size() << " keys" << std::endl;
+    return 0;
+}
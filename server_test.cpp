@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include "server.cpp"
+
+class KvServerTest : public ::testing::Test {
+protected:
+    std::unique_ptr<KvServer> server;
+
+    void SetUp() override {
+        ServerConfig config;
+        config.port = 0;
+        config.workers = 2;
+        config.initial_size = 64;
+        server = std::make_unique<KvServer>(config);
+        server->start();
+    }
+
+    int connect_client() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(server->port());
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        EXPECT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        timeval timeout{5, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+    static void send_all(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            ASSERT_GT(n, 0);
+            sent += n;
+        }
+    }
+
+    static std::string recv_exact(int fd, size_t len) {
+        std::string data(len, '\0');
+        size_t got = 0;
+        while (got < len) {
+            ssize_t n = recv(fd, &data[got], len - got, 0);
+            if (n <= 0) break;
+            got += n;
+        }
+        data.resize(got);
+        return data;
+    }
+
+    static std::string binary(uint8_t op, uint64_t key, uint64_t val = 0) {
+        std::string frame(1, static_cast<char>(op));
+        frame.append(reinterpret_cast<const char*>(&key), sizeof(key));
+        if (op == BINARY_SET) {
+            frame.append(reinterpret_cast<const char*>(&val), sizeof(val));
+        }
+        return frame;
+    }
+
+    static std::pair<uint8_t, uint64_t> decode(const std::string& response, size_t index) {
+        uint64_t val;
+        std::memcpy(&val, response.data() + index * BINARY_RESPONSE_SIZE + 1, sizeof(val));
+        return {static_cast<uint8_t>(response[index * BINARY_RESPONSE_SIZE]), val};
+    }
+};
+
+TEST_F(KvServerTest, BinaryGetSetDel) {
+    int fd = connect_client();
+    send_all(fd, binary(BINARY_GET, 7) + binary(BINARY_SET, 7, 700) + binary(BINARY_GET, 7) +
+                 binary(BINARY_DEL, 7) + binary(BINARY_DEL, 7) + binary(BINARY_GET, 7));
+    auto response = recv_exact(fd, 6 * BINARY_RESPONSE_SIZE);
+    ASSERT_EQ(response.size(), 6 * BINARY_RESPONSE_SIZE);
+
+    EXPECT_EQ(decode(response, 0).first, 1);
+    EXPECT_EQ(decode(response, 1).first, 0);
+    EXPECT_EQ(decode(response, 2), std::make_pair(uint8_t(0), uint64_t(700)));
+    EXPECT_EQ(decode(response, 3).first, 0);
+    EXPECT_EQ(decode(response, 4).first, 1);
+    EXPECT_EQ(decode(response, 5).first, 1);
+    close(fd);
+}
+
+// one large pipeline interleaving writes and reads, every get must see the set before it
+TEST_F(KvServerTest, PipelinedRequestsKeepOrder) {
+    const size_t count = 20000;
+    std::string requests;
+    for (size_t i = 0; i < count; ++i) {
+        requests += binary(BINARY_SET, i, i * 3);
+        requests += binary(BINARY_GET, i);
+        requests += binary(BINARY_GET, i + 1);
+    }
+    int fd = connect_client();
+    send_all(fd, requests);
+    auto response = recv_exact(fd, 3 * count * BINARY_RESPONSE_SIZE);
+    ASSERT_EQ(response.size(), 3 * count * BINARY_RESPONSE_SIZE);
+
+    for (size_t i = 0; i < count; ++i) {
+        EXPECT_EQ(decode(response, 3 * i + 1), std::make_pair(uint8_t(0), uint64_t(i * 3)));
+        EXPECT_EQ(decode(response, 3 * i + 2).first, 1);
+    }
+    EXPECT_EQ(server->table().size(), count);
+    close(fd);
+}
+
+TEST_F(KvServerTest, RespCommands) {
+    int fd = connect_client();
+    const std::string requests =
+            "*1\r\n$4\r\nPING\r\n"
+            "*3\r\n$3\r\nSET\r\n$2\r\n10\r\n$3\r\n100\r\n"
+            "*3\r\n$3\r\nset\r\n$2\r\n11\r\n$3\r\n110\r\n"
+            "*2\r\n$3\r\nGET\r\n$2\r\n10\r\n"
+            "*4\r\n$4\r\nMGET\r\n$2\r\n10\r\n$2\r\n12\r\n$2\r\n11\r\n"
+            "*3\r\n$3\r\nDEL\r\n$2\r\n10\r\n$2\r\n12\r\n"
+            "*2\r\n$3\r\nGET\r\n$2\r\n10\r\n"
+            "*2\r\n$3\r\nGET\r\n$3\r\nabc\r\n"
+            "*1\r\n$3\r\nGET\r\n"
+            "*1\r\n$4\r\nINCR\r\n";
+    const std::string expected =
+            "+PONG\r\n"
+            "+OK\r\n"
+            "+OK\r\n"
+            "$3\r\n100\r\n"
+            "*3\r\n$3\r\n100\r\n$-1\r\n$3\r\n110\r\n"
+            ":1\r\n"
+            "$-1\r\n"
+            "-ERR value is not an integer or out of range\r\n"
+            "-ERR wrong number of arguments\r\n"
+            "-ERR unknown command\r\n";
+    send_all(fd, requests);
+    EXPECT_EQ(recv_exact(fd, expected.size()), expected);
+    close(fd);
+}
+
+TEST_F(KvServerTest, RequestsSplitAcrossReads) {
+    int fd = connect_client();
+    const std::string requests = "*3\r\n$3\r\nSET\r\n$1\r\n5\r\n$2\r\n55\r\n*2\r\n$3\r\nGET\r\n$1\r\n5\r\n";
+    for (char c : requests) {
+        send_all(fd, std::string(1, c));
+        usleep(200);
+    }
+    const std::string expected = "+OK\r\n$2\r\n55\r\n";
+    EXPECT_EQ(recv_exact(fd, expected.size()), expected);
+    close(fd);
+}
+
+TEST_F(KvServerTest, ConnectionsShareTheTable) {
+    int writer = connect_client();
+    int reader = connect_client();
+    send_all(writer, binary(BINARY_SET, 42, 4242));
+    ASSERT_EQ(recv_exact(writer, BINARY_RESPONSE_SIZE).size(), BINARY_RESPONSE_SIZE);
+
+    const std::string expected = "$4\r\n4242\r\n";
+    send_all(reader, "*2\r\n$3\r\nGET\r\n$2\r\n42\r\n");
+    EXPECT_EQ(recv_exact(reader, expected.size()), expected);
+    close(writer);
+    close(reader);
+}
+
+TEST_F(KvServerTest, ProtocolErrorClosesAfterEarlierReplies) {
+    int fd = connect_client();
+    send_all(fd, binary(BINARY_SET, 1, 2) + std::string(1, '\x7f') + binary(BINARY_GET, 1));
+    EXPECT_EQ(recv_exact(fd, BINARY_RESPONSE_SIZE).size(), BINARY_RESPONSE_SIZE);
+    char byte;
+    EXPECT_EQ(recv(fd, &byte, 1, 0), 0);
+    close(fd);
+
+    fd = connect_client();
+    send_all(fd, "*1\r\n$4\r\nPING\r\n*x\r\n");
+    const std::string expected = "+PONG\r\n-ERR protocol error\r\n";
+    EXPECT_EQ(recv_exact(fd, expected.size()), expected);
+    EXPECT_EQ(recv(fd, &byte, 1, 0), 0);
+    close(fd);
+}
+
+TEST_F(KvServerTest, StopIsIdempotentAndRestartable) {
+    server->stop();
+    server->stop();
+    server->start();
+    int fd = connect_client();
+    send_all(fd, "*1\r\n$4\r\nPING\r\n");
+    EXPECT_EQ(recv_exact(fd, 7), "+PONG\r\n");
+    close(fd);
+}
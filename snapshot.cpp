@@ -0,0 +1,530 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <libgen.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "io_backend.cpp"
+#include "table.cpp"
+
+// raw snapshot: the slot array exactly as it sits in memory, so loading is one
+// sequential read straight into data_ with no rehashing.
+//   header: "OATS" magic, u8 version, u64 capacity, u64 size, u64 lsn, u64 xxh64 of the slots
+//   body:   capacity * sizeof(Entry) bytes
+// lsn is the last logged operation the image contains, recovery replays the log
+// from there. a snapshot is written to <path>.tmp, fsynced and renamed over
+// <path>, so a crash mid-write leaves the previous snapshot intact.
+
+static constexpr char SNAPSHOT_MAGIC[4] = {'O', 'A', 'T', 'S'};
+static constexpr uint8_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader {
+    char magic_[4];
+    uint8_t version_;
+    uint8_t reserved_[3];
+    uint64_t capacity_;
+    uint64_t size_;
+    uint64_t lsn_;
+    uint64_t checksum_;
+};
+
+inline void write_all(int fd, const void* data, size_t len, const std::string& path) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::system_error(errno, std::generic_category(), "write " + path);
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+// false at end of file before len bytes
+inline bool read_all(int fd, void* data, size_t len, const std::string& path) {
+    char* p = static_cast<char*>(data);
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::system_error(errno, std::generic_category(), "read " + path);
+        }
+        if (n == 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// leb128, shared by the log and the compressed snapshot
+inline bool get_varint(const char* data, size_t len, size_t& pos, uint64_t& out) {
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (pos >= len) {
+            return false;
+        }
+        uint8_t b = static_cast<uint8_t>(data[pos++]);
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline std::string parent_dir(const std::string& path) {
+    std::string copy = path;
+    return dirname(&copy[0]);
+}
+
+// a rename is only durable once the directory entry is
+inline void sync_parent_dir(const std::string& path) {
+    int fd = open(parent_dir(path).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+// writes tmp_path and renames it over path once it is durable
+template <typename WriteBody>
+void write_file_atomically(const std::string& path, WriteBody write_body) {
+    const std::string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + tmp_path);
+    }
+    try {
+        write_body(fd, tmp_path);
+        if (fsync(fd) < 0) {
+            throw std::system_error(errno, std::generic_category(), "fsync " + tmp_path);
+        }
+    } catch (...) {
+        close(fd);
+        unlink(tmp_path.c_str());
+        throw;
+    }
+    close(fd);
+    if (rename(tmp_path.c_str(), path.c_str()) < 0) {
+        throw std::system_error(errno, std::generic_category(), "rename " + tmp_path);
+    }
+    sync_parent_dir(path);
+}
+
+inline SnapshotHeader make_snapshot_header(const OpenAddressTable& table, uint64_t lsn) {
+    SnapshotHeader header{};
+    std::memcpy(header.magic_, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version_ = SNAPSHOT_VERSION;
+    header.capacity_ = table.data_.size();
+    header.size_ = table.size();
+    header.lsn_ = lsn;
+    header.checksum_ = XXH64(table.data_.data(), table.data_.size() * sizeof(Entry), 0);
+    return header;
+}
+
+inline void save_snapshot(const OpenAddressTable& table, const std::string& path, uint64_t lsn = 0) {
+    const size_t bytes = table.data_.size() * sizeof(Entry);
+    const SnapshotHeader header = make_snapshot_header(table, lsn);
+
+    write_file_atomically(path, [&](int fd, const std::string& tmp_path) {
+        write_all(fd, &header, sizeof(header), tmp_path);
+        write_all(fd, table.data_.data(), bytes, tmp_path);
+    });
+}
+
+// fuzzy checkpoint: a list of (key, val) records gathered range by range while
+// the table keeps changing, so different ranges are captured at different
+// moments. every value in it is at least as new as the checkpoint's lsn, which
+// makes it exact once the ops logged after that lsn are replayed on top.
+//   header: SnapshotHeader with "OATF" magic; capacity_ is a presizing hint,
+//           size_ the record count, checksum_ xxh64 chained over blocks of
+//           FUZZY_BLOCK_RECORDS records
+//   body:   size_ * 16 bytes of little-endian key, val
+// a key can appear more than once if the table was resized mid-scan, the last
+// record wins.
+
+static constexpr char FUZZY_CHECKPOINT_MAGIC[4] = {'O', 'A', 'T', 'F'};
+static constexpr size_t FUZZY_BLOCK_RECORDS = 1 << 16;
+
+using KeyValue = std::pair<uint64_t, uint64_t>;
+
+// appends every entry whose home slot is in [begin, end). homes never move
+// while the capacity stays the same, even though the entries themselves shift
+// under robin-hood displacement and backward-shift deletion, so consecutive
+// ranges see every key exactly once. robin-hood keeps a cluster sorted by home:
+// past end the scan runs on through entries homed before begin, which a cluster
+// covering the whole range pushes there, and stops at an empty slot or the
+// first entry homed at or after end
+inline void collect_home_range(const OpenAddressTable& table, size_t begin, size_t end, std::vector<KeyValue>& out) {
+    const size_t mask = table.data_.size() - 1;
+    const size_t span = end - begin;
+    for (size_t i = 0; i < table.data_.size(); ++i) {
+        const Entry& entry = table.data_[(begin + i) & mask];
+        if (entry.status_ != 2) {
+            if (entry.status_ == 0 && i >= span) break;
+            continue;
+        }
+        const size_t offset = (OpenAddressTable::hash_key(entry.key_) - begin) & mask;
+        if (offset < span) {
+            out.emplace_back(entry.key_, entry.val_);
+        } else if (offset <= i) {
+            // homed in [end, here]; an offset past i is a home before begin
+            break;
+        }
+    }
+}
+
+// streams a fuzzy checkpoint to <path>.tmp, renamed over path by finish()
+class FuzzyCheckpointWriter {
+public:
+    explicit FuzzyCheckpointWriter(const std::string& path)
+            : path_(path), tmp_path_(path + ".tmp"), count_(0), checksum_(0) {
+        block_.reserve(FUZZY_BLOCK_RECORDS);
+        fd_ = open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + tmp_path_);
+        }
+        SnapshotHeader placeholder{};
+        write_all(fd_, &placeholder, sizeof(placeholder), tmp_path_);
+    }
+
+    ~FuzzyCheckpointWriter() {
+        if (fd_ >= 0) {
+            close(fd_);
+            unlink(tmp_path_.c_str());
+        }
+    }
+
+    FuzzyCheckpointWriter(const FuzzyCheckpointWriter&) = delete;
+    FuzzyCheckpointWriter& operator=(const FuzzyCheckpointWriter&) = delete;
+
+    void append(const std::vector<KeyValue>& records) {
+        for (const auto& record : records) {
+            block_.push_back(record);
+            if (block_.size() == FUZZY_BLOCK_RECORDS) {
+                write_block();
+            }
+        }
+    }
+
+    void finish(size_t capacity, uint64_t lsn) {
+        write_block();
+        SnapshotHeader header{};
+        std::memcpy(header.magic_, FUZZY_CHECKPOINT_MAGIC, sizeof(FUZZY_CHECKPOINT_MAGIC));
+        header.version_ = SNAPSHOT_VERSION;
+        header.capacity_ = capacity;
+        header.size_ = count_;
+        header.lsn_ = lsn;
+        header.checksum_ = checksum_;
+        if (pwrite(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+            throw std::system_error(errno, std::generic_category(), "write " + tmp_path_);
+        }
+        if (fsync(fd_) < 0) {
+            throw std::system_error(errno, std::generic_category(), "fsync " + tmp_path_);
+        }
+        close(fd_);
+        fd_ = -1;
+        if (rename(tmp_path_.c_str(), path_.c_str()) < 0) {
+            throw std::system_error(errno, std::generic_category(), "rename " + tmp_path_);
+        }
+        sync_parent_dir(path_);
+    }
+
+    size_t records_written() const { return count_; }
+
+private:
+    std::string path_;
+    std::string tmp_path_;
+    int fd_;
+    size_t count_;
+    uint64_t checksum_;
+    std::vector<KeyValue> block_;
+
+    void write_block() {
+        const size_t bytes = block_.size() * sizeof(KeyValue);
+        checksum_ = XXH64(block_.data(), bytes, checksum_);
+        write_all(fd_, block_.data(), bytes, tmp_path_);
+        count_ += block_.size();
+        block_.clear();
+    }
+};
+
+inline OpenAddressTable load_fuzzy_checkpoint(int fd, const SnapshotHeader& header, const std::string& path) {
+    const uint64_t capacity = header.capacity_;
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        throw std::runtime_error("corrupt checkpoint header in: " + path);
+    }
+    OpenAddressTable table(capacity);
+    std::vector<KeyValue> chunk(std::min<uint64_t>(header.size_, FUZZY_BLOCK_RECORDS));
+    uint64_t checksum = 0;
+    for (uint64_t left = header.size_; left > 0;) {
+        const size_t n = std::min<uint64_t>(left, chunk.size());
+        if (!read_all(fd, chunk.data(), n * sizeof(KeyValue), path)) {
+            throw std::runtime_error("truncated checkpoint: " + path);
+        }
+        checksum = XXH64(chunk.data(), n * sizeof(KeyValue), checksum);
+        for (size_t i = 0; i < n; ++i) {
+            table.insert(chunk[i].first, chunk[i].second);
+        }
+        left -= n;
+    }
+    if (checksum != header.checksum_) {
+        throw std::runtime_error("corrupt checkpoint: " + path);
+    }
+    return table;
+}
+
+// the same snapshot written through SequentialFileWriter: io_uring with several
+// buffers in flight and O_DIRECT by default, so a large dump neither blocks on
+// each write nor fills the page cache
+inline void save_snapshot(const OpenAddressTable& table, const std::string& path, uint64_t lsn, IoConfig io) {
+    const SnapshotHeader header = make_snapshot_header(table, lsn);
+    write_file_atomically(path, [&](int fd, const std::string& tmp_path) {
+        SequentialFileWriter writer(fd, tmp_path, io);
+        writer.write(&header, sizeof(header));
+        writer.write(table.data_.data(), table.data_.size() * sizeof(Entry));
+        writer.finish();
+    });
+}
+
+// reads either a raw snapshot or a fuzzy checkpoint
+inline OpenAddressTable load_snapshot(const std::string& path, uint64_t* lsn = nullptr) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+
+    SnapshotHeader header;
+    OpenAddressTable table(0);
+    try {
+        if (!read_all(fd, &header, sizeof(header), path)) {
+            throw std::runtime_error("not a snapshot file: " + path);
+        }
+        const bool fuzzy = std::memcmp(header.magic_, FUZZY_CHECKPOINT_MAGIC, sizeof(FUZZY_CHECKPOINT_MAGIC)) == 0;
+        if (!fuzzy && std::memcmp(header.magic_, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            throw std::runtime_error("not a snapshot file: " + path);
+        }
+        if (header.version_ != SNAPSHOT_VERSION) {
+            throw std::runtime_error("unsupported snapshot version in: " + path);
+        }
+        if (fuzzy) {
+            table = load_fuzzy_checkpoint(fd, header, path);
+            close(fd);
+            if (lsn != nullptr) {
+                *lsn = header.lsn_;
+            }
+            return table;
+        }
+        const uint64_t capacity = header.capacity_;
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0 || header.size_ > capacity) {
+            throw std::runtime_error("corrupt snapshot header in: " + path);
+        }
+
+        table.data_.resize(capacity);
+        if (!read_all(fd, table.data_.data(), capacity * sizeof(Entry), path) ||
+            XXH64(table.data_.data(), capacity * sizeof(Entry), 0) != header.checksum_) {
+            throw std::runtime_error("truncated or corrupt snapshot: " + path);
+        }
+        table.size_ = header.size_;
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    if (lsn != nullptr) {
+        *lsn = header.lsn_;
+    }
+    return table;
+}
+
+// background snapshot: fork() gives the child a copy-on-write view of the whole
+// process, frozen at the call, and the child writes that view out while the
+// parent carries on mutating the table. the parent's only pause is fork itself,
+// which copies page tables (about 2 MiB per GiB of table) but no data; after
+// that each page the parent writes to is copied once, so memory grows by at
+// most the pages touched while the child runs.
+//
+// the child must not allocate or take locks another thread may have held at
+// fork time, so everything it needs is prepared beforehand and it only makes
+// system calls. it reports progress through a pipe that a watcher thread in
+// the parent turns into callbacks.
+
+using SnapshotProgressFn = std::function<void(size_t written, size_t total)>;
+using SnapshotDoneFn = std::function<void(std::error_code error)>;
+
+class SnapshotJob {
+public:
+    // bytes the child writes between progress reports
+    static constexpr size_t PROGRESS_CHUNK_BYTES = 64 << 20;
+
+    SnapshotJob(const OpenAddressTable& table, const std::string& path, uint64_t lsn,
+                SnapshotProgressFn on_progress, SnapshotDoneFn on_done)
+            : on_progress_(std::move(on_progress)), on_done_(std::move(on_done)), finished_(false) {
+        const std::string tmp_path = path + ".tmp";
+        const std::string dir = parent_dir(path);
+        const char* body = reinterpret_cast<const char*>(table.data_.data());
+        total_ = sizeof(SnapshotHeader) + table.data_.size() * sizeof(Entry);
+
+        int progress_pipe[2];
+        if (pipe2(progress_pipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+            throw std::system_error(errno, std::generic_category(), "pipe");
+        }
+        pid_ = fork();
+        if (pid_ < 0) {
+            const int error = errno;
+            close(progress_pipe[0]);
+            close(progress_pipe[1]);
+            throw std::system_error(error, std::generic_category(), "fork");
+        }
+        if (pid_ == 0) {
+            close(progress_pipe[0]);
+            // the checksum is taken here so the parent does not pay for a full pass
+            const SnapshotHeader header = make_snapshot_header(table, lsn);
+            _exit(write_in_child(header, body, tmp_path.c_str(), path.c_str(), dir.c_str(), progress_pipe[1]));
+        }
+        close(progress_pipe[1]);
+        progress_fd_ = progress_pipe[0];
+        watcher_ = std::thread([this] { watch(); });
+    }
+
+    ~SnapshotJob() {
+        wait();
+    }
+
+    SnapshotJob(const SnapshotJob&) = delete;
+    SnapshotJob& operator=(const SnapshotJob&) = delete;
+
+    // blocks until the child has exited and the done callback has run
+    std::error_code wait() {
+        std::lock_guard<std::mutex> lock(join_mutex_);
+        if (watcher_.joinable()) {
+            watcher_.join();
+        }
+        return error_;
+    }
+
+    bool finished() const { return finished_.load(std::memory_order_acquire); }
+
+    pid_t pid() const { return pid_; }
+
+    size_t total_bytes() const { return total_; }
+
+private:
+    SnapshotProgressFn on_progress_;
+    SnapshotDoneFn on_done_;
+    pid_t pid_;
+    int progress_fd_;
+    size_t total_;
+    std::error_code error_;
+    std::atomic<bool> finished_;
+    std::mutex join_mutex_;
+    std::thread watcher_;
+
+    // returns the exit status: 0, or the errno of the failing call
+    static int write_in_child(const SnapshotHeader& header, const char* body, const char* tmp_path,
+                              const char* path, const char* dir, int progress_fd) {
+        const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return errno;
+
+        const size_t body_bytes = header.capacity_ * sizeof(Entry);
+        uint64_t written = 0;
+        auto put = [&](const char* p, size_t len) {
+            while (len > 0) {
+                ssize_t n = write(fd, p, len);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    return errno;
+                }
+                p += n;
+                len -= n;
+                written += n;
+            }
+            // a full pipe only means the parent is slow to read, never block on it
+            ssize_t ignored = write(progress_fd, &written, sizeof(written));
+            (void)ignored;
+            return 0;
+        };
+
+        int error = put(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (size_t off = 0; error == 0 && off < body_bytes; off += PROGRESS_CHUNK_BYTES) {
+            error = put(body + off, std::min(PROGRESS_CHUNK_BYTES, body_bytes - off));
+        }
+        if (error == 0 && fsync(fd) < 0) error = errno;
+        close(fd);
+        if (error == 0 && rename(tmp_path, path) < 0) error = errno;
+        if (error != 0) {
+            unlink(tmp_path);
+            return error;
+        }
+        const int dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+        return 0;
+    }
+
+    void watch() {
+        fcntl(progress_fd_, F_SETFL, 0);
+        uint64_t written;
+        ssize_t n;
+        while ((n = read(progress_fd_, &written, sizeof(written))) != 0) {
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if (n == sizeof(written) && on_progress_) {
+                on_progress_(written, total_);
+            }
+        }
+        close(progress_fd_);
+
+        int status = 0;
+        while (waitpid(pid_, &status, 0) < 0 && errno == EINTR) {
+        }
+        if (WIFEXITED(status)) {
+            if (WEXITSTATUS(status) != 0) {
+                error_ = std::error_code(WEXITSTATUS(status), std::generic_category());
+            }
+        } else {
+            error_ = std::make_error_code(std::errc::interrupted);
+        }
+        finished_.store(true, std::memory_order_release);
+        if (on_done_) {
+            on_done_(error_);
+        }
+    }
+};
+
+// starts a background snapshot of the table as it is at the call. the caller
+// must not be mutating the table from another thread during the call itself;
+// once it returns the table is free again. the file is the same raw format
+// save_snapshot writes, and it only replaces path once it is complete
+inline std::unique_ptr<SnapshotJob> snapshot_async(const OpenAddressTable& table, const std::string& path,
+                                                   uint64_t lsn = 0, SnapshotProgressFn on_progress = {},
+                                                   SnapshotDoneFn on_done = {}) {
+    return std::make_unique<SnapshotJob>(table, path, lsn, std::move(on_progress), std::move(on_done));
+}
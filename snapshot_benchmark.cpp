@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "snapshot.cpp"
+
+// usage: snapshot_benchmark [dir=/tmp] [capacity_log2=24] [load_factor=0.7]
+//
+// what a snapshot costs the thread that owns the table. save_snapshot stops it
+// for the whole dump; snapshot_async stops it only for the fork, after which it
+// keeps updating random keys while the child writes. the update rate during the
+// background dump shows the copy-on-write faults it pays instead, and max is the
+// worst single update.
+
+const size_t DEFAULT_CAPACITY_LOG2 = 24;
+const double DEFAULT_LOAD_FACTOR = 0.7;
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    const std::string dir = argc > 1 ? argv[1] : "/tmp";
+    const size_t capacity_log2 = argc > 2 ? std::stoull(argv[2]) : DEFAULT_CAPACITY_LOG2;
+    const double load_factor = argc > 3 ? std::stod(argv[3]) : DEFAULT_LOAD_FACTOR;
+    const std::string path = dir + "/snapshot_benchmark.bin";
+
+    const size_t capacity = size_t(1) << capacity_log2;
+    const size_t live = static_cast<size_t>(capacity * load_factor);
+    OpenAddressTable table(capacity);
+    std::mt19937_64 gen(42);
+    std::vector<uint64_t> keys(live);
+    for (auto& key : keys) {
+        key = gen();
+        table.insert(key, key);
+    }
+    std::cout << "capacity " << capacity << ", live " << table.size() << ", image "
+              << std::fixed << std::setprecision(1) << capacity * sizeof(Entry) / double(1 << 20) << " MiB\n\n";
+
+    auto start = Clock::now();
+    save_snapshot(table, path);
+    std::cout << "save_snapshot      stalls the owner " << ms_since(start) << " ms\n";
+
+    // baseline update rate with no snapshot running
+    std::uniform_int_distribution<size_t> pick(0, live - 1);
+    const size_t baseline_ops = 2'000'000;
+    start = Clock::now();
+    for (size_t i = 0; i < baseline_ops; i++) {
+        table.insert(keys[pick(gen)], i);
+    }
+    const double baseline_rate = baseline_ops / ms_since(start) * 1000;
+
+    start = Clock::now();
+    auto job = snapshot_async(table, path);
+    const double fork_ms = ms_since(start);
+
+    size_t ops = 0;
+    double max_us = 0;
+    const auto background_start = Clock::now();
+    while (!job->finished()) {
+        for (size_t i = 0; i < 1024; i++) {
+            const auto op_start = Clock::now();
+            table.insert(keys[pick(gen)], ops++);
+            max_us = std::max(max_us, std::chrono::duration<double, std::micro>(Clock::now() - op_start).count());
+        }
+    }
+    const double background_ms = ms_since(background_start);
+    if (auto error = job->wait()) {
+        std::cerr << "background snapshot failed: " << error.message() << "\n";
+        return 1;
+    }
+
+    std::cout << "snapshot_async     stalls the owner " << fork_ms << " ms (fork), child done in "
+              << background_ms << " ms\n"
+              << std::setprecision(0)
+              << "updates/s          " << baseline_rate << " idle, " << ops / background_ms * 1000
+              << " during the dump, max " << std::setprecision(1) << max_us << " us\n";
+
+    std::remove(path.c_str());
+    return 0;
+}
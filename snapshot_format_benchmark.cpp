@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "compressed_snapshot.cpp"
+
+// usage: snapshot_format_benchmark [dir=/tmp] [capacity_log2=24] [threads=0]
+//
+// file size, save and load time of the raw image against the compressed format
+// for a few table shapes: dense and sparse, sequential ids and random keys. load
+// times include rebuilding the table; the raw image is one read, the compressed
+// one is decode + insert_batch. run on a warm page cache, so this is cpu cost;
+// on a disk the smaller file also saves the transfer. link with -lz
+
+const size_t DEFAULT_CAPACITY_LOG2 = 24;
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static double file_mib(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size / double(1 << 20) : 0;
+}
+
+int main(int argc, char* argv[]) {
+    const std::string dir = argc > 1 ? argv[1] : "/tmp";
+    const size_t capacity_log2 = argc > 2 ? std::stoull(argv[2]) : DEFAULT_CAPACITY_LOG2;
+    CompressedSnapshotConfig config;
+    config.threads = argc > 3 ? std::stoull(argv[3]) : 0;
+    const std::string raw_path = dir + "/snapshot_format_benchmark.raw";
+    const std::string compressed_path = dir + "/snapshot_format_benchmark.oatc";
+    const size_t capacity = size_t(1) << capacity_log2;
+
+    std::cout << "capacity " << capacity << ", " << snapshot_threads(config.threads) << " threads\n\n"
+              << std::setw(22) << "table" << std::setw(8) << "format" << std::setw(10) << "MiB"
+              << std::setw(10) << "save ms" << std::setw(10) << "load ms" << "\n";
+
+    struct Shape {
+        const char* name;
+        double load;
+        bool sequential;
+    };
+    for (const Shape& shape : {Shape{"dense sequential ids", 0.7, true}, Shape{"dense random keys", 0.7, false},
+                               Shape{"sparse sequential ids", 0.05, true}, Shape{"sparse random keys", 0.05, false}}) {
+        OpenAddressTable table(capacity);
+        std::mt19937_64 gen(42);
+        const size_t live = static_cast<size_t>(capacity * shape.load);
+        for (size_t i = 0; i < live; i++) {
+            table.insert(shape.sequential ? 1'000'000 + i : gen(), gen() % 10000);
+        }
+
+        auto start = Clock::now();
+        save_snapshot(table, raw_path);
+        const double raw_save = ms_since(start);
+        start = Clock::now();
+        const size_t raw_size = load_snapshot(raw_path).size();
+        const double raw_load = ms_since(start);
+
+        start = Clock::now();
+        save_compressed_snapshot(table, compressed_path, 0, config);
+        const double compressed_save = ms_since(start);
+        start = Clock::now();
+        const size_t compressed_size = load_compressed_snapshot(compressed_path, nullptr, config).size();
+        const double compressed_load = ms_since(start);
+        if (raw_size != live || compressed_size != live) {
+            std::cerr << "size mismatch after load\n";
+            return 1;
+        }
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::setw(22) << shape.name << std::setw(8) << "raw" << std::setw(10) << file_mib(raw_path)
+                  << std::setw(10) << raw_save << std::setw(10) << raw_load << "\n"
+                  << std::setw(22) << "" << std::setw(8) << "oatc" << std::setw(10) << file_mib(compressed_path)
+                  << std::setw(10) << compressed_save << std::setw(10) << compressed_load << "\n";
+    }
+
+    std::remove(raw_path.c_str());
+    std::remove(compressed_path.c_str());
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <random>
+#include "snapshot.cpp"
+
+class SnapshotTest : public ::testing::Test {
+protected:
+    std::string path;
+
+    void SetUp() override {
+        path = ::testing::TempDir() + "oat_snapshot_test.bin";
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+};
+
+TEST_F(SnapshotTest, RoundTripsSlotArray) {
+    OpenAddressTable table(16);
+    std::mt19937_64 gen(42);
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i < 10000; i++) {
+        keys.push_back(gen());
+        table.insert(keys.back(), i);
+    }
+    table.erase(keys[0]);
+    save_snapshot(table, path, 1234);
+
+    uint64_t lsn = 0;
+    OpenAddressTable loaded = load_snapshot(path, &lsn);
+    EXPECT_EQ(lsn, 1234);
+    EXPECT_EQ(loaded.size(), table.size());
+    EXPECT_EQ(loaded.capacity(), table.capacity());
+    EXPECT_FALSE(loaded.get(keys[0]).has_value());
+    for (size_t i = 1; i < keys.size(); i++) {
+        EXPECT_EQ(loaded.get(keys[i]), std::optional<uint64_t>(i));
+    }
+
+    // the loaded table is a normal table, it keeps growing
+    loaded.insert(keys[0], 0);
+    EXPECT_EQ(loaded.size(), keys.size());
+}
+
+TEST_F(SnapshotTest, RejectsCorruptOrTruncatedFiles) {
+    OpenAddressTable table(64);
+    for (uint64_t key = 0; key < 40; key++) {
+        table.insert(key, key);
+    }
+    save_snapshot(table, path);
+
+    {
+        FILE* file = std::fopen(path.c_str(), "r+b");
+        std::fseek(file, -5, SEEK_END);
+        std::fputc(0x7f, file);
+        std::fclose(file);
+    }
+    EXPECT_THROW(load_snapshot(path), std::runtime_error);
+
+    save_snapshot(table, path);
+    ASSERT_EQ(truncate(path.c_str(), sizeof(SnapshotHeader) + 100), 0);
+    EXPECT_THROW(load_snapshot(path), std::runtime_error);
+
+    EXPECT_THROW(load_snapshot(path + ".missing"), std::system_error);
+}
+
+TEST_F(SnapshotTest, AsyncSnapshotIsFrozenAtTheCall) {
+    OpenAddressTable table(64);
+    for (uint64_t key = 1; key <= 50000; key++) {
+        table.insert(key, key);
+    }
+
+    size_t last_written = 0;
+    size_t progress_total = 0;
+    std::atomic<bool> done_called{false};
+    auto job = snapshot_async(
+            table, path, 77,
+            [&](size_t written, size_t total) {
+                EXPECT_GE(written, last_written);
+                last_written = written;
+                progress_total = total;
+            },
+            [&](std::error_code error) {
+                EXPECT_FALSE(error);
+                done_called = true;
+            });
+
+    // the parent keeps writing while the child dumps the old image
+    for (uint64_t key = 1; key <= 50000; key++) {
+        table.insert(key, key + 1);
+    }
+    table.insert(100000, 1);
+
+    EXPECT_FALSE(job->wait());
+    EXPECT_TRUE(job->finished());
+    EXPECT_TRUE(done_called);
+    EXPECT_EQ(progress_total, job->total_bytes());
+    EXPECT_EQ(last_written, job->total_bytes());
+
+    uint64_t lsn = 0;
+    OpenAddressTable loaded = load_snapshot(path, &lsn);
+    EXPECT_EQ(lsn, 77);
+    EXPECT_EQ(loaded.size(), 50000);
+    EXPECT_FALSE(loaded.get(100000).has_value());
+    for (uint64_t key = 1; key <= 50000; key++) {
+        ASSERT_EQ(loaded.get(key), std::optional<uint64_t>(key));
+    }
+}
+
+TEST_F(SnapshotTest, AsyncSnapshotReportsFailure) {
+    OpenAddressTable table(64);
+    table.insert(1, 1);
+    std::error_code reported;
+    auto job = snapshot_async(table, ::testing::TempDir() + "missing_dir/snapshot.bin", 0, {},
+                              [&](std::error_code error) { reported = error; });
+    EXPECT_EQ(job->wait(), std::errc::no_such_file_or_directory);
+    EXPECT_EQ(reported, std::errc::no_such_file_or_directory);
+}
@@ -0,0 +1,127 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "table.cpp"
+#include "stats.cpp"
+
+// usage: soak_benchmark [capacity_log2] [load_factor] [epochs] [ops_per_epoch]
+//
+// holds the table at a fixed size and churns it with erase + insert pairs, so
+// the table never resizes and any slowdown has to come from how backward-shift
+// deletion and robin-hood displacement leave the slot array over time.
+// defaults are 2^22 slots at 0.74 load for 200 epochs of 50M ops, which at
+// production rates is several days of churn on one shard
+
+const size_t DEFAULT_CAPACITY_LOG2 = 22;
+const double DEFAULT_LOAD_FACTOR = 0.74;
+const size_t DEFAULT_EPOCHS = 200;
+const size_t DEFAULT_OPS_PER_EPOCH = 50'000'000;
+// lookups per erase + insert pair, keeps the sampled throughput representative of a read-heavy service
+const size_t LOOKUPS_PER_CHURN = 4;
+// drift beyond this between the first and last window is reported as a failure
+const double DRIFT_THRESHOLD = 0.10;
+
+// the sum of every looked-up value lands here so the lookups are not optimised away
+static std::atomic<uint64_t> checksum{0};
+
+struct EpochSample {
+    double ns_per_op;
+    ProbeStats probes;
+};
+
+int main(int argc, char* argv[]) {
+    const size_t capacity_log2 = argc > 1 ? std::stoull(argv[1]) : DEFAULT_CAPACITY_LOG2;
+    const double target_load = argc > 2 ? std::stod(argv[2]) : DEFAULT_LOAD_FACTOR;
+    const size_t epochs = argc > 3 ? std::stoull(argv[3]) : DEFAULT_EPOCHS;
+    const size_t ops_per_epoch = argc > 4 ? std::stoull(argv[4]) : DEFAULT_OPS_PER_EPOCH;
+
+    const size_t capacity = size_t(1) << capacity_log2;
+    const size_t live = static_cast<size_t>(capacity * std::min(target_load, OpenAddressTable::LOAD_FACTOR_THRESHOLD - 0.01));
+
+    OpenAddressTable hashmap(capacity);
+    std::mt19937_64 generator(42);
+    std::vector<uint64_t> keys(live);
+
+    // the churn loop relies on distinct keys, so only count inserts that grew the table
+    while (hashmap.size() < live) {
+        const uint64_t key = generator();
+        const size_t before = hashmap.size();
+        hashmap.insert(key, key);
+        if (hashmap.size() > before) {
+            keys[before] = key;
+        }
+    }
+
+    std::cout << "capacity " << capacity << ", live " << live
+              << ", load " << std::fixed << std::setprecision(3) << hashmap.load_factor() << "\n\n"
+              << std::setw(6) << "epoch" << std::setw(12) << "ns/op"
+              << std::setw(12) << "mean dist" << std::setw(10) << "max dist"
+              << std::setw(10) << "max run" << "\n";
+
+    std::vector<EpochSample> samples;
+    std::uniform_int_distribution<size_t> pick(0, live - 1);
+    uint64_t sink = 0;
+
+    for (size_t epoch = 0; epoch < epochs; ++epoch) {
+        const size_t pairs = ops_per_epoch / (2 + LOOKUPS_PER_CHURN);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < pairs; ++i) {
+            const size_t slot = pick(generator);
+            hashmap.erase(keys[slot]);
+            keys[slot] = generator();
+            hashmap.insert(keys[slot], i);
+
+            for (size_t j = 0; j < LOOKUPS_PER_CHURN; ++j) {
+                sink += hashmap.get(keys[pick(generator)]).value_or(0);
+            }
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        EpochSample sample{
+                std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count() /
+                static_cast<double>(pairs * (2 + LOOKUPS_PER_CHURN)),
+                hashmap.probe_stats()
+        };
+        samples.push_back(sample);
+
+        std::cout << std::setw(6) << epoch << std::setw(12) << std::setprecision(2) << sample.ns_per_op
+                  << std::setw(12) << std::setprecision(3) << sample.probes.mean_dist
+                  << std::setw(10) << sample.probes.max_dist
+                  << std::setw(10) << sample.probes.longest_run << "\n";
+    }
+
+    if (hashmap.size() != live) {
+        std::cerr << "size drifted from " << live << " to " << hashmap.size() << "\n";
+        return 1;
+    }
+
+    // compare the first and last tenth of the run so a single noisy epoch cannot decide the verdict
+    const size_t window = std::max<size_t>(1, samples.size() / 10);
+    std::vector<double> first, last;
+    double first_dist = 0, last_dist = 0;
+    for (size_t i = 0; i < window; ++i) {
+        first.push_back(samples[i].ns_per_op);
+        last.push_back(samples[samples.size() - window + i].ns_per_op);
+        first_dist += samples[i].probes.mean_dist / window;
+        last_dist += samples[samples.size() - window + i].probes.mean_dist / window;
+    }
+    auto first_stats = calculate_stats(first);
+    auto last_stats = calculate_stats(last);
+
+    const double drift = last_stats.median / first_stats.median - 1.0;
+    std::cout << "\nfirst window median: " << std::setprecision(2) << first_stats.median << " ns/op"
+              << ", mean dist " << std::setprecision(3) << first_dist << "\n"
+              << "last window median:  " << std::setprecision(2) << last_stats.median << " ns/op"
+              << ", mean dist " << std::setprecision(3) << last_dist << "\n"
+              << "throughput drift:    " << std::showpos << std::setprecision(1) << drift * 100 << "%"
+              << std::noshowpos << (std::abs(drift) > DRIFT_THRESHOLD ? "  FAIL" : "  ok") << "\n";
+
+    checksum = sink;
+    return std::abs(drift) > DRIFT_THRESHOLD ? 1 : 0;
+}
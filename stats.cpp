@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+struct Statistics {
+    double mean;
+    double median;
+    double p95;
+    double min;
+    double max;
+};
+
+Statistics calculate_stats(std::vector<double>& measurements) {
+    if (measurements.empty()) return {0, 0, 0, 0, 0};
+
+    std::sort(measurements.begin(), measurements.end());
+
+    double sum = std::accumulate(measurements.begin(), measurements.end(), 0.0);
+    double mean = sum / measurements.size();
+    double median = measurements.size() % 2 == 0
+                    ? (measurements[measurements.size()/2 - 1] + measurements[measurements.size()/2]) / 2
+                    : measurements[measurements.size()/2];
+
+    size_t p95_index = static_cast<size_t>(measurements.size() * 0.95);
+    double p95 = measurements[p95_index];
+
+    return {
+            mean,
+            median,
+            p95,
+            measurements.front(),
+            measurements.back()
+    };
+}
+
+// nearest-rank percentile over an already sorted sample, q in [0, 1]
+double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * q));
+    return sorted[index];
+}
@@ -1,8 +1,12 @@
 //
 // Created by Devang Jaiswal on 11/2/24.
 //
+#pragma once
 #include <vector>
 #include <optional>
+#include <algorithm>
+#include <iterator>
+#include <utility>
 #include "xxhash/xxhash.h"
 
 struct Entry {
@@ -13,6 +17,25 @@ struct Entry {
     // 0 for empty, 2 for filled 
 } __attribute__((packed, aligned(16)));
 
+struct ProbeStats {
+    double mean_dist;
+    size_t max_dist;
+    // longest run of consecutive filled slots, what a miss or backward shift has to walk
+    size_t longest_run;
+};
+
+// what turns one table into another: keys to add, keys whose value changes
+// (with the new value) and keys to drop
+struct TableDelta {
+    std::vector<std::pair<uint64_t, uint64_t>> inserted_;
+    std::vector<std::pair<uint64_t, uint64_t>> updated_;
+    std::vector<uint64_t> removed_;
+
+    size_t size() const { return inserted_.size() + updated_.size() + removed_.size(); }
+
+    bool empty() const { return size() == 0; }
+};
+
 class OpenAddressTable {
 public:
     // ensure the vector stats at the 64 byte cache line boundary
@@ -60,9 +83,25 @@ public:
             data_.resize(16);
             return;
         }
+        rehash(data_.size() * 2);
+    }
 
+    // grows the table once so n entries fit under the load threshold, instead of
+    // doubling log2(n / capacity) times on the way there
+    void reserve(size_t n) {
+        size_t new_size = std::max(data_.size(), size_t(16));
+        while (n > new_size * LOAD_FACTOR_THRESHOLD) {
+            new_size *= 2;
+        }
+        if (data_.empty()) {
+            data_.resize(new_size);
+        } else if (new_size > data_.size()) {
+            rehash(new_size);
+        }
+    }
+
+    void rehash(size_t new_size) {
         const size_t old_size = data_.size();
-        const size_t new_size = old_size * 2;
 
         std::vector<Entry> new_data(new_size);
 
@@ -95,13 +134,13 @@ public:
 
         while (true) {
             if (new_data[pos].status_ == 0) {
-                new_data[pos] = Entry{key, val, static_cast<uint8_t>(probe_dist), 2};
+                new_data[pos] = Entry{key, val, static_cast<uint16_t>(probe_dist), 2};
                 ++size_;
                 return;
             }
 
             if (probe_dist > new_data[pos].probe_dist_) {
-                Entry entry{key, val, static_cast<uint8_t>(probe_dist), 2};
+                Entry entry{key, val, static_cast<uint16_t>(probe_dist), 2};
                 std::swap(entry, new_data[pos]);
                 key = entry.key_;
                 val = entry.val_;
@@ -127,6 +166,36 @@ public:
             __builtin_prefetch(&data_[pos + i * CACHE_LINE_SIZE], 1, 3);
         }
 
+        return insert_at(pos, key, val);
+    }
+
+    // inserts n pairs the way get_batch looks them up: a group's home slots are
+    // hashed and prefetched for writing before any of them is probed. the table
+    // grows ahead of a group rather than inside it, so the homes stay valid
+    void insert_batch(const uint64_t* keys, const uint64_t* vals, size_t n) {
+        size_t homes[BATCH_GROUP_SIZE];
+
+        for (size_t base = 0; base < n; base += BATCH_GROUP_SIZE) {
+            const size_t count = std::min(BATCH_GROUP_SIZE, n - base);
+            while (data_.empty() || size_ + count > data_.size() * LOAD_FACTOR_THRESHOLD) {
+                resize();
+            }
+
+            const size_t mask = data_.size() - 1;
+            for (size_t i = 0; i < count; ++i) {
+                homes[i] = hash_key(keys[base + i]) & mask;
+                __builtin_prefetch(&data_[homes[i]], 1, 3);
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                insert_at(homes[i], keys[base + i], vals[base + i]);
+            }
+        }
+    }
+
+    // robin-hood insert starting from the key's home slot
+    __attribute__((always_inline))
+    bool insert_at(size_t pos, uint64_t key, uint64_t val) {
         Entry entry{key, val, 0, 2};
         size_t probe_dist = 0;
 
@@ -151,7 +220,7 @@ public:
 
             pos = next_probe_position(pos);
             ++probe_dist;
-            entry.probe_dist_ = static_cast<uint8_t>(probe_dist);
+            entry.probe_dist_ = static_cast<uint16_t>(probe_dist);
         }
     }
 
@@ -171,7 +240,7 @@ public:
         while (true) {
             if (data_[pos].status_ == 2) {
                 if (data_[pos].key_ == key) {
-                    return data_[pos].val_;
+                    return static_cast<uint64_t>(data_[pos].val_);
                 }
 
                 if (probe_dist > data_[pos].probe_dist_) {
@@ -187,6 +256,49 @@ public:
         }
     }
 
+    // looks up n keys into out[0..n). every home slot in a group is hashed and prefetched
+    // before any of them is probed, so the cache misses of a batch overlap instead of
+    // being paid one after another
+    static constexpr size_t BATCH_GROUP_SIZE = 16;
+
+    void get_batch(const uint64_t* keys, size_t n, std::optional<uint64_t>* out) {
+        if (data_.empty()) {
+            std::fill(out, out + n, std::nullopt);
+            return;
+        }
+
+        const size_t mask = data_.size() - 1;
+        size_t homes[BATCH_GROUP_SIZE];
+
+        for (size_t base = 0; base < n; base += BATCH_GROUP_SIZE) {
+            const size_t count = std::min(BATCH_GROUP_SIZE, n - base);
+
+            for (size_t i = 0; i < count; ++i) {
+                homes[i] = hash_key(keys[base + i]) & mask;
+                __builtin_prefetch(&data_[homes[i]], 0, 3);
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                const uint64_t key = keys[base + i];
+                size_t pos = homes[i];
+                size_t probe_dist = 0;
+                out[base + i] = std::nullopt;
+
+                while (data_[pos].status_ == 2) {
+                    if (data_[pos].key_ == key) {
+                        out[base + i] = static_cast<uint64_t>(data_[pos].val_);
+                        break;
+                    }
+                    if (probe_dist > data_[pos].probe_dist_) {
+                        break;
+                    }
+                    pos = (pos + 1) & mask;
+                    ++probe_dist;
+                }
+            }
+        }
+    }
+
     __attribute__((always_inline))
     bool erase(uint64_t key) {
         if (data_.empty()) {
@@ -239,6 +351,251 @@ public:
     double load_factor() const {
         return data_.empty() ? 0.0 : static_cast<double>(size_) / data_.size();
     }
+
+    // displacement is recomputed from the hash rather than read from probe_dist_,
+    // so the numbers stay honest even if the stored field has wrapped
+    ProbeStats probe_stats() const {
+        if (data_.empty() || size_ == 0) {
+            return {0.0, 0, 0};
+        }
+
+        const size_t mask = data_.size() - 1;
+        size_t total = 0;
+        size_t max_dist = 0;
+        size_t longest_run = 0;
+        size_t run = 0;
+
+        for (size_t i = 0; i < data_.size(); ++i) {
+            if (data_[i].status_ != 2) {
+                run = 0;
+                continue;
+            }
+            const size_t dist = (i - (hash_key(data_[i].key_) & mask)) & mask;
+            total += dist;
+            max_dist = std::max(max_dist, dist);
+            longest_run = std::max(longest_run, ++run);
+        }
+
+        return {static_cast<double>(total) / size_, max_dist, longest_run};
+    }
+
+    // the changes that make this table equal to other. robin-hood keeps every
+    // cluster sorted by home slot, so at equal capacity both arrays are read once,
+    // front to back, and merged by home like two sorted lists; only entries that
+    // share a home are compared against each other. a table of different capacity
+    // is first rehashed to match, which is one more linear pass
+    TableDelta diff(const OpenAddressTable& other) const {
+        if (data_.size() != other.data_.size()) {
+            if (data_.size() < other.data_.size()) {
+                OpenAddressTable grown(*this);
+                grown.rehash(other.data_.size());
+                return grown.diff(other);
+            }
+            OpenAddressTable grown(other);
+            grown.rehash(data_.size());
+            return diff(grown);
+        }
+
+        TableDelta delta;
+        HomeOrderCursor mine(data_);
+        HomeOrderCursor theirs(other.data_);
+        std::vector<const Entry*> my_group;
+        std::vector<const Entry*> their_group;
+
+        while (mine.entry_ != nullptr || theirs.entry_ != nullptr) {
+            const size_t home = mine.entry_ == nullptr     ? theirs.home_
+                                : theirs.entry_ == nullptr ? mine.home_
+                                                           : std::min(mine.home_, theirs.home_);
+            mine.take_group(home, my_group);
+            theirs.take_group(home, their_group);
+
+            for (const Entry* entry : my_group) {
+                auto match = std::find_if(their_group.begin(), their_group.end(),
+                                          [&](const Entry* e) { return e != nullptr && e->key_ == entry->key_; });
+                if (match == their_group.end()) {
+                    delta.removed_.push_back(entry->key_);
+                    continue;
+                }
+                if ((*match)->val_ != entry->val_) {
+                    delta.updated_.emplace_back(entry->key_, (*match)->val_);
+                }
+                *match = nullptr;
+            }
+            for (const Entry* entry : their_group) {
+                if (entry != nullptr) {
+                    delta.inserted_.emplace_back(entry->key_, entry->val_);
+                }
+            }
+        }
+        return delta;
+    }
+
+    // applies a delta from diff(). the table is sized once for the inserted
+    // keys; updated keys are found and assigned in place, so they never count
+    // against the load factor. an updated key that is missing (a delta built
+    // against another base) goes through insert(), which grows the table as needed
+    void apply_delta(const TableDelta& delta) {
+        for (uint64_t key : delta.removed_) {
+            erase(key);
+        }
+        reserve(size_ + delta.inserted_.size());
+
+        uint64_t keys[BATCH_GROUP_SIZE * 16];
+        uint64_t vals[BATCH_GROUP_SIZE * 16];
+        for (size_t base = 0; base < delta.inserted_.size(); base += std::size(keys)) {
+            const size_t count = std::min(std::size(keys), delta.inserted_.size() - base);
+            for (size_t i = 0; i < count; ++i) {
+                keys[i] = delta.inserted_[base + i].first;
+                vals[i] = delta.inserted_[base + i].second;
+            }
+            insert_batch(keys, vals, count);
+        }
+
+        const size_t mask = data_.size() - 1;
+        size_t homes[BATCH_GROUP_SIZE];
+        std::vector<std::pair<uint64_t, uint64_t>> missing;
+        for (size_t base = 0; base < delta.updated_.size(); base += BATCH_GROUP_SIZE) {
+            const size_t count = std::min(BATCH_GROUP_SIZE, delta.updated_.size() - base);
+            for (size_t i = 0; i < count; ++i) {
+                homes[i] = hash_key(delta.updated_[base + i].first) & mask;
+                __builtin_prefetch(&data_[homes[i]], 1, 3);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                const auto& [key, val] = delta.updated_[base + i];
+                size_t pos = homes[i];
+                size_t probe_dist = 0;
+                while (data_[pos].status_ == 2 && probe_dist <= data_[pos].probe_dist_ && data_[pos].key_ != key) {
+                    pos = (pos + 1) & mask;
+                    ++probe_dist;
+                }
+                if (data_[pos].status_ == 2 && data_[pos].key_ == key) {
+                    data_[pos].val_ = val;
+                } else {
+                    missing.emplace_back(key, val);
+                }
+            }
+        }
+
+        for (const auto& [key, val] : missing) {
+            insert(key, val);
+        }
+    }
+
+    // moves other's entries into this table; for a key in both, fn(key, this
+    // table's value, other's value) decides the result. the slot array of the
+    // table with more entries is kept and grown once to fit both, and the other
+    // table is streamed into it in slot order, which is home order,
+    // BATCH_GROUP_SIZE entries at a time with their homes prefetched. other is
+    // left empty
+    template <typename Fn>
+    void merge_from(OpenAddressTable&& other, Fn fn) {
+        const bool swapped = other.size_ > size_;
+        if (swapped) {
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+            std::swap(tombstone_ct_, other.tombstone_ct_);
+        }
+        reserve(size_ + other.size_);
+
+        uint64_t keys[BATCH_GROUP_SIZE];
+        uint64_t vals[BATCH_GROUP_SIZE];
+        size_t count = 0;
+        for (const Entry& entry : other.data_) {
+            if (entry.status_ != 2) continue;
+            keys[count] = entry.key_;
+            vals[count] = entry.val_;
+            if (++count == BATCH_GROUP_SIZE) {
+                merge_group(keys, vals, count, fn, swapped);
+                count = 0;
+            }
+        }
+        merge_group(keys, vals, count, fn, swapped);
+        other = OpenAddressTable();
+    }
+
+private:
+    // merge_from's insert_batch: the caller has made room for every key. swapped
+    // means the incoming values are the ones that were in this table
+    template <typename Fn>
+    void merge_group(const uint64_t* keys, const uint64_t* vals, size_t count, Fn& fn, bool swapped) {
+        const size_t mask = data_.size() - 1;
+        size_t homes[BATCH_GROUP_SIZE];
+        for (size_t i = 0; i < count; ++i) {
+            homes[i] = hash_key(keys[i]) & mask;
+            __builtin_prefetch(&data_[homes[i]], 1, 3);
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            size_t pos = homes[i];
+            size_t probe_dist = 0;
+            bool found = false;
+            while (data_[pos].status_ == 2 && probe_dist <= data_[pos].probe_dist_) {
+                if (data_[pos].key_ == keys[i]) {
+                    const uint64_t current = data_[pos].val_;
+                    data_[pos].val_ = swapped ? fn(keys[i], vals[i], current) : fn(keys[i], current, vals[i]);
+                    found = true;
+                    break;
+                }
+                pos = (pos + 1) & mask;
+                ++probe_dist;
+            }
+            if (!found) {
+                insert_at(homes[i], keys[i], vals[i]);
+            }
+        }
+    }
+
+    // walks a slot array in ascending home order, reading each home off the
+    // stored probe distance instead of rehashing. entries of a cluster that wraps
+    // past the end sit at the front of the array with homes larger than their
+    // slot; they are skipped on the first pass and visited last
+    struct HomeOrderCursor {
+        const std::vector<Entry>& data_;
+        size_t mask_;
+        size_t pos_ = 0;
+        bool wrapped_ = false;
+        const Entry* entry_ = nullptr;
+        size_t home_ = 0;
+
+        explicit HomeOrderCursor(const std::vector<Entry>& data) : data_(data), mask_(data.size() - 1) {
+            advance();
+        }
+
+        void advance() {
+            entry_ = nullptr;
+            while (pos_ < data_.size()) {
+                const Entry& entry = data_[pos_];
+                if (entry.status_ != 2) {
+                    if (wrapped_) return;
+                    ++pos_;
+                    continue;
+                }
+                const size_t home = (pos_ - entry.probe_dist_) & mask_;
+                if (wrapped_ ? home <= pos_ : home > pos_) {
+                    if (wrapped_) return;
+                    ++pos_;
+                    continue;
+                }
+                entry_ = &entry;
+                home_ = home;
+                ++pos_;
+                return;
+            }
+            if (!wrapped_) {
+                wrapped_ = true;
+                pos_ = 0;
+                advance();
+            }
+        }
+
+        void take_group(size_t home, std::vector<const Entry*>& group) {
+            group.clear();
+            while (entry_ != nullptr && home_ == home) {
+                group.push_back(entry_);
+                advance();
+            }
+        }
+    };
 };
 
 /* no inline
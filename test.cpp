@@ -179,4 +179,235 @@ TEST_F(OpenAddressTableTest, StressTest) {
         EXPECT_TRUE(result.has_value());
         EXPECT_EQ(result.value(), value);
     }
-}
\ No newline at end of file
+}
+
+TEST_F(OpenAddressTableTest, ProbeStatsMatchStoredDistances) {
+    EXPECT_EQ(table.probe_stats().max_dist, 0);
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        table.insert(i, i);
+    }
+
+    size_t stored_max = 0;
+    for (const auto& entry : table.data_) {
+        if (entry.status_ == 2) {
+            stored_max = std::max<size_t>(stored_max, entry.probe_dist_);
+        }
+    }
+
+    auto stats = table.probe_stats();
+    EXPECT_EQ(stats.max_dist, stored_max);
+    EXPECT_GT(stats.longest_run, 0);
+    EXPECT_GE(stats.mean_dist, 0.0);
+}
+
+TEST_F(OpenAddressTableTest, ProbeDistancesPast255) {
+    table = OpenAddressTable(1024);
+    const size_t mask = table.capacity() - 1;
+    std::vector<uint64_t> keys;
+
+    // 300 keys sharing one home slot push the last one 299 slots away
+    for (uint64_t key = 0; keys.size() < 300; key++) {
+        if ((OpenAddressTable::hash_key(key) & mask) == 7) {
+            keys.push_back(key);
+            EXPECT_TRUE(table.insert(key, key));
+        }
+    }
+    EXPECT_EQ(table.capacity(), 1024);
+    EXPECT_EQ(table.probe_stats().max_dist, 299);
+
+    for (auto key : keys) {
+        auto result = table.get(key);
+        EXPECT_TRUE(result.has_value());
+        EXPECT_EQ(result.value(), key);
+    }
+    for (auto key : keys) {
+        EXPECT_TRUE(table.erase(key));
+    }
+    EXPECT_TRUE(table.empty());
+}
+
+TEST_F(OpenAddressTableTest, GetBatchMatchesGet) {
+    std::mt19937_64 gen(42);
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i < 5000; i++) {
+        keys.push_back(gen());
+        table.insert(keys.back(), i);
+        // every other probe is a miss
+        keys.push_back(gen());
+    }
+
+    std::vector<std::optional<uint64_t>> results(keys.size());
+    table.get_batch(keys.data(), keys.size(), results.data());
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(results[i], table.get(keys[i]));
+    }
+    EXPECT_EQ(results[0], std::optional<uint64_t>(0));
+    EXPECT_FALSE(results[1].has_value());
+}
+
+TEST_F(OpenAddressTableTest, InsertBatchMatchesInsert) {
+    OpenAddressTable reference;
+    std::mt19937_64 gen(42);
+    std::vector<uint64_t> keys;
+    std::vector<uint64_t> vals;
+    for (size_t i = 0; i < 10000; i++) {
+        // some keys repeat, the later value must win as with insert
+        keys.push_back(i % 7 == 0 && i > 0 ? keys[i / 2] : gen());
+        vals.push_back(i);
+        reference.insert(keys.back(), i);
+    }
+
+    table.insert_batch(keys.data(), vals.data(), keys.size());
+    EXPECT_EQ(table.size(), reference.size());
+    for (uint64_t key : keys) {
+        EXPECT_EQ(table.get(key), reference.get(key));
+    }
+}
+
+TEST_F(OpenAddressTableTest, ReserveGrowsOnce) {
+    table.insert(1, 1);
+    table.reserve(100000);
+    const size_t capacity = table.capacity();
+    EXPECT_GE(capacity * OpenAddressTable::LOAD_FACTOR_THRESHOLD, 100000);
+    for (uint64_t key = 2; key <= 100000; key++) {
+        table.insert(key, key);
+    }
+    EXPECT_EQ(table.capacity(), capacity);
+    EXPECT_EQ(table.get(1), std::optional<uint64_t>(1));
+
+    // never shrinks
+    table.reserve(10);
+    EXPECT_EQ(table.capacity(), capacity);
+}
+
+TEST_F(OpenAddressTableTest, DiffAndApplyDeltaReproduceOther) {
+    std::mt19937_64 gen(42);
+    OpenAddressTable before(1 << 14);
+    for (uint64_t i = 0; i < 12000; i++) {
+        before.insert(gen() % 20000, i);
+    }
+    OpenAddressTable after = before;
+    std::unordered_set<uint64_t> touched;
+    for (uint64_t i = 0; i < 300; i++) {
+        const uint64_t key = gen() % 20000;
+        touched.insert(key);
+        if (i % 3 == 0) {
+            after.erase(key);
+        } else {
+            after.insert(key, 1000000 + i);
+        }
+    }
+    ASSERT_EQ(after.capacity(), before.capacity());
+
+    const TableDelta delta = before.diff(after);
+    EXPECT_LE(delta.size(), touched.size());
+    for (const auto& [key, val] : delta.inserted_) {
+        EXPECT_FALSE(before.get(key).has_value());
+        EXPECT_EQ(after.get(key), std::optional<uint64_t>(val));
+    }
+    for (const auto& [key, val] : delta.updated_) {
+        EXPECT_NE(before.get(key), std::optional<uint64_t>(val));
+        EXPECT_EQ(after.get(key), std::optional<uint64_t>(val));
+    }
+    for (uint64_t key : delta.removed_) {
+        EXPECT_TRUE(before.get(key).has_value());
+        EXPECT_FALSE(after.get(key).has_value());
+    }
+
+    before.apply_delta(delta);
+    EXPECT_EQ(before.size(), after.size());
+    for (uint64_t key = 0; key < 20000; key++) {
+        ASSERT_EQ(before.get(key), after.get(key));
+    }
+    EXPECT_TRUE(before.diff(after).empty());
+}
+
+TEST(OpenAddressTableDeltaTest, ApplyDeltaSizesForInsertsOnly) {
+    // 768 entries fit 1024 slots; counting the updates as new would double it
+    OpenAddressTable target(1024);
+    for (uint64_t key = 0; key < 700; key++) {
+        target.insert(key, key);
+    }
+    TableDelta delta;
+    for (uint64_t key = 700; key < 768; key++) {
+        delta.inserted_.emplace_back(key, key);
+    }
+    for (uint64_t key = 0; key < 100; key++) {
+        delta.updated_.emplace_back(key, key + 1);
+    }
+
+    target.apply_delta(delta);
+    EXPECT_EQ(target.capacity(), 1024);
+    EXPECT_EQ(target.size(), 768);
+    EXPECT_EQ(target.get(0), std::optional<uint64_t>(1));
+    EXPECT_EQ(target.get(767), std::optional<uint64_t>(767));
+}
+
+TEST(OpenAddressTableDeltaTest, ApplyDeltaInsertsMissingUpdatedKeysWithLoadCheck) {
+    // a delta diffed against another base names updated keys this table lacks
+    OpenAddressTable target(64);
+    for (uint64_t key = 0; key < 48; key++) {
+        target.insert(key, key);
+    }
+    TableDelta delta;
+    for (uint64_t key = 40; key < 200; key++) {
+        delta.updated_.emplace_back(key, key * 2);
+    }
+
+    target.apply_delta(delta);
+    EXPECT_EQ(target.size(), 200);
+    EXPECT_LE(target.load_factor(), OpenAddressTable::LOAD_FACTOR_THRESHOLD);
+    for (uint64_t key = 0; key < 200; key++) {
+        ASSERT_EQ(target.get(key), std::optional<uint64_t>(key < 40 ? key : key * 2));
+    }
+}
+
+TEST_F(OpenAddressTableTest, DiffAcrossCapacitiesAndWrappedClusters) {
+    // a small full-ish table makes clusters wrap past the end of the array
+    OpenAddressTable small(64);
+    for (uint64_t key = 0; key < 47; key++) {
+        small.insert(key, key);
+    }
+    OpenAddressTable large(1024);
+    for (uint64_t key = 10; key < 60; key++) {
+        large.insert(key, key < 40 ? key : key + 1);
+    }
+
+    for (auto [from, to] : {std::pair{&small, &large}, std::pair{&large, &small}}) {
+        OpenAddressTable copy = *from;
+        copy.apply_delta(from->diff(*to));
+        EXPECT_EQ(copy.size(), to->size());
+        for (uint64_t key = 0; key < 64; key++) {
+            ASSERT_EQ(copy.get(key), to->get(key));
+        }
+    }
+    EXPECT_TRUE(small.diff(small).empty());
+    EXPECT_EQ(small.diff(OpenAddressTable(64)).removed_.size(), 47);
+}
+
+TEST_F(OpenAddressTableTest, MergeFromResolvesConflictsEitherWay) {
+    auto combine = [](uint64_t, uint64_t mine, uint64_t theirs) { return mine * 1000 + theirs; };
+    for (bool larger_first : {true, false}) {
+        const uint64_t a_count = larger_first ? 5000 : 100;
+        const uint64_t b_count = larger_first ? 100 : 5000;
+        // the last 20 keys of a are the first 20 of b
+        OpenAddressTable a;
+        OpenAddressTable b;
+        for (uint64_t key = 0; key < a_count; key++) {
+            a.insert(key, 1);
+        }
+        for (uint64_t key = a_count - 20; key < a_count - 20 + b_count; key++) {
+            b.insert(key, 2);
+        }
+
+        a.merge_from(std::move(b), combine);
+        EXPECT_TRUE(b.empty());
+        EXPECT_EQ(a.size(), a_count + b_count - 20);
+        // the argument order follows the tables, not which array was kept
+        EXPECT_EQ(a.get(a_count - 1), std::optional<uint64_t>(1002));
+        EXPECT_EQ(a.get(0), std::optional<uint64_t>(1));
+        EXPECT_EQ(a.get(a_count - 21 + b_count), std::optional<uint64_t>(2));
+        EXPECT_LE(a.load_factor(), OpenAddressTable::LOAD_FACTOR_THRESHOLD);
+    }
+}
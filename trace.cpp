@@ -0,0 +1,204 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "table.cpp"
+
+// trace file layout:
+//   header: "OATR" magic, u8 version
+//   record: u8 op, varint key, varint val (insert only)
+// keys from real traffic are usually small or clustered, so leb128 varints
+// keep most records at 2-6 bytes instead of a fixed 17
+
+enum class TraceOp : uint8_t {
+    Insert = 0,
+    Get = 1,
+    Erase = 2
+};
+
+struct TraceRecord {
+    TraceOp op_;
+    uint64_t key_;
+    uint64_t val_;
+};
+
+static constexpr char TRACE_MAGIC[4] = {'O', 'A', 'T', 'R'};
+static constexpr uint8_t TRACE_VERSION = 1;
+
+class TraceWriter {
+public:
+    // flush to disk in 1 MiB chunks so tracing stays off the hot path
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    explicit TraceWriter(const std::string& path)
+            : out_(path, std::ios::binary | std::ios::trunc), records_(0) {
+        if (!out_) {
+            throw std::runtime_error("failed to open trace file: " + path);
+        }
+        buffer_.reserve(BUFFER_SIZE + 32);
+        buffer_.insert(buffer_.end(), TRACE_MAGIC, TRACE_MAGIC + sizeof(TRACE_MAGIC));
+        buffer_.push_back(static_cast<char>(TRACE_VERSION));
+    }
+
+    ~TraceWriter() {
+        flush();
+    }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    void record(TraceOp op, uint64_t key, uint64_t val = 0) {
+        buffer_.push_back(static_cast<char>(op));
+        put_varint(key);
+        if (op == TraceOp::Insert) {
+            put_varint(val);
+        }
+        ++records_;
+
+        if (buffer_.size() >= BUFFER_SIZE) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (!buffer_.empty()) {
+            out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            buffer_.clear();
+        }
+        out_.flush();
+    }
+
+    size_t records() const { return records_; }
+
+private:
+    std::ofstream out_;
+    std::vector<char> buffer_;
+    size_t records_;
+
+    void put_varint(uint64_t v) {
+        while (v >= 0x80) {
+            buffer_.push_back(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        buffer_.push_back(static_cast<char>(v));
+    }
+};
+
+// reads the whole trace into memory up front so replay timing measures the table, not the decoder
+std::vector<TraceRecord> load_trace(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("failed to open trace file: " + path);
+    }
+
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (bytes.size() < sizeof(TRACE_MAGIC) + 1 ||
+        std::memcmp(bytes.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        throw std::runtime_error("not a trace file: " + path);
+    }
+    if (static_cast<uint8_t>(bytes[sizeof(TRACE_MAGIC)]) != TRACE_VERSION) {
+        throw std::runtime_error("unsupported trace version in: " + path);
+    }
+
+    size_t pos = sizeof(TRACE_MAGIC) + 1;
+    auto get_varint = [&](uint64_t& out) {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (pos >= bytes.size()) {
+                return false;
+            }
+            uint8_t b = static_cast<uint8_t>(bytes[pos++]);
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) {
+                out = v;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<TraceRecord> records;
+    while (pos < bytes.size()) {
+        TraceRecord rec{static_cast<TraceOp>(bytes[pos++]), 0, 0};
+        if (rec.op_ > TraceOp::Erase || !get_varint(rec.key_) ||
+            (rec.op_ == TraceOp::Insert && !get_varint(rec.val_))) {
+            throw std::runtime_error("truncated or corrupt trace record in: " + path);
+        }
+        records.push_back(rec);
+    }
+    return records;
+}
+
+// drop-in wrapper around a live table, every call is forwarded and logged
+class TracingTable {
+public:
+    TracingTable(OpenAddressTable& table, TraceWriter& writer)
+            : table_(table), writer_(writer) {}
+
+    bool insert(uint64_t key, uint64_t val) {
+        writer_.record(TraceOp::Insert, key, val);
+        return table_.insert(key, val);
+    }
+
+    std::optional<uint64_t> get(uint64_t key) {
+        writer_.record(TraceOp::Get, key);
+        return table_.get(key);
+    }
+
+    bool erase(uint64_t key) {
+        writer_.record(TraceOp::Erase, key);
+        return table_.erase(key);
+    }
+
+    size_t size() const { return table_.size(); }
+
+    bool empty() const { return table_.empty(); }
+
+    size_t capacity() const { return table_.capacity(); }
+
+    double load_factor() const { return table_.load_factor(); }
+
+private:
+    OpenAddressTable& table_;
+    TraceWriter& writer_;
+};
+
+struct ReplayResult {
+    double ns_per_op;
+    size_t hits;
+    size_t final_size;
+};
+
+// works with anything exposing insert/get/erase/size with the OpenAddressTable signatures
+template <typename Table>
+ReplayResult replay_trace(const std::vector<TraceRecord>& records, Table& table) {
+    size_t hits = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& rec : records) {
+        switch (rec.op_) {
+            case TraceOp::Insert:
+                table.insert(rec.key_, rec.val_);
+                break;
+            case TraceOp::Get:
+                hits += table.get(rec.key_).has_value();
+                break;
+            case TraceOp::Erase:
+                hits += table.erase(rec.key_);
+                break;
+        }
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    double duration = records.empty() ? 0.0 :
+            std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count() /
+            static_cast<double>(records.size());
+
+    return {duration, hits, table.size()};
+}
@@ -0,0 +1,98 @@
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "table.cpp"
+#include "stats.cpp"
+#include "trace.cpp"
+#include "reference_tables.cpp"
+#include "cuckoo_table.cpp"
+#include "hopscotch_table.cpp"
+
+// usage:
+//   trace_replay <trace file> [runs]          replay a recorded trace against each table
+//   trace_replay --synthetic <out file> [ops] record the main.cpp mixed workload as a trace
+
+const size_t WARMUP_RUNS = 3;
+const size_t DEFAULT_MEASURED_RUNS = 5;
+
+template <typename Table>
+void run_replay(const std::vector<TraceRecord>& records, size_t measured_runs, const std::string& label) {
+    std::vector<double> measurements;
+    ReplayResult last{};
+
+    for (size_t run = 0; run < WARMUP_RUNS + measured_runs; ++run) {
+        Table table;
+        last = replay_trace(records, table);
+        if (run >= WARMUP_RUNS) {
+            measurements.push_back(last.ns_per_op);
+        }
+    }
+
+    auto stats = calculate_stats(measurements);
+    std::cout << label << ":\n"
+              << "  Final size: " << last.final_size << ", hits: " << last.hits << "\n"
+              << "  Mean: " << std::fixed << std::setprecision(2) << stats.mean << " ns/op\n"
+              << "  Median: " << stats.median << " ns/op\n"
+              << "  P95: " << stats.p95 << " ns/op\n"
+              << "  Min/Max: " << stats.min << " / " << stats.max << " ns/op\n\n";
+}
+
+int record_synthetic(const std::string& path, size_t ops) {
+    const size_t size = 1'000'000;
+
+    OpenAddressTable hashmap;
+    TraceWriter writer(path);
+    TracingTable traced(hashmap, writer);
+
+    std::minstd_rand generator(42);
+    std::uniform_int_distribution<int> uniform_distribution(2, size);
+
+    for (size_t i = 0; i < size; ++i) {
+        traced.insert(uniform_distribution(generator), 0);
+    }
+
+    generator.seed(42);
+    for (size_t i = 0; i < ops; ++i) {
+        const uint64_t value = uniform_distribution(generator);
+        if (!traced.get(value).has_value()) {
+            traced.insert(value, 0);
+        } else {
+            traced.erase(value);
+        }
+    }
+
+    writer.flush();
+    std::cout << "recorded " << writer.records() << " ops to " << path << "\n";
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 3 && std::string(argv[1]) == "--synthetic") {
+        size_t ops = argc >= 4 ? std::stoull(argv[3]) : 10'000'000;
+        return record_synthetic(argv[2], ops);
+    }
+
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <trace file> [runs]\n"
+                  << "       " << argv[0] << " --synthetic <out file> [ops]\n";
+        return 1;
+    }
+
+    size_t measured_runs = argc >= 3 ? std::stoull(argv[2]) : DEFAULT_MEASURED_RUNS;
+    auto records = load_trace(argv[1]);
+    std::cout << "loaded " << records.size() << " ops from " << argv[1] << "\n\n";
+
+    run_replay<OpenAddressTable>(records, measured_runs, "OpenAddressTable");
+    run_replay<LinearProbingTable>(records, measured_runs, "LinearProbingTable");
+    run_replay<QuadraticProbingTable>(records, measured_runs, "QuadraticProbingTable");
+    run_replay<CuckooTable>(records, measured_runs, "CuckooTable");
+    run_replay<BucketizedCuckooTable>(records, measured_runs, "BucketizedCuckooTable");
+    run_replay<HopscotchTable>(records, measured_runs, "HopscotchTable");
+    run_replay<SwissTable>(records, measured_runs, "SwissTable");
+    run_replay<UnorderedMapTable>(records, measured_runs, "std::unordered_map");
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <unordered_map>
+#include "trace.cpp"
+
+class TraceTest : public ::testing::Test {
+protected:
+    std::string path;
+
+    void SetUp() override {
+        path = ::testing::TempDir() + "oat_trace_test.bin";
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+};
+
+TEST_F(TraceTest, RoundTripsRecords) {
+    OpenAddressTable table(16);
+    {
+        TraceWriter writer(path);
+        TracingTable traced(table, writer);
+        traced.insert(1, 100);
+        traced.insert(UINT64_MAX, UINT64_MAX);
+        traced.get(1);
+        traced.erase(1);
+        traced.get(42);
+    }
+
+    auto records = load_trace(path);
+    ASSERT_EQ(records.size(), 5);
+    EXPECT_EQ(records[0].op_, TraceOp::Insert);
+    EXPECT_EQ(records[0].key_, 1);
+    EXPECT_EQ(records[0].val_, 100);
+    EXPECT_EQ(records[1].key_, UINT64_MAX);
+    EXPECT_EQ(records[1].val_, UINT64_MAX);
+    EXPECT_EQ(records[2].op_, TraceOp::Get);
+    EXPECT_EQ(records[3].op_, TraceOp::Erase);
+    EXPECT_EQ(records[4].key_, 42);
+}
+
+TEST_F(TraceTest, ReplayReproducesState) {
+    OpenAddressTable live(16);
+    {
+        TraceWriter writer(path);
+        TracingTable traced(live, writer);
+        for (uint64_t i = 0; i < 1000; i++) {
+            traced.insert(i, i * 3);
+            if (i % 4 == 0) {
+                traced.erase(i / 2);
+            }
+        }
+    }
+
+    OpenAddressTable replayed(16);
+    auto result = replay_trace(load_trace(path), replayed);
+    EXPECT_EQ(result.final_size, live.size());
+    for (uint64_t i = 0; i < 1000; i++) {
+        EXPECT_EQ(replayed.get(i), live.get(i));
+    }
+}
+
+TEST_F(TraceTest, RejectsCorruptFile) {
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "nope";
+    }
+    EXPECT_THROW(load_trace(path), std::runtime_error);
+}
@@ -0,0 +1,584 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "table.cpp"
+#include "snapshot.cpp"
+
+// write-ahead log file layout:
+//   header: "OATW" magic, u8 version
+//   block:  u32 payload bytes, u32 record count, u64 lsn of the first record,
+//           u64 xxh64 of the payload, then the payload
+//   record: u8 op, varint key, varint val (insert only)
+// one block is one group commit: a single write and a single fdatasync. records
+// in a block have consecutive lsns. a crash can tear the last block, so recovery
+// stops at the first block that is short or fails its checksum and the log is
+// truncated back to there before anything new is appended.
+
+enum class WalOp : uint8_t {
+    Insert = 1,
+    Erase = 2
+};
+
+struct WalRecord {
+    uint64_t lsn_;
+    WalOp op_;
+    uint64_t key_;
+    uint64_t val_;
+};
+
+static constexpr char WAL_MAGIC[4] = {'O', 'A', 'T', 'W'};
+static constexpr uint8_t WAL_VERSION = 1;
+static constexpr size_t WAL_HEADER_SIZE = sizeof(WAL_MAGIC) + 1;
+
+struct WalBlockHeader {
+    uint32_t payload_bytes_;
+    uint32_t count_;
+    uint64_t first_lsn_;
+    uint64_t checksum_;
+};
+
+struct WalConfig {
+    // a group is written once it holds this many bytes ...
+    size_t group_bytes = 256 * 1024;
+    // ... or its oldest record has waited this long. a caller waiting on an lsn
+    // does not wait for either, its group goes out as soon as the disk is free
+    std::chrono::microseconds group_delay{1000};
+    // inserts and erases return only once their record is on disk. off, an
+    // acknowledged write can be lost for up to group_delay after a crash
+    bool synchronous_commit = true;
+    // fdatasync every group; off only to measure what the sync costs
+    bool sync = true;
+    // submit each group's write and fdatasync as one linked io_uring request,
+    // one syscall instead of two; ignored where no ring is available
+    bool use_io_uring = false;
+};
+
+struct WalContents {
+    std::vector<WalRecord> records_;
+    // length of the intact prefix, where appending resumes
+    size_t valid_bytes_;
+    // a short or corrupt block was dropped from the tail
+    bool torn_;
+};
+
+// a missing file reads as an empty log
+inline WalContents read_wal(const std::string& path) {
+    WalContents contents{{}, 0, false};
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) return contents;
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+
+    std::string bytes;
+    char chunk[1 << 16];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "read " + path);
+        }
+        bytes.append(chunk, n);
+    }
+    close(fd);
+
+    if (bytes.empty()) {
+        return contents;
+    }
+    if (bytes.size() < WAL_HEADER_SIZE || std::memcmp(bytes.data(), WAL_MAGIC, sizeof(WAL_MAGIC)) != 0) {
+        throw std::runtime_error("not a write-ahead log: " + path);
+    }
+    if (static_cast<uint8_t>(bytes[sizeof(WAL_MAGIC)]) != WAL_VERSION) {
+        throw std::runtime_error("unsupported write-ahead log version in: " + path);
+    }
+
+    size_t pos = WAL_HEADER_SIZE;
+    contents.valid_bytes_ = pos;
+    while (pos < bytes.size()) {
+        WalBlockHeader header;
+        if (bytes.size() - pos < sizeof(header)) {
+            contents.torn_ = true;
+            break;
+        }
+        std::memcpy(&header, bytes.data() + pos, sizeof(header));
+        const size_t payload_pos = pos + sizeof(header);
+        if (bytes.size() - payload_pos < header.payload_bytes_ ||
+            XXH64(bytes.data() + payload_pos, header.payload_bytes_, 0) != header.checksum_) {
+            contents.torn_ = true;
+            break;
+        }
+
+        const char* payload = bytes.data() + payload_pos;
+        size_t offset = 0;
+        const size_t first_record = contents.records_.size();
+        bool intact = true;
+        for (uint32_t i = 0; i < header.count_ && intact; ++i) {
+            WalRecord record{header.first_lsn_ + i, static_cast<WalOp>(0), 0, 0};
+            if (offset >= header.payload_bytes_) {
+                intact = false;
+                break;
+            }
+            record.op_ = static_cast<WalOp>(payload[offset++]);
+            intact = (record.op_ == WalOp::Insert || record.op_ == WalOp::Erase) &&
+                     get_varint(payload, header.payload_bytes_, offset, record.key_) &&
+                     (record.op_ != WalOp::Insert || get_varint(payload, header.payload_bytes_, offset, record.val_));
+            contents.records_.push_back(record);
+        }
+        if (!intact || offset != header.payload_bytes_) {
+            // checksummed but unparseable means a writer bug, not a torn write
+            contents.records_.resize(first_record);
+            throw std::runtime_error("corrupt write-ahead log block in: " + path);
+        }
+        pos = payload_pos + header.payload_bytes_;
+        contents.valid_bytes_ = pos;
+    }
+    return contents;
+}
+
+class WriteAheadLog {
+public:
+    // opens or creates the log. an existing log is cut back to valid_bytes, its
+    // intact prefix as found by read_wal, and appended to from next_lsn
+    WriteAheadLog(const std::string& path, WalConfig config = {}, uint64_t next_lsn = 1, size_t valid_bytes = 0)
+            : path_(path), config_(config), next_lsn_(next_lsn), pending_first_lsn_(next_lsn),
+              pending_count_(0), durable_lsn_(next_lsn - 1), flush_requested_(false), stopping_(false),
+              error_(0), groups_(0) {
+        fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        if (config_.use_io_uring) {
+            ring_ = IoUring::create(2);
+            if (ring_ && !ring_->supports_current_position()) {
+                ring_.reset();
+            }
+        }
+        if (valid_bytes < WAL_HEADER_SIZE) {
+            if (ftruncate(fd_, 0) < 0) {
+                const int error = errno;
+                close(fd_);
+                throw std::system_error(error, std::generic_category(), "truncate " + path);
+            }
+            write_header();
+        } else if (ftruncate(fd_, valid_bytes) < 0 || lseek(fd_, valid_bytes, SEEK_SET) < 0) {
+            const int error = errno;
+            close(fd_);
+            throw std::system_error(error, std::generic_category(), "truncate " + path);
+        }
+        flusher_ = std::thread([this] { flush_loop(); });
+    }
+
+    ~WriteAheadLog() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_cv_.notify_one();
+        flusher_.join();
+        close(fd_);
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // buffers the record and returns its lsn without waiting for the disk
+    uint64_t append(WalOp op, uint64_t key, uint64_t val = 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        check_error();
+        pending_.push_back(static_cast<char>(op));
+        put_varint(pending_, key);
+        if (op == WalOp::Insert) {
+            put_varint(pending_, val);
+        }
+        if (pending_count_++ == 0) {
+            pending_since_ = std::chrono::steady_clock::now();
+            work_cv_.notify_one();
+        } else if (pending_.size() >= config_.group_bytes) {
+            work_cv_.notify_one();
+        }
+        return next_lsn_++;
+    }
+
+    // blocks until the record with this lsn, and everything before it, is durable
+    void wait_durable(uint64_t lsn) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (durable_lsn_ >= lsn) {
+            return;
+        }
+        flush_requested_ = true;
+        work_cv_.notify_one();
+        durable_cv_.wait(lock, [&] { return durable_lsn_ >= lsn || error_ != 0; });
+        check_error();
+    }
+
+    // makes everything appended so far durable
+    void flush() {
+        uint64_t last;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            last = next_lsn_ - 1;
+        }
+        wait_durable(last);
+    }
+
+    // drops every record, for use right after a snapshot that contains them all.
+    // lsns keep counting up so the snapshot's lsn stays comparable to new records
+    void reset() {
+        flush();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ftruncate(fd_, 0) < 0 || lseek(fd_, 0, SEEK_SET) < 0) {
+            throw std::system_error(errno, std::generic_category(), "truncate " + path_);
+        }
+        write_header();
+        if (config_.sync) fdatasync(fd_);
+    }
+
+    uint64_t durable_lsn() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return durable_lsn_;
+    }
+
+    uint64_t last_lsn() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return next_lsn_ - 1;
+    }
+
+    size_t groups_written() const { return groups_.load(std::memory_order_relaxed); }
+
+    const WalConfig& config() const { return config_; }
+
+private:
+    std::string path_;
+    WalConfig config_;
+    int fd_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable durable_cv_;
+    std::string pending_;
+    uint64_t next_lsn_;
+    uint64_t pending_first_lsn_;
+    uint32_t pending_count_;
+    std::chrono::steady_clock::time_point pending_since_;
+    uint64_t durable_lsn_;
+    bool flush_requested_;
+    bool stopping_;
+    int error_;
+    std::atomic<size_t> groups_;
+    std::unique_ptr<IoUring> ring_;
+    std::thread flusher_;
+
+    void check_error() const {
+        if (error_ != 0) {
+            throw std::system_error(error_, std::generic_category(), "write-ahead log " + path_);
+        }
+    }
+
+    void write_header() {
+        char header[WAL_HEADER_SIZE];
+        std::memcpy(header, WAL_MAGIC, sizeof(WAL_MAGIC));
+        header[sizeof(WAL_MAGIC)] = static_cast<char>(WAL_VERSION);
+        write_all(fd_, header, sizeof(header), path_);
+    }
+
+    void write_group(const std::string& group) {
+        size_t written = 0;
+        if (ring_) {
+            // the write goes at the file position; a short write cancels the linked sync
+            ring_->queue_write(fd_, group.data(), group.size(), -1, 0, config_.sync);
+            if (config_.sync) {
+                ring_->queue_fdatasync(fd_, 1);
+            }
+            ring_->submit(config_.sync ? 2 : 1);
+            bool synced = !config_.sync;
+            uint64_t op;
+            int result;
+            for (int done = 0; done < (config_.sync ? 2 : 1); done++) {
+                while (!ring_->pop(op, result)) {
+                    ring_->submit(1);
+                }
+                if (result < 0 && result != -ECANCELED) {
+                    throw std::system_error(-result, std::generic_category(), "write-ahead log " + path_);
+                }
+                if (op == 0 && result > 0) {
+                    written = result;
+                } else if (op == 1 && result == 0) {
+                    synced = true;
+                }
+            }
+            if (written == group.size() && synced) {
+                return;
+            }
+        }
+        write_all(fd_, group.data() + written, group.size() - written, path_);
+        if (config_.sync && fdatasync(fd_) < 0) {
+            throw std::system_error(errno, std::generic_category(), "fdatasync " + path_);
+        }
+    }
+
+    // one thread owns the file. it takes whatever is pending as one group, so
+    // records appended while a sync is in flight ride together in the next one
+    void flush_loop() {
+        std::string group;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            if (pending_count_ == 0) {
+                if (stopping_) break;
+                work_cv_.wait(lock);
+                continue;
+            }
+            const auto deadline = pending_since_ + config_.group_delay;
+            while (!stopping_ && !flush_requested_ && pending_.size() < config_.group_bytes &&
+                   std::chrono::steady_clock::now() < deadline) {
+                work_cv_.wait_until(lock, deadline);
+            }
+
+            group.swap(pending_);
+            pending_.clear();
+            WalBlockHeader header{static_cast<uint32_t>(group.size()), pending_count_, pending_first_lsn_,
+                                  XXH64(group.data(), group.size(), 0)};
+            const uint64_t last_lsn = pending_first_lsn_ + pending_count_ - 1;
+            pending_first_lsn_ = last_lsn + 1;
+            pending_count_ = 0;
+            flush_requested_ = false;
+            lock.unlock();
+
+            int error = 0;
+            try {
+                group.insert(0, reinterpret_cast<const char*>(&header), sizeof(header));
+                write_group(group);
+            } catch (const std::system_error& e) {
+                error = e.code().value();
+            }
+            groups_.fetch_add(1, std::memory_order_relaxed);
+
+            lock.lock();
+            if (error != 0) {
+                error_ = error;
+            } else {
+                durable_lsn_ = last_lsn;
+            }
+            durable_cv_.notify_all();
+        }
+    }
+};
+
+// an OpenAddressTable whose inserts and erases are logged, recoverable from the
+// last snapshot plus the log. mutations are applied and logged under one lock so
+// the log order is the apply order; with synchronous_commit the caller then
+// waits for its record outside the lock, which is what lets concurrent writers
+// share one fdatasync.
+//
+// a fuzzy checkpoint moves the log to <wal_path>.prev and starts a fresh one,
+// which is the side log of everything that changes while the checkpoint is
+// taken. .prev is deleted once the checkpoint is durable; if it is still there
+// at startup, a checkpoint was cut short and recovery replays it first.
+class DurableTable {
+public:
+    // slots' worth of homes copied per lock hold during a fuzzy checkpoint
+    static constexpr size_t CHECKPOINT_RANGE_SLOTS = 4096;
+
+    // recovers whatever snapshot_path and wal_path hold, either may be missing
+    DurableTable(const std::string& snapshot_path, const std::string& wal_path, WalConfig config = {},
+                 size_t initial_size = 64)
+            : snapshot_path_(snapshot_path), wal_path_(wal_path), prev_wal_path_(wal_path + ".prev"),
+              config_(config), table_(initial_size), recovered_(0) {
+        uint64_t last_lsn = 0;
+        if (access(snapshot_path.c_str(), F_OK) == 0) {
+            table_ = load_snapshot(snapshot_path, &last_lsn);
+        }
+
+        const bool interrupted = access(prev_wal_path_.c_str(), F_OK) == 0;
+        if (interrupted) {
+            replay(read_wal(prev_wal_path_), last_lsn);
+        }
+        WalContents log = read_wal(wal_path);
+        replay(log, last_lsn);
+        torn_tail_ = log.torn_;
+        wal_ = std::make_shared<WriteAheadLog>(wal_path, config, last_lsn + 1, log.valid_bytes_);
+
+        // the next fuzzy checkpoint would overwrite .prev, fold it into a full one now
+        if (interrupted) {
+            checkpoint();
+        }
+    }
+
+    bool insert(uint64_t key, uint64_t val) {
+        uint64_t lsn;
+        std::shared_ptr<WriteAheadLog> log;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            table_.insert(key, val);
+            lsn = wal_->append(WalOp::Insert, key, val);
+            log = wal_;
+        }
+        commit(*log, lsn);
+        return true;
+    }
+
+    std::optional<uint64_t> get(uint64_t key) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return table_.get(key);
+    }
+
+    // only erases that removed something are logged
+    bool erase(uint64_t key) {
+        uint64_t lsn;
+        std::shared_ptr<WriteAheadLog> log;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            if (!table_.erase(key)) {
+                return false;
+            }
+            lsn = wal_->append(WalOp::Erase, key);
+            log = wal_;
+        }
+        commit(*log, lsn);
+        return true;
+    }
+
+    // writes a snapshot holding every logged op and empties the log. writers block
+    // for the duration; fuzzy_checkpoint avoids that
+    void checkpoint() {
+        std::lock_guard<std::mutex> checkpoint_lock(checkpoint_mutex_);
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        checkpoint_locked();
+    }
+
+    // writes a checkpoint without stopping writers: homes are copied a range at
+    // a time under the shared lock, and every op logged from the start lsn on
+    // goes to the fresh log. writers are only held up while the log is swapped,
+    // one sync of the old log. memory stays at one range of records. returns the
+    // number of records written
+    size_t fuzzy_checkpoint(size_t range_slots = CHECKPOINT_RANGE_SLOTS) {
+        std::lock_guard<std::mutex> checkpoint_lock(checkpoint_mutex_);
+
+        uint64_t start_lsn;
+        std::shared_ptr<WriteAheadLog> old_log;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            // a failed fuzzy checkpoint left .prev behind, renaming over it would lose it
+            if (access(prev_wal_path_.c_str(), F_OK) == 0) {
+                checkpoint_locked();
+            }
+            wal_->flush();
+            start_lsn = wal_->last_lsn();
+            if (rename(wal_path_.c_str(), prev_wal_path_.c_str()) < 0) {
+                throw std::system_error(errno, std::generic_category(), "rename " + wal_path_);
+            }
+            old_log = std::move(wal_);
+            wal_ = std::make_shared<WriteAheadLog>(wal_path_, config_, start_lsn + 1);
+            sync_parent_dir(wal_path_);
+        }
+        old_log.reset();
+
+        FuzzyCheckpointWriter writer(snapshot_path_);
+        std::vector<KeyValue> records;
+        size_t capacity = 0;
+        size_t home = 0;
+        while (true) {
+            records.clear();
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex_);
+                // a resize reassigns every home, start over in the new layout.
+                // records already written are only stale, the log corrects them
+                if (table_.capacity() != capacity) {
+                    capacity = table_.capacity();
+                    home = 0;
+                }
+                if (home >= capacity) {
+                    break;
+                }
+                const size_t end = std::min(home + range_slots, capacity);
+                collect_home_range(table_, home, end, records);
+                home = end;
+            }
+            writer.append(records);
+        }
+
+        writer.finish(capacity, start_lsn);
+        unlink(prev_wal_path_.c_str());
+        sync_parent_dir(prev_wal_path_);
+        return writer.records_written();
+    }
+
+    // makes every acknowledged write durable, for synchronous_commit = false
+    void sync() {
+        std::shared_ptr<WriteAheadLog> log;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            log = wal_;
+        }
+        log->flush();
+    }
+
+    size_t size() {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return table_.size();
+    }
+
+    // ops replayed from the log at startup, and whether a torn block was dropped
+    size_t recovered_ops() const { return recovered_; }
+
+    bool recovered_torn_tail() const { return torn_tail_; }
+
+    WriteAheadLog& log() { return *wal_; }
+
+private:
+    std::string snapshot_path_;
+    std::string wal_path_;
+    std::string prev_wal_path_;
+    WalConfig config_;
+    std::shared_mutex mutex_;
+    std::mutex checkpoint_mutex_;
+    OpenAddressTable table_;
+    // shared so a writer waiting on its record keeps a swapped-out log alive
+    std::shared_ptr<WriteAheadLog> wal_;
+    size_t recovered_;
+    bool torn_tail_ = false;
+
+    void checkpoint_locked() {
+        wal_->flush();
+        save_snapshot(table_, snapshot_path_, wal_->last_lsn());
+        wal_->reset();
+        unlink(prev_wal_path_.c_str());
+    }
+
+    void replay(const WalContents& log, uint64_t& last_lsn) {
+        for (const auto& record : log.records_) {
+            if (record.lsn_ <= last_lsn) {
+                continue;
+            }
+            if (record.op_ == WalOp::Insert) {
+                table_.insert(record.key_, record.val_);
+            } else {
+                table_.erase(record.key_);
+            }
+            last_lsn = record.lsn_;
+            ++recovered_;
+        }
+    }
+
+    void commit(WriteAheadLog& log, uint64_t lsn) {
+        if (log.config().synchronous_commit) {
+            log.wait_durable(lsn);
+        }
+    }
+};
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "wal.cpp"
+
+// usage: wal_benchmark [dir=/tmp] [ops=20000] [max_threads=16]
+//
+// durable inserts per second into a DurableTable whose log lives in `dir`.
+// a single synchronous writer never has company in its group, so its row is
+// what a log that fdatasyncs every write gets; with more writers the records
+// that arrive during one sync share the next. the async and no-sync rows show
+// the ceiling once the disk is out of the way. the io_uring row submits each
+// group's write and fdatasync together.
+// point dir at the disk under test, tmpfs makes every sync free
+
+const size_t DEFAULT_OPS = 20'000;
+const size_t DEFAULT_MAX_THREADS = 16;
+
+struct RunResult {
+    double seconds;
+    uint64_t groups;
+};
+
+static RunResult run(const std::string& dir, const WalConfig& config, size_t threads, size_t ops) {
+    const std::string snapshot_path = dir + "/wal_benchmark.snapshot";
+    const std::string wal_path = dir + "/wal_benchmark.wal";
+    std::remove(snapshot_path.c_str());
+    std::remove(wal_path.c_str());
+
+    RunResult result;
+    {
+        DurableTable table(snapshot_path, wal_path, config, ops * 2);
+        const size_t per_thread = ops / threads;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < threads; t++) {
+            writers.emplace_back([&, t] {
+                for (size_t i = 0; i < per_thread; i++) {
+                    table.insert(t * per_thread + i, i);
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        table.sync();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.groups = table.log().groups_written();
+    }
+    std::remove(snapshot_path.c_str());
+    std::remove(wal_path.c_str());
+    return result;
+}
+
+static void report(const std::string& name, size_t threads, size_t ops, const RunResult& result) {
+    std::cout << std::setw(14) << name << std::setw(9) << threads
+              << std::setw(14) << std::fixed << std::setprecision(0) << ops / result.seconds
+              << std::setw(10) << result.groups
+              << std::setw(12) << std::setprecision(1) << double(ops) / result.groups << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    const std::string dir = argc > 1 ? argv[1] : "/tmp";
+    const size_t ops = argc > 2 ? std::stoull(argv[2]) : DEFAULT_OPS;
+    const size_t max_threads = argc > 3 ? std::stoull(argv[3]) : DEFAULT_MAX_THREADS;
+
+    std::cout << std::setw(14) << "mode" << std::setw(9) << "threads" << std::setw(14) << "writes/s"
+              << std::setw(10) << "groups" << std::setw(12) << "ops/group" << "\n";
+
+    WalConfig group;
+    report("per-op sync", 1, ops, run(dir, group, 1, ops));
+    for (size_t threads = 4; threads <= max_threads; threads *= 2) {
+        report("group commit", threads, ops / threads * threads, run(dir, group, threads, ops));
+    }
+
+    WalConfig uring;
+    uring.use_io_uring = true;
+    report("io_uring", max_threads, ops / max_threads * max_threads, run(dir, uring, max_threads, ops));
+
+    WalConfig async;
+    async.synchronous_commit = false;
+    report("async", 1, ops, run(dir, async, 1, ops));
+
+    WalConfig no_sync;
+    no_sync.sync = false;
+    report("no sync", 1, ops, run(dir, no_sync, 1, ops));
+    return 0;
+}
@@ -0,0 +1,300 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include "wal.cpp"
+
+class WalTest : public ::testing::Test {
+protected:
+    std::string snapshot_path;
+    std::string wal_path;
+
+    void SetUp() override {
+        snapshot_path = ::testing::TempDir() + "oat_wal_test.snapshot";
+        wal_path = ::testing::TempDir() + "oat_wal_test.wal";
+        TearDown();
+    }
+
+    void TearDown() override {
+        std::remove(snapshot_path.c_str());
+        std::remove(wal_path.c_str());
+        std::remove((wal_path + ".prev").c_str());
+    }
+
+    void expect_contents(DurableTable& table, const std::unordered_map<uint64_t, uint64_t>& expected) {
+        EXPECT_EQ(table.size(), expected.size());
+        for (const auto& [key, value] : expected) {
+            EXPECT_EQ(table.get(key), std::optional<uint64_t>(value));
+        }
+    }
+};
+
+TEST_F(WalTest, ReplaysLogAfterRestart) {
+    std::unordered_map<uint64_t, uint64_t> reference;
+    std::mt19937_64 gen(42);
+    {
+        DurableTable table(snapshot_path, wal_path);
+        for (size_t i = 0; i < 5000; i++) {
+            const uint64_t key = gen() % 1000;
+            if (i % 3 == 2) {
+                EXPECT_EQ(table.erase(key), reference.erase(key) > 0);
+            } else {
+                table.insert(key, i);
+                reference[key] = i;
+            }
+        }
+    }
+
+    DurableTable recovered(snapshot_path, wal_path);
+    EXPECT_FALSE(recovered.recovered_torn_tail());
+    expect_contents(recovered, reference);
+}
+
+TEST_F(WalTest, CheckpointTruncatesLogAndRecoveryResumesFromSnapshot) {
+    {
+        DurableTable table(snapshot_path, wal_path);
+        for (uint64_t key = 0; key < 1000; key++) {
+            table.insert(key, key * 2);
+        }
+        table.checkpoint();
+        EXPECT_TRUE(read_wal(wal_path).records_.empty());
+
+        table.insert(5000, 1);
+        table.erase(7);
+        table.insert(8, 99);
+    }
+
+    DurableTable recovered(snapshot_path, wal_path);
+    EXPECT_EQ(recovered.recovered_ops(), 3);
+    EXPECT_EQ(recovered.size(), 1000);
+    EXPECT_EQ(recovered.get(5000), std::optional<uint64_t>(1));
+    EXPECT_FALSE(recovered.get(7).has_value());
+    EXPECT_EQ(recovered.get(8), std::optional<uint64_t>(99));
+    EXPECT_EQ(recovered.get(999), std::optional<uint64_t>(1998));
+
+    // lsns keep counting across the checkpoint, so records logged now are not skipped
+    recovered.insert(6000, 6);
+    EXPECT_GT(recovered.log().last_lsn(), 1003);
+}
+
+TEST_F(WalTest, TornTailIsDroppedAndOverwritten) {
+    {
+        DurableTable table(snapshot_path, wal_path);
+        for (uint64_t key = 0; key < 100; key++) {
+            table.insert(key, key);
+        }
+    }
+    const size_t intact = read_wal(wal_path).valid_bytes_;
+    {
+        // half a block header, as if the machine died mid-write
+        FILE* file = std::fopen(wal_path.c_str(), "ab");
+        std::fwrite("\x40\x00\x00\x00\x01\x00", 1, 6, file);
+        std::fclose(file);
+    }
+
+    {
+        DurableTable table(snapshot_path, wal_path);
+        EXPECT_TRUE(table.recovered_torn_tail());
+        EXPECT_EQ(table.size(), 100);
+        table.insert(100, 100);
+    }
+
+    auto log = read_wal(wal_path);
+    EXPECT_FALSE(log.torn_);
+    EXPECT_GT(log.valid_bytes_, intact);
+    EXPECT_EQ(log.records_.size(), 101);
+    EXPECT_EQ(log.records_.back().lsn_, 101);
+}
+
+TEST_F(WalTest, CorruptBlockChecksumStopsReplay) {
+    {
+        DurableTable table(snapshot_path, wal_path);
+        table.insert(1, 1);
+        table.insert(2, 2);
+    }
+    {
+        // flip a payload byte of the second block
+        FILE* file = std::fopen(wal_path.c_str(), "r+b");
+        std::fseek(file, -1, SEEK_END);
+        std::fputc(0x55, file);
+        std::fclose(file);
+    }
+
+    DurableTable recovered(snapshot_path, wal_path);
+    EXPECT_TRUE(recovered.recovered_torn_tail());
+    EXPECT_EQ(recovered.get(1), std::optional<uint64_t>(1));
+    EXPECT_FALSE(recovered.get(2).has_value());
+}
+
+// every writer waits for its own record, yet they should share fdatasyncs
+TEST_F(WalTest, ConcurrentWritersShareGroupCommits) {
+    const size_t threads = 8;
+    const size_t per_thread = 300;
+    {
+        DurableTable table(snapshot_path, wal_path);
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < threads; t++) {
+            writers.emplace_back([&, t] {
+                for (size_t i = 0; i < per_thread; i++) {
+                    table.insert(t * per_thread + i, i);
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        EXPECT_EQ(table.log().durable_lsn(), threads * per_thread);
+        EXPECT_LT(table.log().groups_written(), threads * per_thread);
+    }
+
+    DurableTable recovered(snapshot_path, wal_path);
+    EXPECT_EQ(recovered.size(), threads * per_thread);
+}
+
+TEST_F(WalTest, AsynchronousCommitIsBoundedByGroupDelay) {
+    WalConfig config;
+    config.synchronous_commit = false;
+    config.group_delay = std::chrono::microseconds(2000);
+    DurableTable table(snapshot_path, wal_path, config);
+
+    table.insert(1, 1);
+    EXPECT_EQ(table.log().last_lsn(), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(table.log().durable_lsn(), 1);
+
+    for (uint64_t key = 2; key <= 1000; key++) {
+        table.insert(key, key);
+    }
+    table.sync();
+    EXPECT_EQ(table.log().durable_lsn(), 1000);
+}
+
+// a writer keeps inserting and erasing, and growing the table, while the
+// checkpoint walks it; checkpoint plus side log must land on the final state
+TEST_F(WalTest, FuzzyCheckpointRunsAlongsideWriter) {
+    std::unordered_map<uint64_t, uint64_t> reference;
+    {
+        WalConfig config;
+        config.synchronous_commit = false;
+        DurableTable table(snapshot_path, wal_path, config);
+        for (uint64_t key = 0; key < 20000; key++) {
+            table.insert(key, key);
+            reference[key] = key;
+        }
+
+        std::atomic<bool> stop{false};
+        std::thread writer([&] {
+            std::mt19937_64 gen(7);
+            for (uint64_t i = 0; !stop || i < 20000; i++) {
+                const uint64_t key = gen() % 60000;
+                if (i % 4 == 3) {
+                    table.erase(key);
+                    reference.erase(key);
+                } else {
+                    table.insert(key, i);
+                    reference[key] = i;
+                }
+            }
+        });
+        table.fuzzy_checkpoint(256);
+        stop = true;
+        writer.join();
+        table.sync();
+        EXPECT_NE(access((wal_path + ".prev").c_str(), F_OK), 0);
+    }
+
+    DurableTable recovered(snapshot_path, wal_path);
+    expect_contents(recovered, reference);
+}
+
+TEST_F(WalTest, FuzzyCheckpointThenRestart) {
+    {
+        DurableTable table(snapshot_path, wal_path);
+        for (uint64_t key = 0; key < 1000; key++) {
+            table.insert(key, key);
+        }
+        EXPECT_EQ(table.fuzzy_checkpoint(), 1000);
+        table.insert(1000, 1000);
+        table.erase(0);
+    }
+
+    DurableTable recovered(snapshot_path, wal_path);
+    EXPECT_EQ(recovered.recovered_ops(), 2);
+    EXPECT_EQ(recovered.size(), 1000);
+    EXPECT_FALSE(recovered.get(0).has_value());
+    EXPECT_EQ(recovered.get(1000), std::optional<uint64_t>(1000));
+}
+
+TEST_F(WalTest, FuzzyCheckpointWithSmallRangesKeepsLongClusters) {
+    // near the resize threshold clusters run far past 4 slots, so ranges start
+    // inside clusters that also hold entries homed before them
+    {
+        DurableTable table(snapshot_path, wal_path, {}, 1024);
+        for (uint64_t key = 0; key < 760; key++) {
+            table.insert(key, key * 3);
+        }
+        EXPECT_EQ(table.fuzzy_checkpoint(4), 760);
+    }
+
+    DurableTable recovered(snapshot_path, wal_path);
+    EXPECT_EQ(recovered.recovered_ops(), 0);
+    EXPECT_EQ(recovered.size(), 760);
+    for (uint64_t key = 0; key < 760; key++) {
+        EXPECT_EQ(recovered.get(key), std::optional<uint64_t>(key * 3));
+    }
+}
+
+// a crash mid-checkpoint leaves the swapped-out log as .prev next to the new one
+TEST_F(WalTest, InterruptedFuzzyCheckpointIsCompletedAtStartup) {
+    const std::string prev_path = wal_path + ".prev";
+    {
+        DurableTable table(snapshot_path, wal_path);
+        for (uint64_t key = 0; key < 100; key++) {
+            table.insert(key, key);
+        }
+    }
+    ASSERT_EQ(rename(wal_path.c_str(), prev_path.c_str()), 0);
+    {
+        WriteAheadLog side_log(wal_path, {}, 101);
+        side_log.append(WalOp::Erase, 5);
+        side_log.append(WalOp::Insert, 200, 2);
+        side_log.flush();
+    }
+
+    {
+        DurableTable table(snapshot_path, wal_path);
+        EXPECT_EQ(table.recovered_ops(), 102);
+        EXPECT_EQ(table.size(), 100);
+        EXPECT_FALSE(table.get(5).has_value());
+        EXPECT_NE(access(prev_path.c_str(), F_OK), 0);
+    }
+    DurableTable reopened(snapshot_path, wal_path);
+    EXPECT_EQ(reopened.recovered_ops(), 0);
+    EXPECT_EQ(reopened.get(200), std::optional<uint64_t>(2));
+}
+
+TEST_F(WalTest, IoUringGroupsRecover) {
+    WalConfig config;
+    config.use_io_uring = true;
+    {
+        DurableTable table(snapshot_path, wal_path, config);
+        std::vector<std::thread> writers;
+        for (uint64_t t = 0; t < 4; t++) {
+            writers.emplace_back([&, t] {
+                for (uint64_t i = 0; i < 200; i++) {
+                    table.insert(t * 1000 + i, i);
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        table.erase(0);
+    }
+
+    DurableTable recovered(snapshot_path, wal_path);
+    EXPECT_EQ(recovered.size(), 799);
+    EXPECT_EQ(recovered.get(3199), std::optional<uint64_t>(199));
+}
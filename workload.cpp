@@ -0,0 +1,68 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "xxhash/xxhash.h"
+
+// zipfian ranks in [0, n) following gray et al. "quickly generating billion-record
+// synthetic databases", the same generator ycsb uses. theta 0 degenerates to uniform;
+// theta must stay below 1, where the generator's 1 / (1 - theta) exponent blows up.
+// ranks are scrambled through xxhash so the hot keys are spread across the table
+// instead of all hashing next to each other.
+class ZipfianGenerator {
+public:
+    ZipfianGenerator(uint64_t n, double theta, uint64_t seed = 42)
+            : n_(n), theta_(theta), generator_(seed), uniform_(0.0, 1.0) {
+        if (!(theta_ < 1.0)) {
+            throw std::invalid_argument("zipfian theta must be below 1, got " + std::to_string(theta_));
+        }
+        if (theta_ > 0) {
+            zetan_ = zeta(n_, theta_);
+            alpha_ = 1.0 / (1.0 - theta_);
+            eta_ = (1.0 - std::pow(2.0 / n_, 1.0 - theta_)) / (1.0 - zeta(2, theta_) / zetan_);
+        }
+    }
+
+    // unscrambled rank, 0 is the most popular
+    uint64_t next_rank() {
+        if (theta_ <= 0) {
+            return static_cast<uint64_t>(uniform_(generator_) * n_) % n_;
+        }
+
+        const double u = uniform_(generator_);
+        const double uz = u * zetan_;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta_)) return 1;
+        return static_cast<uint64_t>(n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_)) % n_;
+    }
+
+    // a key from a fixed keyspace of n distinct values
+    uint64_t next() {
+        return key_for_rank(next_rank());
+    }
+
+    uint64_t key_for_rank(uint64_t rank) const {
+        return XXH64(&rank, sizeof(rank), 0x5eed);
+    }
+
+    uint64_t keyspace() const { return n_; }
+
+private:
+    uint64_t n_;
+    double theta_;
+    double zetan_ = 0;
+    double alpha_ = 0;
+    double eta_ = 0;
+    std::mt19937_64 generator_;
+    std::uniform_real_distribution<double> uniform_;
+
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        return sum;
+    }
+};